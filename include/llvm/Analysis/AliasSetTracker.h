@@ -113,6 +113,9 @@ class AliasSet : public ilist_node<AliasSet> {
   // All instructions without a specific address in this alias set.
   std::vector<AssertingVH<Instruction> > UnknownInsts;
 
+  // Number of pointers in this alias set, not counting forwarded sets.
+  unsigned SetSize;
+
   // RefCount - Number of nodes pointing to this AliasSet plus the number of
   // AliasSets forwarding to it.
   unsigned RefCount : 28;
@@ -142,6 +145,10 @@ class AliasSet : public ilist_node<AliasSet> {
   };
   unsigned Alias : 1;
 
+  /// True if this alias set conservatively aliases everything. Set once the
+  /// tracker is saturated and all alias sets are collapsed into this one.
+  unsigned AliasAny : 1;
+
   // Volatile - True if this alias set contains volatile loads or stores.
   bool Volatile : 1;
 
@@ -164,6 +171,10 @@ public:
   bool isMustAlias() const { return Alias == SetMustAlias; }
   bool isMayAlias()  const { return Alias == SetMayAlias; }
 
+  /// isAliasAny - Return true if this is the set the tracker collapsed all
+  /// pointers into when it became saturated.
+  bool isAliasAny() const { return AliasAny; }
+
   // isVolatile - Return true if this alias set contains volatile loads or
   // stores.
   bool isVolatile() const { return Volatile; }
@@ -183,6 +194,9 @@ public:
   iterator end()   const { return iterator(); }
   bool empty() const { return PtrList == nullptr; }
 
+  /// size - Return the number of pointers in this alias set.
+  unsigned size() const { return SetSize; }
+
   void print(raw_ostream &OS) const;
   void dump() const;
 
@@ -223,8 +237,9 @@ private:
   // to serve as a sentinel.
   friend struct ilist_sentinel_traits<AliasSet>;
   AliasSet()
-    : PtrList(nullptr), PtrListEnd(&PtrList), Forward(nullptr), RefCount(0),
-      Access(NoAccess), Alias(SetMustAlias), Volatile(false) {
+    : PtrList(nullptr), PtrListEnd(&PtrList), Forward(nullptr), SetSize(0),
+      RefCount(0), Access(NoAccess), Alias(SetMustAlias), AliasAny(false),
+      Volatile(false) {
   }
 
   AliasSet(const AliasSet &AS) = delete;
@@ -254,7 +269,8 @@ private:
   void addPointer(AliasSetTracker &AST, PointerRec &Entry, uint64_t Size,
                   const AAMDNodes &AAInfo,
                   bool KnownMustAlias = false);
-  void addUnknownInst(Instruction *I, AliasAnalysis &AA);
+  void addUnknownInst(AliasSetTracker &AST, Instruction *I,
+                      AliasAnalysis &AA);
   void removeUnknownInst(AliasSetTracker &AST, Instruction *I) {
     bool WasEmpty = UnknownInsts.empty();
     for (size_t i = 0, e = UnknownInsts.size(); i != e; ++i)
@@ -301,6 +317,15 @@ class AliasSetTracker {
   AliasAnalysis &AA;
   ilist<AliasSet> AliasSets;
 
+  /// The set all pointers were collapsed into once the tracker saturated, or
+  /// null if it has not saturated.
+  AliasSet *AliasAnyAS;
+
+  /// The number of pointers in may-alias sets. Every new pointer is checked
+  /// against these sets, so once there are too many of them the tracker stops
+  /// distinguishing between pointers at all.
+  unsigned TotalMayAliasSetSize;
+
   typedef DenseMap<ASTCallbackVH, AliasSet::PointerRec*,
                    ASTCallbackVHDenseMapInfo>
     PointerMapType;
@@ -312,7 +337,8 @@ public:
   /// AliasSetTracker ctor - Create an empty collection of AliasSets, and use
   /// the specified alias analysis object to disambiguate load and store
   /// addresses.
-  explicit AliasSetTracker(AliasAnalysis &aa) : AA(aa) {}
+  explicit AliasSetTracker(AliasAnalysis &aa)
+      : AA(aa), AliasAnyAS(nullptr), TotalMayAliasSetSize(0) {}
   ~AliasSetTracker() { clear(); }
 
   /// add methods - These methods are used to add different types of
@@ -379,6 +405,10 @@ public:
   /// members in any of the sets.
   bool containsUnknown(const Instruction *I) const;
 
+  /// isSaturated - Return true if the tracker gave up on distinguishing
+  /// pointers and placed everything in a single may-alias set.
+  bool isSaturated() const { return AliasAnyAS != nullptr; }
+
   /// getAliasAnalysis - Return the underlying alias analysis object used by
   /// this tracker.
   AliasAnalysis &getAliasAnalysis() const { return AA; }
@@ -426,12 +456,8 @@ private:
 
   AliasSet &addPointer(Value *P, uint64_t Size, const AAMDNodes &AAInfo,
                        AliasSet::AccessLattice E,
-                       bool &NewSet) {
-    NewSet = false;
-    AliasSet &AS = getAliasSetForPointer(P, Size, AAInfo, &NewSet);
-    AS.Access |= E;
-    return AS;
-  }
+                       bool &NewSet);
+  AliasSet &mergeAllAliasSets();
   AliasSet *findAliasSetForPointer(const Value *Ptr, uint64_t Size,
                                    const AAMDNodes &AAInfo);
 
@@ -48,6 +48,11 @@ public:
   void getAnalysisUsage(AnalysisUsage &AU) const override;
   bool runOnFunction(Function &F) override;
 
+  /// \brief Compute branch probabilities for \p F outside of a pass manager.
+  ///
+  /// \p LI must stay alive as long as the probabilities are used.
+  void calculate(Function &F, LoopInfo &LI);
+
   void releaseMemory() override;
 
   void print(raw_ostream &OS, const Module *M = nullptr) const override;
@@ -597,6 +597,9 @@ public:
   /// the analysis.
   const LoopAccessInfo &getInfo(Loop *L, const ValueToValueMap &Strides);
 
+  /// \brief Drop the cached result for \p L, which is about to be deleted.
+  void forgetLoop(Loop *L) { LoopAccessInfoMap.erase(L); }
+
   void releaseMemory() override {
     // Invalidate the cache when the pass is freed.
     LoopAccessInfoMap.clear();
@@ -90,6 +90,9 @@
 /* Define if we have the oprofile JIT-support library */
 #cmakedefine LLVM_USE_OPROFILE 1
 
+/* Define if we have perf JIT support */
+#cmakedefine LLVM_USE_PERF 1
+
 /* Major version of the LLVM API */
 #define LLVM_VERSION_MAJOR ${LLVM_VERSION_MAJOR}
 
@@ -103,6 +103,9 @@ class ExecutionEngine {
   // synchronized.  Wouldn't a reader-writer design be better here?
   ExecutionEngineState EEState;
 
+  /// Incremented whenever a global mapping is added, changed or removed.
+  unsigned GlobalMappingGeneration = 0;
+
   /// The target data for the platform for which execution is being performed.
   const DataLayout *DL;
 
@@ -307,6 +310,13 @@ public:
   uint64_t updateGlobalMapping(const GlobalValue *GV, void *Addr);
   uint64_t updateGlobalMapping(StringRef Name, uint64_t Addr);
 
+  /// getGlobalMappingGeneration - Return a counter that changes every time the
+  /// global mappings change, so that clients which cache global addresses can
+  /// tell when to drop them.
+  unsigned getGlobalMappingGeneration() const {
+    return GlobalMappingGeneration;
+  }
+
   /// getAddressToGlobalIfAvailable - This returns the address of the specified
   /// global symbol.
   uint64_t getAddressToGlobalIfAvailable(StringRef S);
@@ -0,0 +1,90 @@
+//===- FileSystemObjectCache.h - Persistent object cache --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an ObjectCache that keeps compiled objects in a directory
+// on disk, so that they survive across runs of the JIT.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILESYSTEMOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILESYSTEMOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/Mutex.h"
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// An ObjectCache that stores objects as files in a cache directory.
+///
+/// Objects are looked up by a hash of the module's bitcode and of the code
+/// generator configuration (target triple, CPU, features, optimization level,
+/// relocation and code models, and the LLVM version), so the cache never
+/// returns an object for a module that has changed in any way.  It is safe to
+/// share a cache directory between processes: objects are written to a
+/// temporary file and renamed into place while holding a lock on the entry.
+///
+/// If a size limit is given, the least recently used objects are evicted
+/// whenever a new object takes the cache over the limit.
+class FileSystemObjectCache : public ObjectCache {
+  FileSystemObjectCache(const FileSystemObjectCache&) = delete;
+  void operator=(const FileSystemObjectCache&) = delete;
+
+public:
+  /// Create a cache in \p CacheDir for objects compiled by \p TM.  The
+  /// configuration of \p TM is read each time a module is looked up, so it may
+  /// be changed between compilations, but not between the lookup and the
+  /// compilation of a module.  Clients that configure \p TM per module while
+  /// compiling it should describe their settings with the constructor below.
+  /// A \p MaxSizeInBytes of zero means the cache is unbounded.
+  FileSystemObjectCache(StringRef CacheDir, const TargetMachine &TM,
+                        uint64_t MaxSizeInBytes = 0);
+
+  /// Create a cache in \p CacheDir whose keys include \p Configuration, a
+  /// client-provided description of how objects are compiled.
+  FileSystemObjectCache(StringRef CacheDir, StringRef Configuration,
+                        uint64_t MaxSizeInBytes = 0);
+
+  ~FileSystemObjectCache() override;
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Remove the least recently used objects until the cache is within its
+  /// size limit.
+  void prune();
+
+  /// Return the key the object for \p M is stored under.
+  std::string getKey(const Module &M) const;
+
+  /// Describe the parts of \p TM's configuration that affect the generated
+  /// code.
+  static std::string getConfiguration(const TargetMachine &TM);
+
+private:
+  std::string getObjectPath(StringRef Key) const;
+
+  std::string CacheDir;
+  const TargetMachine *TM;
+  std::string Configuration;
+  uint64_t MaxSizeInBytes;
+
+  // Code generation may modify a module, so the key computed when a module is
+  // looked up and missed is remembered until its object is stored.
+  sys::Mutex Lock;
+  DenseMap<const Module*, std::string> PendingKeys;
+};
+
+} // end namespace llvm
+
+#endif
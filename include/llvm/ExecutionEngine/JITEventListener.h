@@ -113,6 +113,14 @@ public:
     return nullptr;
   }
 #endif // USE_OPROFILE
+
+#if LLVM_USE_PERF
+  // Construct a PerfJITEventListener, which describes JIT code to perf in
+  // /tmp/perf-<pid>.map and in a jitdump file.
+  static JITEventListener *createPerfJITEventListener();
+#else
+  static JITEventListener *createPerfJITEventListener() { return nullptr; }
+#endif // LLVM_USE_PERF
 private:
   virtual void anchor();
 };
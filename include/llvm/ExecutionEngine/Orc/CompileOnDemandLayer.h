@@ -19,11 +19,23 @@
 #include "LambdaResolver.h"
 #include "LogicalDylib.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <deque>
 #include <list>
+#include <map>
+#include <mutex>
 #include <set>
 
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <thread>
+#endif
+
 #include "llvm/Support/Debug.h"
 
 namespace llvm {
@@ -36,6 +48,30 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   Modules may be loaded lazily (e.g. by getLazyBitcodeModule). A function's
+/// body is then only read in when the function is first compiled, so the cost
+/// of adding a module scales with the functions that are actually called.
+///
+///   If background compilation is enabled, compiling a function also queues
+/// the functions it calls directly (which are likely to be called next) for
+/// compilation on a worker thread. When the worker finishes a function it
+/// updates the function's body pointer, so later calls through the stub go
+/// straight to the compiled body. A call that arrives before the worker gets
+/// to the function takes the usual synchronous path, waiting at most for the
+/// compile currently in flight.
+///
+///   The layers below are not thread-safe, and all partitions of a module share
+/// its LLVMContext, so compilation is serialized by a single lock: the worker
+/// hides compile latency behind execution, it does not add parallelism.
+///
+///   If a tier-up threshold is given, functions are first emitted as a cheap
+/// baseline tier with a call counter at their entry, and the source body is
+/// kept. When the counter reaches the threshold the function is recompiled as
+/// a hot tier (on the background worker, if enabled) and its body pointer is
+/// switched to the new code. Hot tier modules are marked so that the layer
+/// below can tell them apart (see isHotTierModule) and compile them with a
+/// higher optimization level.
 template <typename BaseLayerT, typename CompileCallbackMgrT,
           typename PartitioningFtor =
             std::function<std::set<Function*>(Function&)>>
@@ -76,9 +112,18 @@ private:
 
   typedef typename BaseLayerT::ModuleSetHandleT BaseLayerModuleSetHandleT;
 
+  struct TierUpInfo;
+
   struct LogicalModuleResources {
     std::shared_ptr<Module> SourceModule;
     std::set<const Function*> StubsToClone;
+    // Addresses of the function bodies compiled so far. A body may be compiled
+    // before its compile callback runs (as part of another function's
+    // partition, or by the background worker).
+    std::map<const Function*, TargetAddress> FunctionBodyAddrs;
+    // Tier-up state of each function, if tiered compilation is enabled.
+    std::map<const Function*, TierUpInfo*> TierUpInfos;
+    std::set<const Function*> HotFunctions;
   };
 
   struct LogicalDylibResources {
@@ -94,15 +139,61 @@ private:
   typedef typename CODLogicalDylib::LogicalModuleHandle LogicalModuleHandle;
   typedef std::list<CODLogicalDylib> LogicalDylibList;
 
+  // A function queued for compilation on the background worker.
+  struct CompileRequest {
+    CODLogicalDylib *LD;
+    LogicalModuleHandle LMH;
+    Function *F;
+    bool Hot;
+  };
+
+  // Passed (as an opaque pointer baked into the baseline code) to the tier-up
+  // entry point when a function's call counter runs out.
+  struct TierUpInfo {
+    CompileOnDemandLayer *Layer;
+    CODLogicalDylib *LD;
+    LogicalModuleHandle LMH;
+    Function *F;
+  };
+
 public:
   /// @brief Handle to a set of loaded modules.
   typedef typename LogicalDylibList::iterator ModuleSetHandleT;
 
   /// @brief Construct a compile-on-demand layer instance.
+  ///
+  ///   If CompileInBackground is true (and LLVM was built with threads), the
+  /// direct callees of each compiled function are compiled ahead of time on a
+  /// background thread. If TierUpThreshold is non-zero, each function is
+  /// recompiled as a hot tier after it has been called that many times.
   CompileOnDemandLayer(BaseLayerT &BaseLayer, CompileCallbackMgrT &CallbackMgr,
-                       bool CloneStubsIntoPartitions)
+                       bool CloneStubsIntoPartitions,
+                       bool CompileInBackground = false,
+                       unsigned TierUpThreshold = 0)
       : BaseLayer(BaseLayer), CompileCallbackMgr(CallbackMgr),
-        CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
+        CloneStubsIntoPartitions(CloneStubsIntoPartitions),
+        CompileInBackground(CompileInBackground),
+        TierUpThreshold(TierUpThreshold) {
+#if LLVM_ENABLE_THREADS
+    if (this->CompileInBackground)
+      Worker = std::thread([this]() { runCompileWorker(); });
+#else
+    this->CompileInBackground = false;
+#endif
+  }
+
+  ~CompileOnDemandLayer() {
+#if LLVM_ENABLE_THREADS
+    if (Worker.joinable()) {
+      {
+        std::lock_guard<std::mutex> Lock(QueueMutex);
+        StopWorker = true;
+      }
+      QueueCV.notify_one();
+      Worker.join();
+    }
+#endif
+  }
 
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -114,6 +205,7 @@ public:
     assert(MemMgr == nullptr &&
            "User supplied memory managers not supported with COD yet.");
 
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
     LogicalDylibs.push_back(CODLogicalDylib(BaseLayer));
     auto &LDResources = LogicalDylibs.back().getDylibResources();
 
@@ -142,6 +234,19 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by H.
   void removeModuleSet(ModuleSetHandleT H) {
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    {
+      // Drop any pending background compiles for the removed modules.
+      std::lock_guard<std::mutex> QLock(QueueMutex);
+      CODLogicalDylib *LD = &*H;
+      CompileQueue.erase(std::remove_if(CompileQueue.begin(),
+                                        CompileQueue.end(),
+                                        [LD](const CompileRequest &R) {
+                                          return R.LD == LD;
+                                        }),
+                         CompileQueue.end());
+    }
+    TierUps.remove_if([&H](const TierUpInfo &TU) { return TU.LD == &*H; });
     LogicalDylibs.erase(H);
   }
 
@@ -150,18 +255,34 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
-    return BaseLayer.findSymbol(Name, ExportedSymbolsOnly);
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    return resolveNow(BaseLayer.findSymbol(Name, ExportedSymbolsOnly));
   }
 
   /// @brief Get the address of a symbol provided by this layer, or some layer
   ///        below this one.
   JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
                          bool ExportedSymbolsOnly) {
-    return H->findSymbol(Name, ExportedSymbolsOnly);
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    return resolveNow(H->findSymbol(Name, ExportedSymbolsOnly));
+  }
+
+  /// @brief Returns true if M is a partition emitted for the hot tier.
+  static bool isHotTierModule(const Module &M) {
+    return M.getModuleFlag(getHotTierFlagName()) != nullptr;
   }
 
 private:
 
+  // Symbols returned from the layers below may emit code the first time their
+  // address is requested. Do that now, under the lock, if a background worker
+  // could be using the layers below at the same time.
+  JITSymbol resolveNow(JITSymbol Sym) {
+    if (!CompileInBackground || !Sym)
+      return Sym;
+    return JITSymbol(Sym.getAddress(), Sym.getFlags());
+  }
+
   void addLogicalModule(CODLogicalDylib &LD, std::shared_ptr<Module> SrcM) {
 
     // Bump the linkage and rename any anonymous/privote members in SrcM to
@@ -209,6 +330,11 @@ private:
         [this, &LD, LMH, &F]() {
           return this->extractAndCompile(LD, LMH, F);
         });
+
+      if (TierUpThreshold) {
+        TierUps.push_back(TierUpInfo{this, &LD, LMH, &F});
+        LMResources.TierUpInfos[&F] = &TierUps.back();
+      }
     }
 
     // Now clone the global variable declarations.
@@ -252,7 +378,14 @@ private:
   TargetAddress extractAndCompile(CODLogicalDylib &LD,
                                   LogicalModuleHandle LMH,
                                   Function &F) {
-    Module &SrcM = *LD.getLogicalModuleResources(LMH).SourceModule;
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    auto &LMResources = LD.getLogicalModuleResources(LMH);
+    Module &SrcM = *LMResources.SourceModule;
+
+    // If F has already been compiled return its address.
+    auto BodyI = LMResources.FunctionBodyAddrs.find(&F);
+    if (BodyI != LMResources.FunctionBodyAddrs.end())
+      return BodyI->second;
 
     // If F is a declaration we must already have compiled it.
     if (F.isDeclaration())
@@ -262,8 +395,68 @@ private:
     std::string CalledFnName = Mangle(F.getName(), SrcM.getDataLayout());
 
     auto Partition = LD.getDylibResources().Partitioner(F);
-    auto PartitionH = emitPartition(LD, LMH, Partition);
+    materializePartition(Partition);
+
+    // Predict which functions will be called next before the bodies are moved
+    // out of the source module.
+    std::vector<Function*> Callees;
+    if (CompileInBackground)
+      Callees = getDirectCallees(SrcM, Partition);
+
+    auto PartitionH = emitPartition(LD, LMH, Partition, false);
+    TargetAddress CalledAddr =
+      updateBodyPointers(LD, LMH, F, Partition, PartitionH);
+
+    for (auto *Callee : Callees)
+      queueBackgroundCompile(LD, LMH, *Callee, false);
+
+    return CalledAddr;
+  }
+
+  // Recompile F as a hot tier and point its stub at the new body.
+  void recompileHot(CODLogicalDylib &LD, LogicalModuleHandle LMH,
+                    Function &F) {
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+    auto &LMResources = LD.getLogicalModuleResources(LMH);
+    if (F.isDeclaration() || !LMResources.HotFunctions.insert(&F).second)
+      return;
 
+    std::set<Function*> Partition;
+    Partition.insert(&F);
+    auto PartitionH = emitPartition(LD, LMH, Partition, true);
+    updateBodyPointers(LD, LMH, F, Partition, PartitionH);
+  }
+
+  // Called from baseline code when a function's call counter runs out. The
+  // baseline body carries on executing; later calls through the stub reach
+  // the hot body once it has been compiled.
+  static void tierUpEntryPoint(void *Ctx) {
+    auto &TU = *static_cast<TierUpInfo*>(Ctx);
+    if (TU.Layer->CompileInBackground)
+      TU.Layer->queueBackgroundCompile(*TU.LD, TU.LMH, *TU.F, true);
+    else
+      TU.Layer->recompileHot(*TU.LD, TU.LMH, *TU.F);
+  }
+
+  // Read in the bodies of the functions in Partition, if their module was
+  // loaded lazily.
+  template <typename PartitionT>
+  static void materializePartition(const PartitionT &Partition) {
+    for (auto *SubF : Partition)
+      if (std::error_code EC = SubF->materialize())
+        report_fatal_error("Could not materialize function '" +
+                           SubF->getName() + "': " + EC.message());
+  }
+
+  // Point the stubs of the functions in Partition at their bodies in
+  // PartitionH, and return the address of F's body.
+  template <typename PartitionT>
+  TargetAddress updateBodyPointers(CODLogicalDylib &LD,
+                                   LogicalModuleHandle LMH, Function &F,
+                                   const PartitionT &Partition,
+                                   BaseLayerModuleSetHandleT PartitionH) {
+    auto &LMResources = LD.getLogicalModuleResources(LMH);
+    Module &SrcM = *LMResources.SourceModule;
     TargetAddress CalledAddr = 0;
     for (auto *SubF : Partition) {
       std::string FName = SubF->getName();
@@ -287,16 +480,89 @@ private:
       if (SubF == &F)
         CalledAddr = FnBodyAddr;
 
+      LMResources.FunctionBodyAddrs[SubF] = FnBodyAddr;
+
+      // This may race with JIT'd code reading the pointer through the stub on
+      // another thread, which sees either the old or the new address: both are
+      // valid entry points.
       memcpy(FnPtrAddr, &FnBodyAddr, sizeof(uintptr_t));
     }
 
     return CalledAddr;
   }
 
+  // Return the functions defined in SrcM, outside of Partition, that are
+  // called directly from the functions in Partition.
+  template <typename PartitionT>
+  static std::vector<Function*> getDirectCallees(Module &SrcM,
+                                                 const PartitionT &Partition) {
+    std::vector<Function*> Callees;
+    std::set<Function*> Seen(Partition.begin(), Partition.end());
+    for (auto *F : Partition)
+      for (auto &BB : *F)
+        for (auto &I : BB) {
+          CallSite CS(&I);
+          if (!CS)
+            continue;
+          Function *Callee = dyn_cast<Function>(
+                               CS.getCalledValue()->stripPointerCasts());
+          if (Callee && !Callee->isDeclaration() &&
+              Callee->getParent() == &SrcM && Seen.insert(Callee).second)
+            Callees.push_back(Callee);
+        }
+    return Callees;
+  }
+
+  void queueBackgroundCompile(CODLogicalDylib &LD, LogicalModuleHandle LMH,
+                              Function &F, bool Hot) {
+    if (!Hot && LD.getLogicalModuleResources(LMH).FunctionBodyAddrs.count(&F))
+      return;
+    {
+      std::lock_guard<std::mutex> Lock(QueueMutex);
+      CompileQueue.push_back(CompileRequest{&LD, LMH, &F, Hot});
+    }
+#if LLVM_ENABLE_THREADS
+    QueueCV.notify_one();
+#endif
+  }
+
+#if LLVM_ENABLE_THREADS
+  void runCompileWorker() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> Lock(QueueMutex);
+        QueueCV.wait(Lock,
+                     [this]() { return StopWorker || !CompileQueue.empty(); });
+        if (StopWorker)
+          return;
+      }
+
+      // Take the compile lock before popping the request, so that the request's
+      // dylib can't be removed while we compile it.
+      std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
+      CompileRequest R;
+      {
+        std::lock_guard<std::mutex> QLock(QueueMutex);
+        if (StopWorker)
+          return;
+        if (CompileQueue.empty())
+          continue;
+        R = CompileQueue.front();
+        CompileQueue.pop_front();
+      }
+      if (R.Hot)
+        recompileHot(*R.LD, R.LMH, *R.F);
+      else
+        extractAndCompile(*R.LD, R.LMH, *R.F);
+    }
+  }
+#endif
+
   template <typename PartitionT>
   BaseLayerModuleSetHandleT emitPartition(CODLogicalDylib &LD,
                                           LogicalModuleHandle LMH,
-                                          const PartitionT &Partition) {
+                                          const PartitionT &Partition,
+                                          bool Hot) {
     auto &LMResources = LD.getLogicalModuleResources(LMH);
     Module &SrcM = *LMResources.SourceModule;
 
@@ -307,8 +573,13 @@ private:
       NewName += F->getName();
     }
 
+    if (Hot)
+      NewName += ".hot";
+
     auto M = llvm::make_unique<Module>(NewName, SrcM.getContext());
     M->setDataLayout(SrcM.getDataLayout());
+    if (Hot)
+      M->addModuleFlag(Module::Warning, getHotTierFlagName(), 1);
     ValueToValueMapTy VMap;
     GlobalDeclMaterializer GDM(*M, &LMResources.StubsToClone);
 
@@ -316,9 +587,20 @@ private:
     for (auto *F : Partition)
       cloneFunctionDecl(*M, *F, &VMap);
 
-    // Move the function bodies.
-    for (auto *F : Partition)
-      moveFunctionBody(*F, VMap, &GDM);
+    // Move the function bodies. Baseline tier bodies are copied instead, so
+    // that the source is still available when the function gets hot.
+    for (auto *F : Partition) {
+      auto TUI = LMResources.TierUpInfos.find(F);
+      if (Hot || TUI == LMResources.TierUpInfos.end()) {
+        moveFunctionBody(*F, VMap, &GDM);
+        continue;
+      }
+      Function *NewF = cast<Function>(VMap[F]);
+      SmallVector<ReturnInst*, 8> Returns;
+      CloneFunctionInto(NewF, F, VMap, /*ModuleLevelChanges=*/true, Returns,
+                        "", nullptr, nullptr, &GDM);
+      insertTierUpCounter(*NewF, *TUI->second);
+    }
 
     // Create memory manager and symbol resolver.
     auto MemMgr = llvm::make_unique<SectionMemoryManager>();
@@ -341,10 +623,76 @@ private:
                                   std::move(Resolver));
   }
 
+  // Count down the calls to the baseline body NewF, and call the tier-up entry
+  // point when the count reaches zero.
+  void insertTierUpCounter(Function &NewF, TierUpInfo &TU) {
+    Module &M = *NewF.getParent();
+    LLVMContext &Ctx = M.getContext();
+    Type *Int32Ty = Type::getInt32Ty(Ctx);
+    auto *Counter =
+      new GlobalVariable(M, Int32Ty, false, GlobalValue::InternalLinkage,
+                         ConstantInt::get(Int32Ty, TierUpThreshold),
+                         NewF.getName() + "$orc_calls");
+
+    // Keep static allocas in the entry block.
+    BasicBlock *Entry = &NewF.getEntryBlock();
+    BasicBlock::iterator SplitPt = Entry->getFirstInsertionPt();
+    while (isa<AllocaInst>(SplitPt))
+      ++SplitPt;
+    BasicBlock *Body = Entry->splitBasicBlock(SplitPt, "orc.body");
+    BasicBlock *Count = BasicBlock::Create(Ctx, "orc.count", &NewF, Body);
+    BasicBlock *TierUp = BasicBlock::Create(Ctx, "orc.tierup", &NewF, Body);
+
+    // Entry: once the counter is zero the function has already tiered up.
+    Entry->getTerminator()->eraseFromParent();
+    IRBuilder<> Builder(Entry);
+    Value *Calls = Builder.CreateLoad(Counter);
+    Builder.CreateCondBr(Builder.CreateIsNull(Calls), Body, Count);
+
+    Builder.SetInsertPoint(Count);
+    Value *Remaining = Builder.CreateSub(Calls, ConstantInt::get(Int32Ty, 1));
+    Builder.CreateStore(Remaining, Counter);
+    Builder.CreateCondBr(Builder.CreateIsNull(Remaining), TierUp, Body);
+
+    Builder.SetInsertPoint(TierUp);
+    Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+    FunctionType *TierUpFnTy =
+      FunctionType::get(Type::getVoidTy(Ctx), Int8PtrTy, false);
+    Constant *TierUpFn =
+      createIRTypedAddress(*TierUpFnTy,
+                           static_cast<TargetAddress>(
+                             reinterpret_cast<uintptr_t>(&tierUpEntryPoint)));
+    Constant *TierUpCtx =
+      ConstantExpr::getIntToPtr(
+        ConstantInt::get(Type::getInt64Ty(Ctx),
+                         static_cast<uint64_t>(
+                           reinterpret_cast<uintptr_t>(&TU))),
+        Int8PtrTy);
+    Builder.CreateCall(TierUpFn, TierUpCtx);
+    Builder.CreateBr(Body);
+  }
+
+  static StringRef getHotTierFlagName() { return "orc.hot-tier"; }
+
   BaseLayerT &BaseLayer;
   CompileCallbackMgrT &CompileCallbackMgr;
   LogicalDylibList LogicalDylibs;
   bool CloneStubsIntoPartitions;
+  bool CompileInBackground;
+  unsigned TierUpThreshold;
+  std::list<TierUpInfo> TierUps;
+
+  // Serializes all use of the layers below and of the source modules. This is
+  // recursive because symbol resolvers called while compiling may search this
+  // layer again.
+  std::recursive_mutex CompileMutex;
+  std::mutex QueueMutex;
+  std::deque<CompileRequest> CompileQueue;
+#if LLVM_ENABLE_THREADS
+  std::condition_variable QueueCV;
+  bool StopWorker = false;
+  std::thread Worker;
+#endif
 };
 
 } // End namespace orc.
@@ -18,7 +18,11 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/MC/MCContext.h"
 #include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetMachine.h"
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace llvm {
 namespace orc {
@@ -56,6 +60,70 @@ private:
   TargetMachine &TM;
 };
 
+/// @brief Compile functor that can be called from several threads at once.
+///
+///   A TargetMachine may only be used by one thread at a time, so each
+/// compilation borrows one from a pool of TargetMachines configured like the
+/// given one, creating a new one when all are in use. The pool is shared by
+/// all copies of the functor. Modules compiled concurrently must not share an
+/// LLVMContext.
+class ConcurrentIRCompiler {
+public:
+  /// @brief Construct a compile functor creating TargetMachines like \p TM.
+  ///        \p TM itself is only used to read the configuration.
+  ConcurrentIRCompiler(const TargetMachine &TM)
+      : Pool(std::make_shared<TargetMachinePool>(TM)) {}
+
+  /// @brief Compile a Module to an ObjectFile.
+  object::OwningBinary<object::ObjectFile> operator()(Module &M) const {
+    std::unique_ptr<TargetMachine> TM = Pool->take();
+    auto Obj = SimpleCompiler(*TM)(M);
+    Pool->giveBack(std::move(TM));
+    return Obj;
+  }
+
+private:
+  class TargetMachinePool {
+  public:
+    TargetMachinePool(const TargetMachine &TM)
+        : T(TM.getTarget()), TT(TM.getTargetTriple().str()),
+          CPU(TM.getTargetCPU()), Features(TM.getTargetFeatureString()),
+          Options(TM.Options), RM(TM.getRelocationModel()),
+          CM(TM.getCodeModel()), OL(TM.getOptLevel()) {}
+
+    std::unique_ptr<TargetMachine> take() {
+      {
+        std::lock_guard<std::mutex> Lock(PoolMutex);
+        if (!Idle.empty()) {
+          std::unique_ptr<TargetMachine> TM = std::move(Idle.back());
+          Idle.pop_back();
+          return TM;
+        }
+      }
+      return std::unique_ptr<TargetMachine>(
+          T.createTargetMachine(TT, CPU, Features, Options, RM, CM, OL));
+    }
+
+    void giveBack(std::unique_ptr<TargetMachine> TM) {
+      std::lock_guard<std::mutex> Lock(PoolMutex);
+      Idle.push_back(std::move(TM));
+    }
+
+  private:
+    const Target &T;
+    std::string TT, CPU, Features;
+    TargetOptions Options;
+    Reloc::Model RM;
+    CodeModel::Model CM;
+    CodeGenOpt::Level OL;
+
+    std::mutex PoolMutex;
+    std::vector<std::unique_ptr<TargetMachine>> Idle;
+  };
+
+  std::shared_ptr<TargetMachinePool> Pool;
+};
+
 } // End namespace orc.
 } // End namespace llvm.
 
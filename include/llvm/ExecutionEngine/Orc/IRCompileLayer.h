@@ -29,6 +29,12 @@ namespace orc {
 /// immediately compiles each IR module to an object file (each IR Module is
 /// compiled separately). The resulting set of object files is then added to
 /// the layer below, which must implement the object layer concept.
+///
+///   The layer holds no locks while compiling, so module sets added from
+/// different threads are compiled concurrently, provided that the compile
+/// functor (see ConcurrentIRCompiler) and the object cache are thread-safe and
+/// that the modules do not share an LLVMContext. Calls into the base layer
+/// are as thread-safe as the base layer is.
 template <typename BaseLayerT> class IRCompileLayer {
 public:
   typedef std::function<object::OwningBinary<object::ObjectFile>(Module &)>
@@ -45,9 +51,13 @@ public:
   typedef ObjSetHandleT ModuleSetHandleT;
 
   /// @brief Construct an IRCompileLayer with the given BaseLayer, which must
-  ///        implement the ObjectLayer concept.
-  IRCompileLayer(BaseLayerT &BaseLayer, CompileFtor Compile)
-      : BaseLayer(BaseLayer), Compile(std::move(Compile)), ObjCache(nullptr) {}
+  ///        implement the ObjectLayer concept. If ObjCache is given, it is
+  ///        queried before compiling each module (see FileSystemObjectCache
+  ///        for a cache that persists across runs).
+  IRCompileLayer(BaseLayerT &BaseLayer, CompileFtor Compile,
+                 ObjectCache *ObjCache = nullptr)
+      : BaseLayer(BaseLayer), Compile(std::move(Compile)),
+        ObjCache(ObjCache) {}
 
   /// @brief Set an ObjectCache to query before compiling.
   void setObjectCache(ObjectCache *NewCache) { ObjCache = NewCache; }
@@ -68,16 +78,7 @@ public:
     for (const auto &M : Ms) {
       std::unique_ptr<object::ObjectFile> Object;
       std::unique_ptr<MemoryBuffer> Buffer;
-
-      if (ObjCache)
-        std::tie(Object, Buffer) = tryToLoadFromObjectCache(*M).takeBinary();
-
-      if (!Object) {
-        std::tie(Object, Buffer) = Compile(*M).takeBinary();
-        if (ObjCache)
-          ObjCache->notifyObjectCompiled(&*M, Buffer->getMemBufferRef());
-      }
-
+      std::tie(Object, Buffer) = compileModule(*M).takeBinary();
       Objects.push_back(std::move(Object));
       Buffers.push_back(std::move(Buffer));
     }
@@ -90,6 +91,25 @@ public:
     return H;
   }
 
+  /// @brief Compile the given module, or load its object from the object
+  ///        cache, without adding it to the base layer.
+  ///
+  ///   This lets clients compile on one thread and hand the object to the base
+  /// layer on another, or while holding a lock of their own.
+  object::OwningBinary<object::ObjectFile> compileModule(Module &M) {
+    if (ObjCache) {
+      auto Obj = tryToLoadFromObjectCache(M);
+      if (Obj.getBinary())
+        return Obj;
+    }
+
+    auto Obj = Compile(M);
+    if (ObjCache && Obj.getBinary())
+      ObjCache->notifyObjectCompiled(&M,
+                                     Obj.getBinary()->getMemoryBufferRef());
+    return Obj;
+  }
+
   /// @brief Remove the module set associated with the handle H.
   void removeModuleSet(ModuleSetHandleT H) { BaseLayer.removeObjectSet(H); }
 
@@ -22,6 +22,8 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include <list>
+#include <mutex>
+#include <vector>
 
 namespace llvm {
 namespace orc {
@@ -32,6 +34,15 @@ namespace orc {
 /// not immediately emit them the layer below. Instead, emissing to the base
 /// layer is deferred until the first time the client requests the address
 /// (via JITSymbol::getAddress) for a symbol contained in this layer.
+///
+///   All methods may be called concurrently from different threads, as long as
+/// a module set is not removed while it is in use. Each module set is emitted
+/// at most once, with a lock on that set held: other threads that look it up
+/// wait for the emission to finish, while different sets can be emitted
+/// concurrently. No lock of this layer is held while a symbol's address is
+/// resolved in the base layer. The base layer must in turn not look up symbols
+/// while holding a lock that its addModuleSet needs (ObjectLinkingLayer calls
+/// its symbol resolvers without its lock held).
 template <typename BaseLayerT> class LazyEmittingLayer {
 public:
   typedef typename BaseLayerT::ModuleSetHandleT BaseLayerHandleT;
@@ -43,6 +54,7 @@ private:
     virtual ~EmissionDeferredSet() {}
 
     JITSymbol find(StringRef Name, bool ExportedSymbolsOnly, BaseLayerT &B) {
+      std::unique_lock<std::recursive_mutex> Lock(EmitMutex);
       switch (EmitState) {
       case NotEmitted:
         if (auto GV = searchGVs(Name, ExportedSymbolsOnly)) {
@@ -53,14 +65,21 @@ private:
           JITSymbolFlags Flags = JITSymbolBase::flagsFromGlobalValue(*GV);
           auto GetAddress =
             [this, ExportedSymbolsOnly, PName, &B]() -> TargetAddress {
-              if (this->EmitState == Emitting)
-                return 0;
-              else if (this->EmitState == NotEmitted) {
-                this->EmitState = Emitting;
-                Handle = this->emitToBaseLayer(B);
-                this->EmitState = Emitted;
+              BaseLayerHandleT H;
+              {
+                // Only the emitting thread can observe the Emitting state, as
+                // other threads block on the lock until emission is done.
+                std::lock_guard<std::recursive_mutex> Lock(this->EmitMutex);
+                if (this->EmitState == Emitting)
+                  return 0;
+                else if (this->EmitState == NotEmitted) {
+                  this->EmitState = Emitting;
+                  Handle = this->emitToBaseLayer(B);
+                  this->EmitState = Emitted;
+                }
+                H = Handle;
               }
-              auto Sym = B.findSymbolIn(Handle, PName, ExportedSymbolsOnly);
+              auto Sym = B.findSymbolIn(H, PName, ExportedSymbolsOnly);
               return Sym.getAddress();
           };
           return JITSymbol(std::move(GetAddress), Flags);
@@ -72,26 +91,40 @@ private:
         // this module that it would not have found already, so return null from
         // here.
         return nullptr;
-      case Emitted:
-        return B.findSymbolIn(Handle, Name, ExportedSymbolsOnly);
+      case Emitted: {
+        BaseLayerHandleT H = Handle;
+        Lock.unlock();
+        return B.findSymbolIn(H, Name, ExportedSymbolsOnly);
+      }
       }
       llvm_unreachable("Invalid emit-state.");
     }
 
     void removeModulesFromBaseLayer(BaseLayerT &BaseLayer) {
+      std::lock_guard<std::recursive_mutex> Lock(EmitMutex);
       if (EmitState != NotEmitted)
         BaseLayer.removeModuleSet(Handle);
     }
 
     void emitAndFinalize(BaseLayerT &BaseLayer) {
-      assert(EmitState != Emitting &&
-             "Cannot emitAndFinalize while already emitting");
-      if (EmitState == NotEmitted) {
-        EmitState = Emitting;
-        Handle = emitToBaseLayer(BaseLayer);
-        EmitState = Emitted;
+      BaseLayerHandleT H;
+      {
+        std::lock_guard<std::recursive_mutex> Lock(EmitMutex);
+        assert(EmitState != Emitting &&
+               "Cannot emitAndFinalize while already emitting");
+        if (EmitState == NotEmitted) {
+          EmitState = Emitting;
+          Handle = emitToBaseLayer(BaseLayer);
+          EmitState = Emitted;
+        }
+        H = Handle;
       }
-      BaseLayer.emitAndFinalize(Handle);
+      BaseLayer.emitAndFinalize(H);
+    }
+
+    bool isEmitted() {
+      std::lock_guard<std::recursive_mutex> Lock(EmitMutex);
+      return EmitState != NotEmitted;
     }
 
     template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -108,6 +141,9 @@ private:
   private:
     enum { NotEmitted, Emitting, Emitted } EmitState;
     BaseLayerHandleT Handle;
+    // Held while the set is emitted. Recursive, since emission may look up
+    // symbols in this set again on the same thread.
+    std::recursive_mutex EmitMutex;
   };
 
   template <typename ModuleSetT, typename MemoryManagerPtrT,
@@ -220,6 +256,8 @@ private:
 
   BaseLayerT &BaseLayer;
   ModuleSetListT ModuleSetList;
+  // Guards ModuleSetList. Never held while calling into the base layer.
+  std::mutex ListMutex;
 
 public:
   /// @brief Handle to a set of loaded modules.
@@ -234,10 +272,11 @@ public:
   ModuleSetHandleT addModuleSet(ModuleSetT Ms,
                                 MemoryManagerPtrT MemMgr,
                                 SymbolResolverPtrT Resolver) {
-    return ModuleSetList.insert(
-        ModuleSetList.end(),
-        EmissionDeferredSet::create(BaseLayer, std::move(Ms), std::move(MemMgr),
-                                    std::move(Resolver)));
+    auto DeferredSet =
+        EmissionDeferredSet::create(BaseLayer, std::move(Ms),
+                                    std::move(MemMgr), std::move(Resolver));
+    std::lock_guard<std::mutex> Lock(ListMutex);
+    return ModuleSetList.insert(ModuleSetList.end(), std::move(DeferredSet));
   }
 
   /// @brief Remove the module set represented by the given handle.
@@ -246,9 +285,14 @@ public:
   /// both in this layer, and the base layer.
   void removeModuleSet(ModuleSetHandleT H) {
     (*H)->removeModulesFromBaseLayer(BaseLayer);
+    std::lock_guard<std::mutex> Lock(ListMutex);
     ModuleSetList.erase(H);
   }
 
+  /// @brief Return true if the module set represented by the given handle has
+  ///        been emitted to the base layer, or is being emitted.
+  bool isEmitted(ModuleSetHandleT H) { return (*H)->isEmitted(); }
+
   /// @brief Search for the given named symbol.
   /// @param Name The name of the symbol to search for.
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
@@ -261,7 +305,13 @@ public:
     // If not found then search the deferred sets. If any of these contain a
     // definition of 'Name' then they will return a JITSymbol that will emit
     // the corresponding module when the symbol address is requested.
-    for (auto &DeferredSet : ModuleSetList)
+    std::vector<EmissionDeferredSet*> DeferredSets;
+    {
+      std::lock_guard<std::mutex> Lock(ListMutex);
+      for (auto &DeferredSet : ModuleSetList)
+        DeferredSets.push_back(DeferredSet.get());
+    }
+    for (auto *DeferredSet : DeferredSets)
       if (auto Symbol = DeferredSet->find(Name, ExportedSymbolsOnly, BaseLayer))
         return Symbol;
 
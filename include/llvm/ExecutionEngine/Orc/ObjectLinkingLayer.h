@@ -16,10 +16,14 @@
 
 #include "JITSymbol.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include <algorithm>
 #include <list>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace llvm {
 namespace orc {
@@ -27,6 +31,49 @@ namespace orc {
 class ObjectLinkingLayerBase {
 protected:
 
+  /// @brief Symbol resolver that answers RuntimeDyld's queries for one object
+  ///        set from addresses that were looked up in advance.
+  ///
+  ///   The client's resolver may look symbols up in the layers above this one,
+  /// and wait for them to be emitted, so it is called before the layer's lock
+  /// is taken. Anything that was not looked up in advance is forwarded to the
+  /// client's resolver.
+  class PreResolvedSymbols : public RuntimeDyld::SymbolResolver {
+  public:
+    PreResolvedSymbols(RuntimeDyld::SymbolResolver &Resolver)
+        : Resolver(Resolver) {}
+
+    void addSymbol(StringRef Name, RuntimeDyld::SymbolInfo Sym) {
+      Symbols.insert(std::make_pair(Name, Sym));
+    }
+
+    void addSymbolInLogicalDylib(StringRef Name, RuntimeDyld::SymbolInfo Sym) {
+      LogicalDylibSymbols.insert(std::make_pair(Name, Sym));
+    }
+
+    RuntimeDyld::SymbolResolver &getClientResolver() { return Resolver; }
+
+    RuntimeDyld::SymbolInfo findSymbol(const std::string &Name) override {
+      auto I = Symbols.find(Name);
+      if (I != Symbols.end())
+        return I->second;
+      return Resolver.findSymbol(Name);
+    }
+
+    RuntimeDyld::SymbolInfo
+    findSymbolInLogicalDylib(const std::string &Name) override {
+      auto I = LogicalDylibSymbols.find(Name);
+      if (I != LogicalDylibSymbols.end())
+        return I->second;
+      return Resolver.findSymbolInLogicalDylib(Name);
+    }
+
+  private:
+    RuntimeDyld::SymbolResolver &Resolver;
+    StringMap<RuntimeDyld::SymbolInfo> Symbols;
+    StringMap<RuntimeDyld::SymbolInfo> LogicalDylibSymbols;
+  };
+
   /// @brief Holds a set of objects to be allocated/linked as a unit in the JIT.
   ///
   /// An instance of this class will be created for each set of objects added
@@ -40,13 +87,30 @@ protected:
   public:
     LinkedObjectSet(RuntimeDyld::MemoryManager &MemMgr,
                     RuntimeDyld::SymbolResolver &Resolver)
-        : RTDyld(llvm::make_unique<RuntimeDyld>(MemMgr, Resolver)),
+        : Symbols(Resolver),
+          RTDyld(llvm::make_unique<RuntimeDyld>(MemMgr, Symbols)),
           State(Raw) {}
 
     virtual ~LinkedObjectSet() {}
 
+    // Look up the common symbols of Obj that loading it will ask about. Must
+    // be called before Obj is added, while the set is not yet shared.
+    void resolveCommonSymbols(const object::ObjectFile &Obj) {
+      for (const auto &Sym : Obj.symbols())
+        if (Sym.getFlags() & object::SymbolRef::SF_Common)
+          if (auto NameOrErr = Sym.getName())
+            Symbols.addSymbolInLogicalDylib(
+              *NameOrErr,
+              Symbols.getClientResolver().findSymbolInLogicalDylib(*NameOrErr));
+    }
+
     std::unique_ptr<RuntimeDyld::LoadedObjectInfo>
     addObject(const object::ObjectFile &Obj) {
+      for (const auto &Sym : Obj.symbols())
+        if (Sym.getFlags() & object::SymbolRef::SF_Undefined)
+          if (auto NameOrErr = Sym.getName())
+            if (!NameOrErr->empty())
+              UndefinedSymbols.push_back(*NameOrErr);
       return RTDyld->loadObject(Obj);
     }
 
@@ -56,7 +120,51 @@ protected:
 
     bool NeedsFinalization() const { return (State == Raw); }
 
-    virtual void Finalize() = 0;
+    /// @brief Return the names of the symbols that finalization will ask the
+    ///        client's resolver for.
+    std::vector<std::string> getExternalSymbols() const {
+      std::vector<std::string> Names;
+      for (const auto &Name : UndefinedSymbols)
+        if (!RTDyld->getSymbol(Name))
+          Names.push_back(Name);
+      return Names;
+    }
+
+    /// @brief Look up the given external symbols through the client's
+    ///        resolver, without touching the state of this set.
+    StringMap<RuntimeDyld::SymbolInfo>
+    resolveExternalSymbols(const std::vector<std::string> &Names) {
+      StringMap<RuntimeDyld::SymbolInfo> Resolved;
+      for (const auto &Name : Names)
+        if (!Resolved.count(Name))
+          Resolved.insert(std::make_pair(
+            Name, Symbols.getClientResolver().findSymbol(Name)));
+      return Resolved;
+    }
+
+    /// @brief Record that the calling thread is looking up this set's external
+    ///        symbols. Returns false if it already is, i.e. if the lookup led
+    ///        back to this set.
+    bool beginResolving() {
+      auto Self = std::this_thread::get_id();
+      if (std::find(ResolvingThreads.begin(), ResolvingThreads.end(), Self) !=
+          ResolvingThreads.end())
+        return false;
+      ResolvingThreads.push_back(Self);
+      return true;
+    }
+
+    void endResolving() {
+      ResolvingThreads.erase(std::find(ResolvingThreads.begin(),
+                                       ResolvingThreads.end(),
+                                       std::this_thread::get_id()));
+    }
+
+    void Finalize(const StringMap<RuntimeDyld::SymbolInfo> &Resolved) {
+      for (const auto &KV : Resolved)
+        Symbols.addSymbol(KV.first(), KV.second);
+      doFinalize();
+    }
 
     void mapSectionAddress(const void *LocalAddress, TargetAddress TargetAddr) {
       assert((State != Finalized) &&
@@ -69,6 +177,9 @@ protected:
     }
 
   protected:
+    virtual void doFinalize() = 0;
+
+    PreResolvedSymbols Symbols;
     std::unique_ptr<RuntimeDyld> RTDyld;
     enum { Raw, Finalizing, Finalized } State;
 
@@ -76,10 +187,21 @@ protected:
     //        wants to be able to inspect the original object when resolving
     //        relocations. As soon as that can be fixed this should be removed.
     std::vector<std::unique_ptr<MemoryBuffer>> OwnedBuffers;
+
+  private:
+    std::vector<std::string> UndefinedSymbols;
+    std::vector<std::thread::id> ResolvingThreads;
   };
 
   typedef std::list<std::unique_ptr<LinkedObjectSet>> LinkedObjectSetListT;
 
+  // Guards the object set list and serializes loading, relocation and
+  // finalization. It is never held while the client's symbol resolvers are
+  // called, except for lookups that were not made in advance (see
+  // PreResolvedSymbols); those may lead back into this layer on the same
+  // thread, hence the recursion.
+  std::recursive_mutex LayerMutex;
+
 public:
   /// @brief Handle to a set of loaded objects.
   typedef LinkedObjectSetListT::iterator ObjSetHandleT;
@@ -89,6 +211,7 @@ public:
   //        referencing the original object.
   template <typename OwningMBSet>
   void takeOwnershipOfBuffers(ObjSetHandleT H, OwningMBSet MBs) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     for (auto &MB : MBs)
       (*H)->takeOwnershipOfBuffer(std::move(MB));
   }
@@ -109,6 +232,14 @@ public:
 /// object files to be loaded into memory, linked, and the addresses of their
 /// symbols queried. All objects added to this layer can see each other's
 /// symbols.
+///
+///   All methods may be called concurrently from different threads, as long
+/// as an object set is not removed while it is in use. Loading, relocation and
+/// finalization are serialized, so the memory managers passed in are only
+/// called with the layer's lock held. The symbol resolvers are called without
+/// it, before an object set is loaded (for its common symbols) or relocated
+/// (for its external symbols), so they may look symbols up in the layers above
+/// this one; they must be safe to call from several threads.
 template <typename NotifyLoadedFtor = DoNothingOnNotifyLoaded>
 class ObjectLinkingLayer : public ObjectLinkingLayerBase {
 private:
@@ -121,7 +252,8 @@ private:
       : LinkedObjectSet(*MemMgr, *Resolver), MemMgr(std::move(MemMgr)),
         Resolver(std::move(Resolver)) { }
 
-    void Finalize() override {
+  protected:
+    void doFinalize() override {
       State = Finalizing;
       RTDyld->resolveRelocations();
       RTDyld->registerEHFrames();
@@ -177,10 +309,13 @@ public:
   ObjSetHandleT addObjectSet(const ObjSetT &Objects,
                              MemoryManagerPtrT MemMgr,
                              SymbolResolverPtrT Resolver) {
+    auto NewLOS = createLinkedObjectSet(std::move(MemMgr), std::move(Resolver));
+    for (auto &Obj : Objects)
+      NewLOS->resolveCommonSymbols(*Obj);
+
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     ObjSetHandleT Handle =
-      LinkedObjSetList.insert(
-        LinkedObjSetList.end(),
-        createLinkedObjectSet(std::move(MemMgr), std::move(Resolver)));
+      LinkedObjSetList.insert(LinkedObjSetList.end(), std::move(NewLOS));
 
     LinkedObjectSet &LOS = **Handle;
     LoadedObjInfoList LoadedObjInfos;
@@ -202,6 +337,7 @@ public:
   /// required to detect or resolve such issues it should be added at a higher
   /// layer.
   void removeObjectSet(ObjSetHandleT H) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     // How do we invalidate the symbols in H?
     LinkedObjSetList.erase(H);
   }
@@ -211,6 +347,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     for (auto I = LinkedObjSetList.begin(), E = LinkedObjSetList.end(); I != E;
          ++I)
       if (auto Symbol = findSymbolIn(I, Name, ExportedSymbolsOnly))
@@ -228,6 +365,7 @@ public:
   ///         given object set.
   JITSymbol findSymbolIn(ObjSetHandleT H, StringRef Name,
                          bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     if (auto Sym = (*H)->getSymbol(Name)) {
       if (Sym.isExported() || !ExportedSymbolsOnly) {
         auto Addr = Sym.getAddress();
@@ -243,11 +381,7 @@ public:
           // functor is called.
           auto GetAddress =
             [this, Addr, H]() {
-              if ((*H)->NeedsFinalization()) {
-                (*H)->Finalize();
-                if (NotifyFinalized)
-                  NotifyFinalized(H);
-              }
+              finalize(H);
               return Addr;
             };
           return JITSymbol(std::move(GetAddress), Flags);
@@ -260,6 +394,7 @@ public:
   /// @brief Map section addresses for the objects associated with the handle H.
   void mapSectionAddress(ObjSetHandleT H, const void *LocalAddress,
                          TargetAddress TargetAddr) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
     (*H)->mapSectionAddress(LocalAddress, TargetAddr);
   }
 
@@ -267,12 +402,40 @@ public:
   ///        given handle.
   /// @param H Handle for object set to emit/finalize.
   void emitAndFinalize(ObjSetHandleT H) {
-    (*H)->Finalize();
+    finalize(H);
+  }
+
+private:
+
+  // Finalize the object set H, unless that has already been done. Its external
+  // symbols are looked up without the layer's lock held. If that lookup leads
+  // back to H on the same thread, H's address is all that is needed, so return
+  // without finalizing.
+  void finalize(ObjSetHandleT H) {
+    LinkedObjectSet &LOS = **H;
+    std::vector<std::string> Names;
+    {
+      std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+      if (!LOS.NeedsFinalization() || !LOS.beginResolving())
+        return;
+      Names = LOS.getExternalSymbols();
+    }
+
+    auto Resolved = LOS.resolveExternalSymbols(Names);
+
+    {
+      std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+      LOS.endResolving();
+      // Another thread may have finalized H in the meantime.
+      if (!LOS.NeedsFinalization())
+        return;
+      LOS.Finalize(Resolved);
+    }
+
     if (NotifyFinalized)
       NotifyFinalized(H);
   }
 
-private:
   LinkedObjectSetListT LinkedObjSetList;
   NotifyLoadedFtor NotifyLoaded;
   NotifyFinalizedFtor NotifyFinalized;
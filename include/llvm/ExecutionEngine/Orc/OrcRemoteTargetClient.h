@@ -0,0 +1,224 @@
+//===- OrcRemoteTargetClient.h - Orc Remote-target Client -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the OrcRemoteTargetClient class and its memory manager, which JIT
+// code into another process running an OrcRemoteTargetServer.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETCLIENT_H
+#define LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETCLIENT_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/ExecutionEngine/Orc/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetRPCAPI.h"
+#include "llvm/ExecutionEngine/Orc/RPCChannel.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/ErrorOr.h"
+#include <memory>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+/// Drives an OrcRemoteTargetServer at the other end of an RPCChannel.
+///
+/// Requests without a result (writing, protecting and releasing memory) are
+/// only queued, and go out together with the next request that needs an
+/// answer, so that loading an object and running its code costs few round
+/// trips.  Symbol addresses are cached for the lifetime of the client.
+///
+/// The client is not thread-safe: its users must serialize calls to it.
+class OrcRemoteTargetClient : public OrcRemoteTargetRPCAPI {
+public:
+  /// A memory manager that lays out the sections of each object in the
+  /// executor's memory.  Sections are built up locally and mapped to remote
+  /// addresses once the object has been loaded; finalizeMemory copies them
+  /// over and applies their permissions.
+  ///
+  /// It can be used both with MCJIT and with Orc's ObjectLinkingLayer, and
+  /// resolves external symbols in the executor.
+  class RCMemoryManager : public RTDyldMemoryManager {
+  public:
+    RCMemoryManager(OrcRemoteTargetClient &Client);
+    ~RCMemoryManager() override;
+
+    uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                                 unsigned SectionID,
+                                 StringRef SectionName) override;
+
+    uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                                 unsigned SectionID, StringRef SectionName,
+                                 bool IsReadOnly) override;
+
+    using RTDyldMemoryManager::notifyObjectLoaded;
+    void notifyObjectLoaded(RuntimeDyld &Dyld,
+                            const object::ObjectFile &Obj) override;
+
+    bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+    uint64_t getSymbolAddress(const std::string &Name) override;
+
+    // FIXME: Register EH frames in the executor.
+    void registerEHFrames(uint8_t *Addr, uint64_t LoadAddr,
+                          size_t Size) override {}
+    void deregisterEHFrames(uint8_t *Addr, uint64_t LoadAddr,
+                            size_t Size) override {}
+
+  private:
+    /// A section, built up locally before it is copied to the executor.
+    class Alloc {
+    public:
+      Alloc(uint64_t Size, unsigned Align)
+          : Size(Size), Align(Align ? Align : 1),
+            Contents(new char[Size + this->Align - 1]()), RemoteAddr(0) {}
+
+      Alloc(Alloc &&Other)
+          : Size(Other.Size), Align(Other.Align),
+            Contents(std::move(Other.Contents)),
+            RemoteAddr(Other.RemoteAddr) {}
+
+      Alloc &operator=(Alloc &&Other) {
+        Size = Other.Size;
+        Align = Other.Align;
+        Contents = std::move(Other.Contents);
+        RemoteAddr = Other.RemoteAddr;
+        return *this;
+      }
+
+      uint64_t getSize() const { return Size; }
+      unsigned getAlign() const { return Align; }
+
+      char *getLocalAddress() const {
+        uintptr_t LocalAddr = reinterpret_cast<uintptr_t>(Contents.get());
+        return reinterpret_cast<char *>(RoundUpToAlignment(LocalAddr, Align));
+      }
+
+      void setRemoteAddress(TargetAddress Addr) { RemoteAddr = Addr; }
+      TargetAddress getRemoteAddress() const { return RemoteAddr; }
+
+    private:
+      uint64_t Size;
+      unsigned Align;
+      std::unique_ptr<char[]> Contents;
+      TargetAddress RemoteAddr;
+    };
+
+    /// Sections sharing the same permissions, laid out contiguously in the
+    /// executor.
+    struct Segment {
+      Segment(unsigned Flags) : Flags(Flags), RemoteAddr(0), Size(0) {}
+      std::vector<Alloc> Allocs;
+      unsigned Flags;
+      TargetAddress RemoteAddr;
+      uint64_t Size;
+    };
+
+    /// The sections of one object.
+    struct ObjectAllocs {
+      ObjectAllocs();
+      Segment Code, ROData, RWData;
+    };
+
+    uint8_t *allocate(Segment &Seg, uintptr_t Size, unsigned Alignment);
+
+    OrcRemoteTargetClient &Client;
+    std::unique_ptr<ObjectAllocs> Unmapped;
+    std::vector<std::unique_ptr<ObjectAllocs>> Unfinalized;
+    // The local copies stay alive because RuntimeDyld keeps pointers to them.
+    std::vector<std::unique_ptr<ObjectAllocs>> Finalized;
+    std::vector<TargetAddress> Reservations;
+  };
+
+  /// Create a client for the server at the other end of \p Channel and fetch
+  /// the description of the executor.
+  static ErrorOr<std::unique_ptr<OrcRemoteTargetClient>>
+  Create(RPCChannel &Channel);
+
+  ~OrcRemoteTargetClient();
+
+  /// The triple of the executor process.
+  const Triple &getTargetTriple() const { return TargetTriple; }
+
+  /// The size of a pointer in the executor.
+  unsigned getPointerSize() const { return PointerSize; }
+
+  /// The page size of the executor.
+  unsigned getPageSize() const { return PageSize; }
+
+  /// Look up \p Name in the executor.  \p Addr is set to zero if the symbol
+  /// is not found.
+  std::error_code getSymbolAddress(TargetAddress &Addr, StringRef Name);
+
+  /// Ask for the addresses of \p Names without waiting for the answer, which
+  /// is picked up along with the next response.  Later lookups of these
+  /// names are then answered from the cache.
+  std::error_code queueSymbolLookups(ArrayRef<std::string> Names);
+
+  /// Reserve \p Size bytes of page-aligned, writable memory in the executor.
+  std::error_code reserveMem(TargetAddress &Addr, uint64_t Size);
+
+  /// Queue a copy of \p Size bytes at \p Src to \p Addr in the executor.
+  std::error_code writeMem(TargetAddress Addr, const char *Src, uint64_t Size);
+
+  /// Queue a change of the permissions of the pages at \p Addr to \p Flags, a
+  /// combination of sys::Memory::ProtectionFlags.
+  std::error_code setProtections(TargetAddress Addr, uint64_t Size,
+                                 unsigned Flags);
+
+  /// Queue the release of the memory reserved at \p Addr.
+  std::error_code releaseMem(TargetAddress Addr);
+
+  /// Send all queued requests and wait until they have been carried out.
+  /// Returns the first error any of them ran into.
+  std::error_code sync();
+
+  /// Call the function at \p Addr, which has type int(void).
+  std::error_code callIntVoid(int &Result, TargetAddress Addr);
+
+  /// Call the function at \p Addr, which has type int(int, char*[]), with the
+  /// arguments \p Args.
+  std::error_code callMain(int &Result, TargetAddress Addr,
+                           ArrayRef<std::string> Args);
+
+  /// End the session.  The server exits its loop once it has carried out the
+  /// queued requests, and any further request fails.
+  std::error_code terminateSession();
+
+private:
+  OrcRemoteTargetClient(RPCChannel &Channel);
+  OrcRemoteTargetClient(const OrcRemoteTargetClient&) = delete;
+  void operator=(const OrcRemoteTargetClient&) = delete;
+
+  std::error_code startRequest(JITProcId Id);
+  std::error_code readResponse(JITProcId Id);
+  std::error_code readSymbolAddresses(ArrayRef<std::string> Names);
+  std::error_code waitForResponse(JITProcId Id);
+
+  RPCChannel &Channel;
+  // Set once the session has ended or broken off.
+  std::error_code SessionError;
+
+  Triple TargetTriple;
+  unsigned PointerSize;
+  unsigned PageSize;
+
+  StringMap<TargetAddress> SymbolCache;
+  // Lookups whose answers have not been read yet, in the order they were
+  // sent.
+  std::vector<std::vector<std::string>> PendingLookups;
+};
+
+} // end namespace remote
+} // end namespace orc
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,86 @@
+//===--- OrcRemoteTargetRPCAPI.h - Orc Remote-target RPC API ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the procedures understood by the Orc remote target server and the
+// layout of their messages.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETRPCAPI_H
+#define LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETRPCAPI_H
+
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+/// The messages exchanged between OrcRemoteTargetClient and
+/// OrcRemoteTargetServer.
+///
+/// Every message starts with its 32-bit procedure id, and every response
+/// continues with a 32-bit status: zero on success, otherwise an errno value
+/// describing why the request failed, in which case the rest of the response
+/// is omitted.
+///
+/// Requests that only update the executor's state (writing and protecting
+/// memory) have no response.  A client can queue any number of them and send
+/// them together with the next request that does have one, such as a call.
+/// If one of them fails, the error is held by the server and returned as the
+/// status of the next response instead of performing that request.
+///
+/// Integers are sent in the host's byte order: the executor is expected to
+/// run on the same machine.  Strings are sent as a 32-bit length followed by
+/// their bytes, and lists of strings as a 32-bit count followed by the
+/// strings.
+///
+///   Request                                 Response
+///   GetRemoteInfo                           Triple, PointerSize(u32),
+///                                           PageSize(u32)
+///   ReserveMem Size(u64)                    Addr(u64)
+///   WriteMem Addr(u64), Size(u64), Bytes    -
+///   SetProtections Addr(u64), Size(u64),    -
+///                  Flags(u32)
+///   ReleaseMem Addr(u64)                    -
+///   GetSymbolAddresses Names                Addrs(u64 per name, 0 if none)
+///   CallIntVoid Addr(u64)                   Result(i32)
+///   CallMain Addr(u64), Args                Result(i32)
+///   Sync                                    -
+///   TerminateSession                        (no response)
+class OrcRemoteTargetRPCAPI {
+public:
+  enum JITProcId : uint32_t {
+    InvalidId = 0,
+    GetRemoteInfoId,
+    GetRemoteInfoResponseId,
+    ReserveMemId,
+    ReserveMemResponseId,
+    WriteMemId,
+    SetProtectionsId,
+    ReleaseMemId,
+    GetSymbolAddressesId,
+    GetSymbolAddressesResponseId,
+    CallIntVoidId,
+    CallIntVoidResponseId,
+    CallMainId,
+    CallMainResponseId,
+    SyncId,
+    SyncResponseId,
+    TerminateSessionId
+  };
+
+  /// Return the name of \p Id, for debugging output.
+  static const char *getJITProcIdName(JITProcId Id);
+};
+
+} // end namespace remote
+} // end namespace orc
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,97 @@
+//===- OrcRemoteTargetServer.h - Orc Remote-target Server -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the OrcRemoteTargetServer class, which executes JITed code on behalf
+// of an OrcRemoteTargetClient in another process.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETSERVER_H
+#define LLVM_EXECUTIONENGINE_ORC_ORCREMOTETARGETSERVER_H
+
+#include "llvm/ExecutionEngine/Orc/JITSymbol.h"
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetRPCAPI.h"
+#include "llvm/ExecutionEngine/Orc/RPCChannel.h"
+#include "llvm/Support/Memory.h"
+#include <functional>
+#include <map>
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+/// Serves the requests of an OrcRemoteTargetClient: reserves and fills memory
+/// for JITed code, looks up symbols, and calls functions, all in this process.
+///
+/// Memory is only written and protected within blocks the client reserved,
+/// and all of it is released when the server is destroyed.
+class OrcRemoteTargetServer : public OrcRemoteTargetRPCAPI {
+public:
+  typedef std::function<TargetAddress(const std::string &Name)>
+      SymbolLookupFtor;
+
+  /// Create a server for the client at the other end of \p Channel.  Symbol
+  /// lookups are answered by \p SymbolLookup, or by
+  /// RTDyldMemoryManager::getSymbolAddressInProcess if it is empty; in that
+  /// case the process should have called
+  /// sys::DynamicLibrary::LoadLibraryPermanently(nullptr) to make its own
+  /// symbols visible.
+  OrcRemoteTargetServer(RPCChannel &Channel,
+                        SymbolLookupFtor SymbolLookup = SymbolLookupFtor());
+  ~OrcRemoteTargetServer();
+
+  /// Handle requests until the client terminates the session.  Returns the
+  /// error that broke the session off early, if any.
+  std::error_code run();
+
+  /// Read the id of the next request.
+  std::error_code getNextProcId(JITProcId &Id);
+
+  /// Read the arguments of the request \p Id and handle it.
+  std::error_code handleKnownProcedure(JITProcId Id);
+
+private:
+  OrcRemoteTargetServer(const OrcRemoteTargetServer&) = delete;
+  void operator=(const OrcRemoteTargetServer&) = delete;
+
+  std::error_code handleGetRemoteInfo();
+  std::error_code handleReserveMem();
+  std::error_code handleWriteMem();
+  std::error_code handleSetProtections();
+  std::error_code handleReleaseMem();
+  std::error_code handleGetSymbolAddresses();
+  std::error_code handleCallIntVoid();
+  std::error_code handleCallMain();
+  std::error_code handleSync();
+
+  /// Start a successful response \p Id; its payload follows.
+  std::error_code startResponse(JITProcId Id);
+
+  /// Send a response \p Id that reports the failure \p Err.
+  std::error_code respondWithError(JITProcId Id, std::error_code Err);
+
+  /// Return true if [Addr, Addr + Size) lies within a reserved block.
+  bool isReserved(TargetAddress Addr, uint64_t Size) const;
+
+  RPCChannel &Channel;
+  SymbolLookupFtor SymbolLookup;
+
+  // Blocks reserved by the client, keyed by their start address.
+  std::map<TargetAddress, sys::MemoryBlock> Allocs;
+
+  // The first failure of a request without a response, held for the next
+  // response.
+  std::error_code PendingError;
+};
+
+} // end namespace remote
+} // end namespace orc
+} // end namespace llvm
+
+#endif
@@ -0,0 +1,100 @@
+//===- llvm/ExecutionEngine/Orc/RPCChannel.h - Byte stream for RPC -*- C++ -*-//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the RPCChannel interface used by the Orc remote target client and
+// server, the helpers that serialize values onto it, and an implementation
+// over a pair of file descriptors.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_RPCCHANNEL_H
+#define LLVM_EXECUTIONENGINE_ORC_RPCCHANNEL_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+/// Interface for a bidirectional byte stream.
+///
+/// Written bytes are buffered until send() is called, so that a client can
+/// batch several requests into a single write and round trip.
+class RPCChannel {
+public:
+  virtual ~RPCChannel();
+
+  /// Read exactly \p Size bytes into \p Dst, blocking until they arrive.
+  virtual std::error_code readBytes(char *Dst, size_t Size) = 0;
+
+  /// Queue \p Size bytes from \p Src to be written on the next send().
+  virtual std::error_code appendBytes(const char *Src, size_t Size) = 0;
+
+  /// Write out everything queued by appendBytes.
+  virtual std::error_code send() = 0;
+};
+
+/// Serialize an integer.  Both ends of a channel are assumed to agree on
+/// endianness.
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, std::error_code>::type
+serialize(RPCChannel &C, T V) {
+  return C.appendBytes(reinterpret_cast<const char *>(&V), sizeof(T));
+}
+
+/// Deserialize an integer.
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value, std::error_code>::type
+deserialize(RPCChannel &C, T &V) {
+  return C.readBytes(reinterpret_cast<char *>(&V), sizeof(T));
+}
+
+/// Serialize a string as its 32-bit length followed by its bytes.
+std::error_code serialize(RPCChannel &C, StringRef S);
+
+/// Deserialize a string written by serialize(RPCChannel&, StringRef).
+std::error_code deserialize(RPCChannel &C, std::string &S);
+
+/// Serialize a list of strings as its 32-bit length followed by its elements.
+std::error_code serialize(RPCChannel &C, ArrayRef<std::string> Strings);
+
+/// Deserialize a list written by serialize(RPCChannel&, ArrayRef<std::string>).
+std::error_code deserialize(RPCChannel &C, std::vector<std::string> &Strings);
+
+/// RPC channel over a pair of file descriptors, typically the ends of two
+/// pipes.  Reads are buffered as well as writes, so that a batch of small
+/// requests costs a single system call on each side.
+class FDRPCChannel : public RPCChannel {
+public:
+  /// Create a channel reading from \p InFD and writing to \p OutFD.  The
+  /// descriptors are not closed by the channel.
+  FDRPCChannel(int InFD, int OutFD);
+  ~FDRPCChannel() override;
+
+  std::error_code readBytes(char *Dst, size_t Size) override;
+  std::error_code appendBytes(const char *Src, size_t Size) override;
+  std::error_code send() override;
+
+private:
+  int InFD, OutFD;
+  std::vector<char> InBuffer;
+  size_t InPos;
+  std::vector<char> OutBuffer;
+};
+
+} // end namespace remote
+} // end namespace orc
+} // end namespace llvm
+
+#endif
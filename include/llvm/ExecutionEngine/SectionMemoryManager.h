@@ -19,8 +19,61 @@
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Mutex.h"
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace llvm {
+
+/// A source of page-aligned, read-write memory for section memory managers.
+///
+/// The pool maps memory in slabs and hands out runs of whole pages, so that
+/// many small allocations share one mapping.  Pages given back when a memory
+/// manager is destroyed are made read-write again and reused by later
+/// allocations.  Slabs that become entirely free are unmapped once the pool
+/// holds more than a given number of free bytes.
+///
+/// A pool may be shared by any number of memory managers, including managers
+/// used on different threads, and must outlive all of them.  Sharing one pool
+/// lets a long-running JIT that keeps adding and removing modules recycle the
+/// memory of removed modules instead of mapping new memory for every module.
+class SectionMemoryPool {
+  SectionMemoryPool(const SectionMemoryPool&) = delete;
+  void operator=(const SectionMemoryPool&) = delete;
+
+public:
+  /// \p SlabSize is the minimum size of each mapping made by the pool, and
+  /// \p MaxFreeBytes the amount of free memory the pool keeps mapped for reuse.
+  explicit SectionMemoryPool(size_t SlabSize = 1024 * 1024,
+                             size_t MaxFreeBytes = 16 * 1024 * 1024);
+  ~SectionMemoryPool();
+
+  /// \brief Allocate a run of at least \p Size bytes of read-write memory,
+  /// rounded up to whole pages.
+  sys::MemoryBlock allocate(size_t Size, std::error_code &EC);
+
+  /// \brief Give a run of pages obtained from allocate() back to the pool.
+  void release(sys::MemoryBlock Block);
+
+  /// \brief Return the number of bytes currently mapped by the pool.
+  size_t getMappedBytes() const;
+
+private:
+  std::map<uintptr_t, size_t>::const_iterator findSlab(uintptr_t Addr) const;
+  void unmapFreeSlabs();
+
+  mutable sys::Mutex Lock;
+  size_t SlabSize;
+  size_t MaxFreeBytes;
+  size_t PageSize;
+  size_t FreeBytes;
+  // Mapped slabs, keyed by start address, with their sizes.
+  std::map<uintptr_t, size_t> Slabs;
+  // Free runs of pages, keyed by start address.  Adjacent runs are merged.
+  std::map<uintptr_t, size_t> FreeRuns;
+  sys::MemoryBlock Near;
+};
 /// This is a simple memory manager which implements the methods called by
 /// the RuntimeDyld class to allocate memory for section-based loading of
 /// objects, usually those generated by the MCJIT execution engine.
@@ -34,12 +87,21 @@ namespace llvm {
 /// in the JITed object.  Permissions can be applied either by calling
 /// MCJIT::finalizeObject or by calling SectionMemoryManager::finalizeMemory
 /// directly.  Clients of MCJIT should call MCJIT::finalizeObject.
+///
+/// Memory is taken from a SectionMemoryPool and given back to it when the
+/// memory manager is destroyed.  Each call to finalizeMemory only changes the
+/// permissions of the memory allocated since the previous call, and the
+/// unused remainder of a code or read-only data block stays available to
+/// later allocations, as long as it does not share a page with finalized
+/// memory.
 class SectionMemoryManager : public RTDyldMemoryManager {
   SectionMemoryManager(const SectionMemoryManager&) = delete;
   void operator=(const SectionMemoryManager&) = delete;
 
 public:
-  SectionMemoryManager() { }
+  /// \brief Create a memory manager that allocates from \p Pool, or from a
+  /// pool of its own if \p Pool is null.
+  explicit SectionMemoryManager(SectionMemoryPool *Pool = nullptr);
   ~SectionMemoryManager() override;
 
   /// \brief Allocates a memory block of (at least) the given size suitable for
@@ -86,7 +148,8 @@ private:
   struct MemoryGroup {
       SmallVector<sys::MemoryBlock, 16> AllocatedMem;
       SmallVector<sys::MemoryBlock, 16> FreeMem;
-      sys::MemoryBlock Near;
+      // Memory handed out since the last call to finalizeMemory.
+      SmallVector<sys::MemoryBlock, 16> PendingMem;
   };
 
   uint8_t *allocateSection(MemoryGroup &MemGroup, uintptr_t Size,
@@ -95,6 +158,8 @@ private:
   std::error_code applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                               unsigned Permissions);
 
+  std::unique_ptr<SectionMemoryPool> OwnedPool;
+  SectionMemoryPool *Pool;
   MemoryGroup CodeMem;
   MemoryGroup RWDataMem;
   MemoryGroup RODataMem;
@@ -303,6 +303,8 @@ void initializePlaceSafepointsPass(PassRegistry&);
 void initializeDwarfEHPreparePass(PassRegistry&);
 void initializeFloat2IntPass(PassRegistry&);
 void initializeLoopDistributePass(PassRegistry&);
+void initializeLoopFusionPass(PassRegistry&);
+void initializeLoopTilingPass(PassRegistry&);
 void initializeSjLjEHPreparePass(PassRegistry&);
 }
 
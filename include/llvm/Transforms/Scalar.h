@@ -486,6 +486,18 @@ FunctionPass *createNaryReassociatePass();
 //
 FunctionPass *createLoopDistributePass();
 
+//===----------------------------------------------------------------------===//
+//
+// LoopFusion - Fuse adjacent loops with the same trip count.
+//
+FunctionPass *createLoopFusionPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopTiling - Tile perfect loop nests for cache locality.
+//
+FunctionPass *createLoopTilingPass();
+
 } // End llvm namespace
 
 #endif
@@ -20,17 +20,25 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+static cl::opt<unsigned>
+    SaturationThreshold("alias-set-saturation-threshold", cl::Hidden,
+                        cl::init(250),
+                        cl::desc("The maximum number of pointers may-alias "
+                                 "sets may contain before degradation"));
+
 /// mergeSetIn - Merge the specified alias set into this alias set.
 ///
 void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
   assert(!AS.Forward && "Alias set is already forwarding!");
   assert(!Forward && "This set is a forwarding set!!");
 
+  bool WasMustAlias = (Alias == SetMustAlias);
   // Update the alias and access types of this set...
   Access |= AS.Access;
   Alias  |= AS.Alias;
@@ -51,6 +59,13 @@ void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
       Alias = SetMayAlias;
   }
 
+  if (Alias == SetMayAlias) {
+    if (WasMustAlias)
+      AST.TotalMayAliasSetSize += size();
+    if (AS.Alias == SetMustAlias)
+      AST.TotalMayAliasSetSize += AS.size();
+  }
+
   bool ASHadUnknownInsts = !AS.UnknownInsts.empty();
   if (UnknownInsts.empty()) {            // Merge call sites...
     if (ASHadUnknownInsts) {
@@ -67,6 +82,8 @@ void AliasSet::mergeSetIn(AliasSet &AS, AliasSetTracker &AST) {
 
   // Merge the list of constituent pointers...
   if (AS.PtrList) {
+    SetSize += AS.size();
+    AS.SetSize = 0;
     *PtrListEnd = AS.PtrList;
     AS.PtrList->setPrevInList(PtrListEnd);
     PtrListEnd = AS.PtrListEnd;
@@ -84,6 +101,14 @@ void AliasSetTracker::removeAliasSet(AliasSet *AS) {
     Fwd->dropRef(*this);
     AS->Forward = nullptr;
   }
+
+  if (AS->Alias == AliasSet::SetMayAlias)
+    TotalMayAliasSetSize -= AS->size();
+
+  // The saturated set is the only live one, so the tracker is empty again.
+  if (AS == AliasAnyAS)
+    AliasAnyAS = nullptr;
+
   AliasSets.erase(AS);
 }
 
@@ -104,9 +129,10 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
       AliasResult Result =
           AA.alias(MemoryLocation(P->getValue(), P->getSize(), P->getAAInfo()),
                    MemoryLocation(Entry.getValue(), Size, AAInfo));
-      if (Result != MustAlias)
+      if (Result != MustAlias) {
         Alias = SetMayAlias;
-      else                  // First entry of must alias must have maximum size!
+        AST.TotalMayAliasSetSize += size();
+      } else                // First entry of must alias must have maximum size!
         P->updateSizeAndAAInfo(Size, AAInfo);
       assert(Result != NoAlias && "Cannot be part of must set!");
     }
@@ -119,14 +145,24 @@ void AliasSet::addPointer(AliasSetTracker &AST, PointerRec &Entry,
   *PtrListEnd = &Entry;
   PtrListEnd = Entry.setPrevInList(PtrListEnd);
   assert(*PtrListEnd == nullptr && "End of list is not null?");
-  addRef();               // Entry points to alias set.
+  // Entry points to alias set.
+  addRef();
+
+  ++SetSize;
+  if (Alias == SetMayAlias)
+    AST.TotalMayAliasSetSize++;
 }
 
-void AliasSet::addUnknownInst(Instruction *I, AliasAnalysis &AA) {
+void AliasSet::addUnknownInst(AliasSetTracker &AST, Instruction *I,
+                              AliasAnalysis &AA) {
   if (UnknownInsts.empty())
     addRef();
   UnknownInsts.emplace_back(I);
 
+  // Either way the set becomes may-alias; account for its pointers.
+  if (Alias == SetMustAlias)
+    AST.TotalMayAliasSetSize += size();
+
   if (!I->mayWriteToMemory()) {
     Alias = SetMayAlias;
     Access |= RefAccess;
@@ -144,6 +180,9 @@ void AliasSet::addUnknownInst(Instruction *I, AliasAnalysis &AA) {
 bool AliasSet::aliasesPointer(const Value *Ptr, uint64_t Size,
                               const AAMDNodes &AAInfo,
                               AliasAnalysis &AA) const {
+  if (AliasAny)
+    return true;
+
   if (Alias == SetMustAlias) {
     assert(UnknownInsts.empty() && "Illegal must alias set!");
 
@@ -177,6 +216,9 @@ bool AliasSet::aliasesPointer(const Value *Ptr, uint64_t Size,
 
 bool AliasSet::aliasesUnknownInst(const Instruction *Inst,
                                   AliasAnalysis &AA) const {
+  if (AliasAny)
+    return true;
+
   if (!Inst->mayReadOrWriteMemory())
     return false;
 
@@ -207,6 +249,8 @@ void AliasSetTracker::clear() {
   
   // The alias sets should all be clear now.
   AliasSets.clear();
+  AliasAnyAS = nullptr;
+  TotalMayAliasSetSize = 0;
 }
 
 
@@ -274,6 +318,19 @@ AliasSet &AliasSetTracker::getAliasSetForPointer(Value *Pointer, uint64_t Size,
                                                  bool *New) {
   AliasSet::PointerRec &Entry = getEntryFor(Pointer);
 
+  if (AliasAnyAS) {
+    // The tracker is saturated, so there is only one live alias set and no
+    // alias queries are needed to find it.
+    if (Entry.hasAliasSet()) {
+      Entry.updateSizeAndAAInfo(Size, AAInfo);
+      assert(Entry.getAliasSet(*this) == AliasAnyAS &&
+             "Entry in saturated AST must belong to only alias set");
+    } else {
+      AliasAnyAS->addPointer(*this, Entry, Size, AAInfo);
+    }
+    return *AliasAnyAS;
+  }
+
   // Check to see if the pointer is already known.
   if (Entry.hasAliasSet()) {
     Entry.updateSizeAndAAInfo(Size, AAInfo);
@@ -294,6 +351,54 @@ AliasSet &AliasSetTracker::getAliasSetForPointer(Value *Pointer, uint64_t Size,
   return AliasSets.back();
 }
 
+AliasSet &AliasSetTracker::addPointer(Value *P, uint64_t Size,
+                                     const AAMDNodes &AAInfo,
+                                     AliasSet::AccessLattice E, bool &NewSet) {
+  NewSet = false;
+  AliasSet &AS = getAliasSetForPointer(P, Size, AAInfo, &NewSet);
+  AS.Access |= E;
+
+  if (!AliasAnyAS && TotalMayAliasSetSize > SaturationThreshold) {
+    // The tracker is saturated. From here on, all pointers are conservatively
+    // considered to alias each other.
+    return mergeAllAliasSets();
+  }
+  return AS;
+}
+
+/// mergeAllAliasSets - Collapse every alias set into a single may-alias,
+/// mod/ref set that aliases everything.
+AliasSet &AliasSetTracker::mergeAllAliasSets() {
+  assert(!AliasAnyAS && TotalMayAliasSetSize > SaturationThreshold &&
+         "Full merge should happen once, when the saturation threshold is "
+         "reached");
+
+  // Collect all alias sets first, so that references can be dropped without
+  // invalidating the iteration.
+  std::vector<AliasSet *> ASVector;
+  for (iterator I = begin(), E = end(); I != E; ++I)
+    ASVector.push_back(&*I);
+
+  AliasSets.push_back(new AliasSet());
+  AliasAnyAS = &AliasSets.back();
+  AliasAnyAS->Alias = AliasSet::SetMayAlias;
+  AliasAnyAS->Access = AliasSet::ModRefAccess;
+  AliasAnyAS->AliasAny = true;
+
+  for (AliasSet *Cur : ASVector) {
+    // A forwarding set now forwards to the new set instead.
+    if (AliasSet *FwdTo = Cur->Forward) {
+      Cur->Forward = AliasAnyAS;
+      AliasAnyAS->addRef();
+      FwdTo->dropRef(*this);
+      continue;
+    }
+    AliasAnyAS->mergeSetIn(*Cur, *this);
+  }
+
+  return *AliasAnyAS;
+}
+
 bool AliasSetTracker::add(Value *Ptr, uint64_t Size, const AAMDNodes &AAInfo) {
   bool NewPtr;
   addPointer(Ptr, Size, AAInfo, AliasSet::NoAccess, NewPtr);
@@ -349,14 +454,14 @@ bool AliasSetTracker::addUnknown(Instruction *Inst) {
   if (!Inst->mayReadOrWriteMemory())
     return true; // doesn't alias anything
 
-  AliasSet *AS = findAliasSetForUnknownInst(Inst);
+  AliasSet *AS = AliasAnyAS ? AliasAnyAS : findAliasSetForUnknownInst(Inst);
   if (AS) {
-    AS->addUnknownInst(Inst, AA);
+    AS->addUnknownInst(*this, Inst, AA);
     return false;
   }
   AliasSets.push_back(new AliasSet());
   AS = &AliasSets.back();
-  AS->addUnknownInst(Inst, AA);
+  AS->addUnknownInst(*this, Inst, AA);
   return true;
 }
 
@@ -428,6 +533,10 @@ void AliasSetTracker::remove(AliasSet &AS) {
     PointerMap.erase(ValToRemove);
   }
   
+  if (AS.Alias == AliasSet::SetMayAlias)
+    TotalMayAliasSetSize -= AS.size();
+  AS.SetSize = 0;
+
   // Stop using the alias set, removing it.
   AS.RefCount -= NumRefs;
   if (AS.RefCount == 0)
@@ -531,7 +640,11 @@ void AliasSetTracker::deleteValue(Value *PtrVal) {
 
   // Unlink and delete from the list of values.
   PtrValEnt->eraseFromList();
-  
+
+  AS->SetSize--;
+  if (AS->Alias == AliasSet::SetMayAlias)
+    TotalMayAliasSetSize--;
+
   // Stop using the alias set.
   AS->dropRef(*this);
   
@@ -570,6 +683,8 @@ void AliasSetTracker::copyValue(Value *From, Value *To) {
 void AliasSet::print(raw_ostream &OS) const {
   OS << "  AliasSet[" << (const void*)this << ", " << RefCount << "] ";
   OS << (Alias == SetMustAlias ? "must" : "may") << " alias, ";
+  if (AliasAny)
+    OS << "alias any, ";
   switch (Access) {
   case NoAccess:     OS << "No access "; break;
   case RefAccess:    OS << "Ref       "; break;
@@ -656,6 +771,7 @@ namespace {
     bool runOnFunction(Function &F) override {
       Tracker = new AliasSetTracker(getAnalysis<AliasAnalysis>());
 
+      errs() << "Alias sets for function '" << F.getName() << "':\n";
       for (inst_iterator I = inst_begin(F), E = inst_end(F); I != E; ++I)
         Tracker->add(&*I);
       Tracker->print(errs());
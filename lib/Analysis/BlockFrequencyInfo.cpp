@@ -130,6 +130,13 @@ void BlockFrequencyInfo::getAnalysisUsage(AnalysisUsage &AU) const {
 bool BlockFrequencyInfo::runOnFunction(Function &F) {
   BranchProbabilityInfo &BPI = getAnalysis<BranchProbabilityInfo>();
   LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  calculate(F, BPI, LI);
+  return false;
+}
+
+void BlockFrequencyInfo::calculate(const Function &F,
+                                   const BranchProbabilityInfo &BPI,
+                                   const LoopInfo &LI) {
   if (!BFI)
     BFI.reset(new ImplType);
   BFI->doFunction(&F, &BPI, &LI);
@@ -137,7 +144,6 @@ bool BlockFrequencyInfo::runOnFunction(Function &F) {
   if (ViewBlockFreqPropagationDAG != GVDT_None)
     view();
 #endif
-  return false;
 }
 
 void BlockFrequencyInfo::releaseMemory() { BFI.reset(); }
@@ -510,10 +510,15 @@ void BranchProbabilityInfo::getAnalysisUsage(AnalysisUsage &AU) const {
 }
 
 bool BranchProbabilityInfo::runOnFunction(Function &F) {
+  calculate(F, getAnalysis<LoopInfoWrapperPass>().getLoopInfo());
+  return false;
+}
+
+void BranchProbabilityInfo::calculate(Function &F, LoopInfo &LoopI) {
   DEBUG(dbgs() << "---- Branch Probability Info : " << F.getName()
                << " ----\n\n");
   LastF = &F; // Store the last function we ran on for printing.
-  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  LI = &LoopI;
   assert(PostDominatedByUnreachable.empty());
   assert(PostDominatedByColdCall.empty());
 
@@ -540,7 +545,6 @@ bool BranchProbabilityInfo::runOnFunction(Function &F) {
 
   PostDominatedByUnreachable.clear();
   PostDominatedByColdCall.clear();
-  return false;
 }
 
 void BranchProbabilityInfo::releaseMemory() {
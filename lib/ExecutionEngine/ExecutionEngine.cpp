@@ -18,6 +18,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
@@ -61,6 +62,8 @@ ExecutionEngine *(*ExecutionEngine::InterpCtor)(std::unique_ptr<Module> M,
 
 void JITEventListener::anchor() {}
 
+void ObjectCache::anchor() {}
+
 ExecutionEngine::ExecutionEngine(std::unique_ptr<Module> M)
   : LazyFunctionCreator(nullptr) {
   CompilingLazily         = false;
@@ -205,6 +208,7 @@ void ExecutionEngine::addGlobalMapping(StringRef Name, uint64_t Addr) {
   assert(!Name.empty() && "Empty GlobalMapping symbol name!");
 
   DEBUG(dbgs() << "JIT: Map \'" << Name  << "\' to [" << Addr << "]\n";);
+  ++GlobalMappingGeneration;
   uint64_t &CurVal = EEState.getGlobalAddressMap()[Name];
   assert((!CurVal || !Addr) && "GlobalMapping already established!");
   CurVal = Addr;
@@ -220,6 +224,7 @@ void ExecutionEngine::addGlobalMapping(StringRef Name, uint64_t Addr) {
 
 void ExecutionEngine::clearAllGlobalMappings() {
   MutexGuard locked(lock);
+  ++GlobalMappingGeneration;
 
   EEState.getGlobalAddressMap().clear();
   EEState.getGlobalAddressReverseMap().clear();
@@ -227,6 +232,7 @@ void ExecutionEngine::clearAllGlobalMappings() {
 
 void ExecutionEngine::clearGlobalMappingsFromModule(Module *M) {
   MutexGuard locked(lock);
+  ++GlobalMappingGeneration;
 
   for (Module::iterator FI = M->begin(), FE = M->end(); FI != FE; ++FI)
     EEState.RemoveMapping(getMangledName(FI));
@@ -243,6 +249,7 @@ uint64_t ExecutionEngine::updateGlobalMapping(const GlobalValue *GV,
 
 uint64_t ExecutionEngine::updateGlobalMapping(StringRef Name, uint64_t Addr) {
   MutexGuard locked(lock);
+  ++GlobalMappingGeneration;
 
   ExecutionEngineState::GlobalAddressMapTy &Map =
     EEState.getGlobalAddressMap();
@@ -0,0 +1,225 @@
+//===- FileSystemObjectCache.cpp - Persistent object cache ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an ObjectCache that keeps compiled objects in a
+// directory on disk.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileSystemObjectCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LockFileManager.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "object-cache"
+
+// Objects are stored as <key>.o in the cache directory.
+static const char ObjectSuffix[] = ".o";
+
+std::string
+FileSystemObjectCache::getConfiguration(const TargetMachine &TM) {
+  std::string Config;
+  raw_string_ostream OS(Config);
+  const TargetOptions &Options = TM.Options;
+  OS << TM.getTargetTriple().str() << '\n' << TM.getTargetCPU() << '\n'
+     << TM.getTargetFeatureString() << '\n' << TM.getOptLevel() << ' '
+     << TM.getRelocationModel() << ' ' << TM.getCodeModel() << ' '
+     << Options.EnableFastISel << Options.UnsafeFPMath
+     << Options.NoInfsFPMath << Options.NoNaNsFPMath
+     << Options.LessPreciseFPMADOption
+     << Options.HonorSignDependentRoundingFPMathOption
+     << Options.GuaranteedTailCallOpt << Options.PositionIndependentExecutable
+     << Options.UseInitArray << Options.FunctionSections
+     << Options.DataSections << Options.TrapUnreachable << Options.EmulatedTLS
+     << ' ' << Options.StackAlignmentOverride << ' ' << Options.FloatABIType
+     << ' ' << Options.AllowFPOpFusion << ' ' << Options.ThreadModel;
+  return OS.str();
+}
+
+FileSystemObjectCache::FileSystemObjectCache(StringRef CacheDir,
+                                             const TargetMachine &TM,
+                                             uint64_t MaxSizeInBytes)
+    : CacheDir(CacheDir), TM(&TM), MaxSizeInBytes(MaxSizeInBytes) {}
+
+FileSystemObjectCache::FileSystemObjectCache(StringRef CacheDir,
+                                             StringRef Configuration,
+                                             uint64_t MaxSizeInBytes)
+    : CacheDir(CacheDir), TM(nullptr), Configuration(Configuration),
+      MaxSizeInBytes(MaxSizeInBytes) {}
+
+FileSystemObjectCache::~FileSystemObjectCache() {}
+
+std::string FileSystemObjectCache::getKey(const Module &M) const {
+  SmallVector<char, 0> Bitcode;
+  raw_svector_ostream OS(Bitcode);
+  WriteBitcodeToFile(&M, OS);
+  OS.flush();
+
+  MD5 Hash;
+  Hash.update(LLVM_VERSION_STRING);
+  Hash.update(TM ? getConfiguration(*TM) : Configuration);
+  Hash.update(ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(Bitcode.data()), Bitcode.size()));
+  MD5::MD5Result Result;
+  Hash.final(Result);
+
+  SmallString<32> Key;
+  MD5::stringifyResult(Result, Key);
+  return Key.str();
+}
+
+std::string FileSystemObjectCache::getObjectPath(StringRef Key) const {
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, Twine(Key) + ObjectSuffix);
+  return Path.str();
+}
+
+std::unique_ptr<MemoryBuffer>
+FileSystemObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  std::string Path = getObjectPath(Key);
+  int FD;
+  if (sys::fs::openFileForRead(Path, FD)) {
+    DEBUG(dbgs() << "Object cache miss for '" << M->getModuleIdentifier()
+                 << "' (" << Key << ")\n");
+    MutexGuard Guard(Lock);
+    PendingKeys[M] = Key;
+    return nullptr;
+  }
+
+  // M won't be compiled, so forget any key left from an earlier lookup.
+  {
+    MutexGuard Guard(Lock);
+    PendingKeys.erase(M);
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer =
+      MemoryBuffer::getOpenFile(FD, Path, /*FileSize=*/-1,
+                                /*RequiresNullTerminator=*/false);
+  // Mark the object as recently used for eviction.
+  if (Buffer)
+    sys::fs::setLastModificationAndAccessTime(FD, sys::TimeValue::now());
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  if (!Buffer)
+    return nullptr;
+
+  DEBUG(dbgs() << "Object cache hit for '" << M->getModuleIdentifier()
+               << "' (" << Key << ")\n");
+  // The caller may modify the buffer, so hand it a copy.
+  return MemoryBuffer::getMemBufferCopy((*Buffer)->getBuffer(),
+                                        (*Buffer)->getBufferIdentifier());
+}
+
+void FileSystemObjectCache::notifyObjectCompiled(const Module *M,
+                                                 MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    MutexGuard Guard(Lock);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  if (sys::fs::create_directories(CacheDir))
+    return;
+
+  std::string Path = getObjectPath(Key);
+
+  // If another process is writing the same object, let it finish the job.
+  LockFileManager Locked(Path);
+  if (Locked == LockFileManager::LFS_Shared)
+    return;
+
+  // Write to a temporary file and rename it into place, so readers never see
+  // a partially written object.
+  int TempFD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(Path + ".tmp-%%%%%%%%", TempFD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(TempFD, /*shouldClose=*/true);
+    OS << Obj.getBuffer();
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return;
+  }
+
+  DEBUG(dbgs() << "Cached object for '" << M->getModuleIdentifier() << "' ("
+               << Key << ", " << Obj.getBufferSize() << " bytes)\n");
+
+  if (MaxSizeInBytes)
+    prune();
+}
+
+void FileSystemObjectCache::prune() {
+  if (!MaxSizeInBytes)
+    return;
+
+  struct CachedObject {
+    std::string Path;
+    sys::TimeValue LastUse;
+    uint64_t Size;
+  };
+  std::vector<CachedObject> Objects;
+  uint64_t TotalSize = 0;
+
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    if (!StringRef(I->path()).endswith(ObjectSuffix))
+      continue;
+    sys::fs::file_status Status;
+    if (I->status(Status) || !sys::fs::is_regular_file(Status))
+      continue;
+    Objects.push_back(
+        {I->path(), Status.getLastModificationTime(), Status.getSize()});
+    TotalSize += Status.getSize();
+  }
+
+  if (TotalSize <= MaxSizeInBytes)
+    return;
+
+  std::sort(Objects.begin(), Objects.end(),
+            [](const CachedObject &A, const CachedObject &B) {
+              return A.LastUse < B.LastUse;
+            });
+  for (const auto &Object : Objects) {
+    if (TotalSize <= MaxSizeInBytes)
+      break;
+    // Another process may have removed the file already.
+    sys::fs::remove(Object.Path);
+    TotalSize -= Object.Size;
+    DEBUG(dbgs() << "Evicted " << Object.Path << " from the object cache\n");
+  }
+}
@@ -39,8 +39,22 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //                     Various Helper Functions
 //===----------------------------------------------------------------------===//
 
+static void SetSlot(unsigned Slot, GenericValue Val, ExecutionContext &SF) {
+  if (Slot >= SF.Values.size())
+    SF.Values.resize(Slot + 1);
+  SF.Values[Slot] = std::move(Val);
+}
+
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  // The result of the instruction being executed has its slot decoded.
+  if (SF.CurIndex != FunctionInfo::NoIndex) {
+    const FunctionInfo::DecodedInst &D = SF.Info->Insts[SF.CurIndex];
+    if (D.I == V && D.Slot != FunctionInfo::NoIndex) {
+      SetSlot(D.Slot, std::move(Val), SF);
+      return;
+    }
+  }
+  SetSlot(SF.Info->getSlot(V), std::move(Val), SF);
 }
 
 //===----------------------------------------------------------------------===//
@@ -932,27 +946,43 @@ void Interpreter::SwitchToNewBasicBlock(BasicBlock *Dest, ExecutionContext &SF){
   SF.CurBB   = Dest;                  // Update CurBB to branch destination
   SF.CurInst = SF.CurBB->begin();     // Update new instruction ptr...
 
+  // The decoded form of the block starts with its PHI nodes.
+  FunctionInfo &Info = *SF.Info;
+  auto Start = Info.BlockStarts.find(Dest);
+  unsigned Index =
+      Start == Info.BlockStarts.end() ? FunctionInfo::NoIndex : Start->second;
+  SF.NextIndex = Index;
+
   if (!isa<PHINode>(SF.CurInst)) return;  // Nothing fancy to do
 
   // Loop over all of the PHI nodes in the current block, reading their inputs.
   std::vector<GenericValue> ResultValues;
 
-  for (; PHINode *PN = dyn_cast<PHINode>(SF.CurInst); ++SF.CurInst) {
+  for (unsigned k = 0; PHINode *PN = dyn_cast<PHINode>(SF.CurInst);
+       ++SF.CurInst, ++k) {
     // Search for the value corresponding to this previous bb...
     int i = PN->getBasicBlockIndex(PrevBB);
     assert(i != -1 && "PHINode doesn't contain entry for predecessor??");
-    Value *IncomingValue = PN->getIncomingValue(i);
 
     // Save the incoming value for this PHI node...
-    ResultValues.push_back(getOperandValue(IncomingValue, SF));
+    if (Index != FunctionInfo::NoIndex && Info.Insts[Index + k].I == PN)
+      ResultValues.push_back(getOperandValue(
+          Info.Operands[Info.Insts[Index + k].FirstOperand + i], SF));
+    else
+      ResultValues.push_back(getOperandValue(PN->getIncomingValue(i), SF));
   }
 
   // Now loop over all of the PHI nodes setting their values...
   SF.CurInst = SF.CurBB->begin();
   for (unsigned i = 0; isa<PHINode>(SF.CurInst); ++SF.CurInst, ++i) {
     PHINode *PN = cast<PHINode>(SF.CurInst);
-    SetValue(PN, ResultValues[i], SF);
+    if (Index != FunctionInfo::NoIndex && Info.Insts[Index + i].I == PN)
+      SetSlot(Info.Insts[Index + i].Slot, ResultValues[i], SF);
+    else
+      SetSlot(Info.getSlot(PN), ResultValues[i], SF);
   }
+  if (Index != FunctionInfo::NoIndex)
+    SF.NextIndex = Index + ResultValues.size();
 }
 
 //===----------------------------------------------------------------------===//
@@ -1101,6 +1131,14 @@ void Interpreter::visitCallSite(CallSite CS) {
         SF.CurInst = me;
         ++SF.CurInst;
       }
+
+      // Decode the function again.  Frames running it find their place in
+      // the new decoded form when they next execute an instruction, and until
+      // then look their values up in the slot map.
+      SF.Info->decode(*SF.CurFunction);
+      for (ExecutionContext &Frame : ECStack)
+        if (Frame.Info == SF.Info)
+          Frame.CurIndex = Frame.NextIndex = FunctionInfo::NoIndex;
       return;
     }
 
@@ -2054,16 +2092,153 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
   return Dest;
 }
 
+// dependsOnGlobalAddress - Return true if the value of C is computed from the
+// address of a global or a block, which may change with the global mappings.
+static bool dependsOnGlobalAddress(const Constant *C) {
+  if (isa<GlobalValue>(C) || isa<BlockAddress>(C))
+    return true;
+  for (const Use &U : C->operands())
+    if (dependsOnGlobalAddress(cast<Constant>(U)))
+      return true;
+  return false;
+}
+
+GenericValue Interpreter::getPooledConstant(unsigned Index,
+                                            ExecutionContext &SF) {
+  // Constants are evaluated once per function.  Those involving a global
+  // address are evaluated again after the global mappings change.
+  unsigned Generation = getGlobalMappingGeneration();
+  const FunctionInfo::PooledConstant &E = SF.Info->Constants[Index];
+  if (E.Evaluated &&
+      (!E.DependsOnGlobal || E.GlobalMappingGeneration == Generation))
+    return E.Val;
+
+  Constant *CPV = const_cast<Constant *>(E.C);
+  GenericValue Result;
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(CPV))
+    Result = getConstantExprValue(CE, SF);
+  else
+    Result = getConstantValue(CPV);
+  // Evaluating a constant expression may have added to the pool.
+  FunctionInfo::PooledConstant &Entry = SF.Info->Constants[Index];
+  Entry.Val = Result;
+  Entry.Evaluated = true;
+  Entry.GlobalMappingGeneration = Generation;
+  return Result;
+}
+
+GenericValue Interpreter::getOperandValue(const FunctionInfo::Operand &Op,
+                                          ExecutionContext &SF) {
+  switch (Op.Kind) {
+  case FunctionInfo::SlotOperand:
+    if (Op.Index < SF.Values.size())
+      return SF.Values[Op.Index];
+    return GenericValue();
+  case FunctionInfo::ConstantOperand:
+    return getPooledConstant(Op.Index, SF);
+  case FunctionInfo::OtherOperand:
+    break;
+  }
+  return getOperandValue(const_cast<Value *>(Op.V), SF);
+}
+
 GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
-  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
-    return getConstantExprValue(CE, SF);
-  } else if (Constant *CPV = dyn_cast<Constant>(V)) {
-    return getConstantValue(CPV);
-  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
-    return PTOGV(getPointerToGlobal(GV));
-  } else {
-    return SF.Values[V];
+  FunctionInfo &Info = *SF.Info;
+  // The operands of the instruction being executed are already resolved.
+  if (SF.CurIndex != FunctionInfo::NoIndex) {
+    const FunctionInfo::DecodedInst &D = Info.Insts[SF.CurIndex];
+    for (unsigned i = D.FirstOperand, e = i + D.NumOperands; i != e; ++i) {
+      const FunctionInfo::Operand &Op = Info.Operands[i];
+      if (Op.V == V && Op.Kind != FunctionInfo::OtherOperand)
+        return getOperandValue(Op, SF);
+    }
   }
+
+  if (Constant *CPV = dyn_cast<Constant>(V))
+    return getPooledConstant(Info.getConstantIndex(CPV), SF);
+
+  unsigned Slot = Info.getSlot(V);
+  if (Slot < SF.Values.size())
+    return SF.Values[Slot];
+  return GenericValue();
+}
+
+//===----------------------------------------------------------------------===//
+//                        Pre-decoding
+//===----------------------------------------------------------------------===//
+
+FunctionInfo::FunctionInfo(const Function &F) {
+  // Number the arguments first so that they occupy the first slots.
+  for (const Argument &A : F.args())
+    getSlot(&A);
+  decode(F);
+}
+
+void FunctionInfo::decode(const Function &F) {
+  Insts.clear();
+  Operands.clear();
+  BlockStarts.clear();
+  for (const BasicBlock &BB : F) {
+    BlockStarts[&BB] = Insts.size();
+    for (const Instruction &I : BB) {
+      DecodedInst D;
+      D.I = &I;
+      D.Slot = I.getType()->isVoidTy() ? NoIndex : getSlot(&I);
+      D.FirstOperand = Operands.size();
+      D.NumOperands = I.getNumOperands();
+      for (const Use &U : I.operands()) {
+        Operand Op;
+        Op.V = U;
+        if (const Constant *C = dyn_cast<Constant>(U)) {
+          Op.Kind = ConstantOperand;
+          Op.Index = getConstantIndex(C);
+        } else if (isa<Argument>(U) || isa<Instruction>(U)) {
+          Op.Kind = SlotOperand;
+          Op.Index = getSlot(U);
+        } else {
+          Op.Kind = OtherOperand;
+          Op.Index = NoIndex;
+        }
+        Operands.push_back(Op);
+      }
+      Insts.push_back(D);
+    }
+  }
+}
+
+unsigned FunctionInfo::getIndex(const Instruction *I) const {
+  auto It = BlockStarts.find(I->getParent());
+  if (It == BlockStarts.end())
+    return NoIndex;
+  unsigned Index = It->second;
+  for (const Instruction &Inst : *I->getParent()) {
+    if (Index >= Insts.size() || Insts[Index].I != &Inst)
+      return NoIndex;
+    if (&Inst == I)
+      return Index;
+    ++Index;
+  }
+  return NoIndex;
+}
+
+unsigned FunctionInfo::getConstantIndex(const Constant *C) {
+  auto Inserted = ConstantIndices.insert(std::make_pair(C, Constants.size()));
+  if (Inserted.second) {
+    PooledConstant E;
+    E.C = C;
+    E.Evaluated = false;
+    E.DependsOnGlobal = dependsOnGlobalAddress(C);
+    E.GlobalMappingGeneration = 0;
+    Constants.push_back(E);
+  }
+  return Inserted.first->second;
+}
+
+FunctionInfo &Interpreter::getFunctionInfo(Function *F) {
+  std::unique_ptr<FunctionInfo> &Info = FunctionInfos[F];
+  if (!Info)
+    Info = llvm::make_unique<FunctionInfo>(*F);
+  return *Info;
 }
 
 //===----------------------------------------------------------------------===//
@@ -2094,16 +2269,19 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
   StackFrame.CurBB     = F->begin();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
 
+  // Look up the slot numbering of F and make room for all of its values.
+  StackFrame.Info = &getFunctionInfo(F);
+  StackFrame.Values.resize(StackFrame.Info->getNumSlots());
+
   // Run through the function arguments and initialize their values...
   assert((ArgVals.size() == F->arg_size() ||
          (ArgVals.size() > F->arg_size() && F->getFunctionType()->isVarArg()))&&
          "Invalid number of values passed to function invocation!");
 
-  // Handle non-varargs arguments...
+  // Handle non-varargs arguments, which occupy the first slots...
   unsigned i = 0;
-  for (Function::arg_iterator AI = F->arg_begin(), E = F->arg_end(); 
-       AI != E; ++AI, ++i)
-    SetValue(AI, ArgVals[i], StackFrame);
+  for (unsigned e = F->arg_size(); i != e; ++i)
+    StackFrame.Values[i] = ArgVals[i];
 
   // Handle varargs arguments...
   StackFrame.VarArgs.assign(ArgVals.begin()+i, ArgVals.end());
@@ -2111,13 +2289,23 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
 
 
 void Interpreter::run() {
+  // Updating the statistic is an atomic operation; do it once at the end.
+  unsigned NumInsts = 0;
   while (!ECStack.empty()) {
     // Interpret a single instruction & increment the "PC".
     ExecutionContext &SF = ECStack.back();  // Current stack frame
     Instruction &I = *SF.CurInst++;         // Increment before execute
 
+    // Find the decoded form of I, which is normally the one after the last.
+    unsigned Index = SF.NextIndex;
+    const std::vector<FunctionInfo::DecodedInst> &Insts = SF.Info->Insts;
+    if (Index >= Insts.size() || Insts[Index].I != &I)
+      Index = SF.Info->getIndex(&I);
+    SF.CurIndex = Index;
+    SF.NextIndex = Index + 1;
+
     // Track the number of dynamic instructions executed.
-    ++NumDynamicInsts;
+    ++NumInsts;
 
     DEBUG(dbgs() << "About to interpret: " << I);
     visit(I);   // Dispatch to one of the visit* methods...
@@ -2127,7 +2315,7 @@ DEBUG(
     if (!isa<CallInst>(I) && !isa<InvokeInst>(I) && 
         I.getType() != Type::VoidTy) {
       dbgs() << "  --> ";
-      const GenericValue &Val = SF.Values[&I];
+      const GenericValue &Val = SF.Values[SF.Info->getSlot(&I)];
       switch (I.getType()->getTypeID()) {
       default: llvm_unreachable("Invalid GenericValue Type");
       case Type::VoidTyID:    dbgs() << "void"; break;
@@ -2144,4 +2332,5 @@ DEBUG(
     });
 #endif
   }
+  NumDynamicInsts += NumInsts;
 }
@@ -65,6 +65,13 @@ Interpreter::~Interpreter() {
   delete IL;
 }
 
+bool Interpreter::removeModule(Module *M) {
+  // The functions of M may be deleted, and their addresses reused.
+  for (Function &F : *M)
+    FunctionInfos.erase(&F);
+  return ExecutionEngine::removeModule(M);
+}
+
 void Interpreter::runAtExitHandlers () {
   while (!AtExitHandlers.empty()) {
     callFunction(AtExitHandlers.back(), None);
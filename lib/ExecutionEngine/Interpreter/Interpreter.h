@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -26,7 +27,6 @@
 namespace llvm {
 
 class IntrinsicLowering;
-struct FunctionInfo;
 template<typename T> class generic_gep_type_iterator;
 class ConstantExpr;
 typedef generic_gep_type_iterator<User::const_op_iterator> gep_type_iterator;
@@ -59,6 +59,68 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// FunctionInfo - The result of pre-decoding a function before it is first
+// executed.  Every argument and instruction is given a dense slot number, so
+// that stack frames can keep their values in a vector instead of a map.  Each
+// instruction is decoded, in program order, into the slot of its result and
+// where each of its operands comes from: a slot, or an entry in the pool of
+// constants the function uses, whose values are computed only once.
+// Constants that refer to the address of a global are recomputed once the
+// global mappings of the execution engine change.
+//
+struct FunctionInfo {
+  enum { NoIndex = ~0U };
+
+  enum OperandKind { SlotOperand, ConstantOperand, OtherOperand };
+  struct Operand {
+    const Value *V;
+    OperandKind Kind;
+    unsigned Index;      // The slot or constant pool entry of V
+  };
+
+  struct DecodedInst {
+    const Instruction *I;
+    unsigned Slot;       // The slot of the result, or NoIndex
+    unsigned FirstOperand, NumOperands;
+  };
+
+  struct PooledConstant {
+    const Constant *C;
+    GenericValue Val;
+    bool Evaluated;
+    bool DependsOnGlobal;
+    unsigned GlobalMappingGeneration;
+  };
+
+  DenseMap<const Value *, unsigned> Slots;
+  DenseMap<const BasicBlock *, unsigned> BlockStarts;
+  std::vector<DecodedInst> Insts;
+  std::vector<Operand> Operands;
+  DenseMap<const Constant *, unsigned> ConstantIndices;
+  std::vector<PooledConstant> Constants;
+
+  explicit FunctionInfo(const Function &F);
+
+  // decode - (Re)build Insts for the current body of F.  Slots already given
+  // out are kept, so that running frames keep their values.
+  void decode(const Function &F);
+
+  // getIndex - Return the index in Insts of I, or NoIndex.
+  unsigned getIndex(const Instruction *I) const;
+
+  unsigned getNumSlots() const { return Slots.size(); }
+
+  // getSlot - Return the slot of V.  Instructions inserted while the function
+  // runs (by intrinsic lowering) are given a slot on first use.
+  unsigned getSlot(const Value *V) {
+    return Slots.insert(std::make_pair(V, Slots.size())).first->second;
+  }
+
+  // getConstantIndex - Return the constant pool entry of C, adding one if
+  // needed.
+  unsigned getConstantIndex(const Constant *C);
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -68,15 +130,23 @@ struct ExecutionContext {
   BasicBlock::iterator  CurInst;    // The next instruction to execute
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  FunctionInfo         *Info;       // Pre-decoded form of CurFunction
+  unsigned              CurIndex;   // Decoded form of the instruction being
+                                    // executed, or FunctionInfo::NoIndex
+  unsigned              NextIndex;  // Decoded form of CurInst
+  ValuePlaneTy          Values;     // LLVM values used in this invocation,
+                                    // indexed by slot
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   AllocaHolder Allocas;            // Track memory allocated by alloca
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr),
+        Info(nullptr), CurIndex(FunctionInfo::NoIndex), NextIndex(0) {}
 
   ExecutionContext(ExecutionContext &&O)
       : CurFunction(O.CurFunction), CurBB(O.CurBB), CurInst(O.CurInst),
-        Caller(O.Caller), Values(std::move(O.Values)),
+        Caller(O.Caller), Info(O.Info), CurIndex(O.CurIndex),
+        NextIndex(O.NextIndex), Values(std::move(O.Values)),
         VarArgs(std::move(O.VarArgs)), Allocas(std::move(O.Allocas)) {}
 
   ExecutionContext &operator=(ExecutionContext &&O) {
@@ -84,6 +154,9 @@ struct ExecutionContext {
     CurBB = O.CurBB;
     CurInst = O.CurInst;
     Caller = O.Caller;
+    Info = O.Info;
+    CurIndex = O.CurIndex;
+    NextIndex = O.NextIndex;
     Values = std::move(O.Values);
     VarArgs = std::move(O.VarArgs);
     Allocas = std::move(O.Allocas);
@@ -106,6 +179,9 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // FunctionInfos - The pre-decoded form of each function executed so far.
+  DenseMap<const Function *, std::unique_ptr<FunctionInfo>> FunctionInfos;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
@@ -124,6 +200,8 @@ public:
   static ExecutionEngine *create(std::unique_ptr<Module> M,
                                  std::string *ErrorStr = nullptr);
 
+  bool removeModule(Module *M) override;
+
   /// run - Start execution with the specified function and arguments.
   ///
   GenericValue runFunction(Function *F,
@@ -217,10 +295,15 @@ private:  // Helper functions
 
   void *getPointerToFunction(Function *F) override { return (void*)F; }
 
+  FunctionInfo &getFunctionInfo(Function *F);
+
   void initializeExecutionEngine() { }
   void initializeExternalFunctions();
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
+  GenericValue getOperandValue(const FunctionInfo::Operand &Op,
+                               ExecutionContext &SF);
+  GenericValue getPooledConstant(unsigned Index, ExecutionContext &SF);
   GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
                                 ExecutionContext &SF);
   GenericValue executeSExtInst(Value *SrcVal, Type *DstTy,
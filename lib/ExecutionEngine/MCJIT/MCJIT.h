@@ -63,8 +63,8 @@ private:
 //
 // It might not be obvious at first glance, but the "remote-mcjit" case in the
 // lli tool does this.  In that case, the intermediate action is taken by the
-// RemoteMemoryManager in response to the notifyObjectLoaded function being
-// called.
+// OrcRemoteTargetClient::RCMemoryManager in response to the notifyObjectLoaded
+// function being called.
 
 class MCJIT : public ExecutionEngine {
   MCJIT(std::unique_ptr<Module> M, std::unique_ptr<TargetMachine> tm,
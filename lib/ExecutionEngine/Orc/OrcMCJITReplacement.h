@@ -20,10 +20,19 @@
 #include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
 #include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
 #include "llvm/Object/Archive.h"
+#include "llvm/Support/MutexGuard.h"
 
 namespace llvm {
 namespace orc {
 
+/// An ExecutionEngine with MCJIT's interface, built from Orc layers.
+///
+/// The engine may be used from several threads. All operations are serialized
+/// by the ExecutionEngine lock, except that generateCodeForModule compiles
+/// without holding it: modules that threads pass to it are compiled
+/// concurrently, each with a TargetMachine of its own, and only their linking
+/// is serialized. Such modules must not share an LLVMContext, and other modules
+/// must not refer to them until generateCodeForModule has returned.
 class OrcMCJITReplacement : public ExecutionEngine {
 
   // OrcMCJITReplacement needs to do a little extra book-keeping to ensure that
@@ -79,6 +88,11 @@ class OrcMCJITReplacement : public ExecutionEngine {
       return ClientMM->notifyObjectLoaded(EE, O);
     }
 
+    void notifyObjectLoaded(RuntimeDyld &RTDyld,
+                            const object::ObjectFile &O) override {
+      return ClientMM->notifyObjectLoaded(RTDyld, O);
+    }
+
     bool finalizeMemory(std::string *ErrMsg = nullptr) override {
       // Each set of objects loaded will be finalized exactly once, but since
       // symbol lookup during relocation may recursively trigger the
@@ -144,12 +158,13 @@ public:
         Resolver(*this), ClientResolver(std::move(ClientResolver)),
         NotifyObjectLoaded(*this), NotifyFinalized(*this),
         ObjectLayer(NotifyObjectLoaded, NotifyFinalized),
-        CompileLayer(ObjectLayer, SimpleCompiler(*this->TM)),
+        CompileLayer(ObjectLayer, ConcurrentIRCompiler(*this->TM)),
         LazyEmitLayer(CompileLayer) {
     setDataLayout(this->TM->getDataLayout());
   }
 
   void addModule(std::unique_ptr<Module> M) override {
+    MutexGuard locked(lock);
 
     // If this module doesn't have a DataLayout attached then attach the
     // default.
@@ -157,18 +172,54 @@ public:
       M->setDataLayout(*getDataLayout());
 
     Modules.push_back(std::move(M));
+    Module *Mod = &*Modules.back();
     std::vector<Module *> Ms;
-    Ms.push_back(&*Modules.back());
-    LazyEmitLayer.addModuleSet(std::move(Ms), &MemMgr, &Resolver);
+    Ms.push_back(Mod);
+    LazyModuleSets[Mod] =
+      LazyEmitLayer.addModuleSet(std::move(Ms), &MemMgr, &Resolver);
+  }
+
+  void generateCodeForModule(Module *M) override {
+    // Take the module away from the lazy emitting layer, unless it has been
+    // emitted already.
+    {
+      MutexGuard locked(lock);
+      auto I = LazyModuleSets.find(M);
+      if (I == LazyModuleSets.end())
+        return;
+      auto H = I->second;
+      LazyModuleSets.erase(I);
+      if (LazyEmitLayer.isEmitted(H))
+        return;
+      LazyEmitLayer.removeModuleSet(H);
+    }
+
+    // Compile without holding the lock, so that modules passed in by
+    // different threads are compiled concurrently.
+    std::unique_ptr<object::ObjectFile> Obj;
+    std::unique_ptr<MemoryBuffer> Buf;
+    std::tie(Obj, Buf) = CompileLayer.compileModule(*M).takeBinary();
+
+    MutexGuard locked(lock);
+    std::vector<std::unique_ptr<object::ObjectFile>> Objs;
+    Objs.push_back(std::move(Obj));
+    auto H =
+      ObjectLayer.addObjectSet(std::move(Objs), &MemMgr, &Resolver);
+
+    std::vector<std::unique_ptr<MemoryBuffer>> Bufs;
+    Bufs.push_back(std::move(Buf));
+    ObjectLayer.takeOwnershipOfBuffers(H, std::move(Bufs));
   }
 
   void addObjectFile(std::unique_ptr<object::ObjectFile> O) override {
+    MutexGuard locked(lock);
     std::vector<std::unique_ptr<object::ObjectFile>> Objs;
     Objs.push_back(std::move(O));
     ObjectLayer.addObjectSet(std::move(Objs), &MemMgr, &Resolver);
   }
 
   void addObjectFile(object::OwningBinary<object::ObjectFile> O) override {
+    MutexGuard locked(lock);
     std::unique_ptr<object::ObjectFile> Obj;
     std::unique_ptr<MemoryBuffer> Buf;
     std::tie(Obj, Buf) = O.takeBinary();
@@ -183,6 +234,7 @@ public:
   }
 
   void addArchive(object::OwningBinary<object::Archive> A) override {
+    MutexGuard locked(lock);
     Archives.push_back(std::move(A));
   }
 
@@ -191,6 +243,7 @@ public:
   }
 
   RuntimeDyld::SymbolInfo findSymbol(StringRef Name) {
+    MutexGuard locked(lock);
     return findMangledSymbol(Mangle(Name));
   }
 
@@ -201,6 +254,7 @@ public:
 
   void mapSectionAddress(const void *LocalAddress,
                          uint64_t TargetAddress) override {
+    MutexGuard locked(lock);
     for (auto &P : UnfinalizedSections)
       if (P.second.count(LocalAddress))
         ObjectLayer.mapSectionAddress(P.first, LocalAddress, TargetAddress);
@@ -231,12 +285,15 @@ public:
                            ArrayRef<GenericValue> ArgValues) override;
 
   void setObjectCache(ObjectCache *NewCache) override {
+    MutexGuard locked(lock);
     CompileLayer.setObjectCache(NewCache);
   }
 
 private:
 
   RuntimeDyld::SymbolInfo findMangledSymbol(StringRef Name) {
+    // Also reached from the linking resolver, with the lock already held.
+    MutexGuard locked(lock);
     if (auto Sym = LazyEmitLayer.findSymbol(Name, false))
       return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
     if (auto Sym = ClientResolver->findSymbol(Name))
@@ -347,6 +404,11 @@ private:
       UnfinalizedSections;
 
   std::vector<object::OwningBinary<object::Archive>> Archives;
+
+  // The lazily emitted module set of each module added, so that
+  // generateCodeForModule can take modules that were not emitted yet away from
+  // the lazy emitting layer.
+  std::map<Module *, LazyEmitLayerT::ModuleSetHandleT> LazyModuleSets;
 };
 
 } // End namespace orc.
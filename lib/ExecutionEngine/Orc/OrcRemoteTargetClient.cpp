@@ -0,0 +1,382 @@
+//===------- OrcRemoteTargetClient.cpp - Orc Remote-target Client ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetClient.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Memory.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "orc-remote"
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+OrcRemoteTargetClient::RCMemoryManager::ObjectAllocs::ObjectAllocs()
+    : Code(sys::Memory::MF_READ | sys::Memory::MF_EXEC),
+      ROData(sys::Memory::MF_READ),
+      RWData(sys::Memory::MF_READ | sys::Memory::MF_WRITE) {}
+
+OrcRemoteTargetClient::RCMemoryManager::RCMemoryManager(
+    OrcRemoteTargetClient &Client)
+    : Client(Client), Unmapped(new ObjectAllocs()) {}
+
+OrcRemoteTargetClient::RCMemoryManager::~RCMemoryManager() {
+  // The releases go out with the client's next request, if there is one.
+  for (TargetAddress Addr : Reservations)
+    Client.releaseMem(Addr);
+}
+
+uint8_t *OrcRemoteTargetClient::RCMemoryManager::allocate(Segment &Seg,
+                                                          uintptr_t Size,
+                                                          unsigned Alignment) {
+  Seg.Allocs.push_back(Alloc(Size, Alignment));
+  return reinterpret_cast<uint8_t *>(Seg.Allocs.back().getLocalAddress());
+}
+
+uint8_t *OrcRemoteTargetClient::RCMemoryManager::allocateCodeSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName) {
+  return allocate(Unmapped->Code, Size, Alignment);
+}
+
+uint8_t *OrcRemoteTargetClient::RCMemoryManager::allocateDataSection(
+    uintptr_t Size, unsigned Alignment, unsigned SectionID,
+    StringRef SectionName, bool IsReadOnly) {
+  return allocate(IsReadOnly ? Unmapped->ROData : Unmapped->RWData, Size,
+                  Alignment);
+}
+
+void OrcRemoteTargetClient::RCMemoryManager::notifyObjectLoaded(
+    RuntimeDyld &Dyld, const object::ObjectFile &Obj) {
+  // Ask for the object's external symbols in the same round trip as its
+  // memory, so that resolving its relocations needs no further ones.
+  std::vector<std::string> Externals;
+  for (const object::SymbolRef &Sym : Obj.symbols()) {
+    if (!(Sym.getFlags() & object::SymbolRef::SF_Undefined))
+      continue;
+    ErrorOr<StringRef> Name = Sym.getName();
+    if (Name && !Name->empty())
+      Externals.push_back(*Name);
+  }
+  if (!Externals.empty())
+    Client.queueSymbolLookups(Externals);
+
+  // Lay out each segment on its own pages, so that each can be given its
+  // own permissions.
+  uint64_t PageSize = Client.getPageSize();
+  uint64_t TotalSize = 0;
+  for (Segment *Seg : {&Unmapped->Code, &Unmapped->ROData, &Unmapped->RWData}) {
+    uint64_t Offset = 0;
+    for (Alloc &A : Seg->Allocs) {
+      Offset = RoundUpToAlignment(Offset, A.getAlign());
+      A.setRemoteAddress(Offset);
+      Offset += A.getSize();
+    }
+    Seg->Size = RoundUpToAlignment(Offset, PageSize);
+    Seg->RemoteAddr = TotalSize;
+    TotalSize += Seg->Size;
+  }
+
+  if (TotalSize) {
+    TargetAddress Base;
+    if (std::error_code EC = Client.reserveMem(Base, TotalSize))
+      report_fatal_error("Unable to reserve memory in the remote process: " +
+                         EC.message());
+    Reservations.push_back(Base);
+
+    for (Segment *Seg :
+         {&Unmapped->Code, &Unmapped->ROData, &Unmapped->RWData}) {
+      Seg->RemoteAddr += Base;
+      for (Alloc &A : Seg->Allocs) {
+        A.setRemoteAddress(Seg->RemoteAddr + A.getRemoteAddress());
+        DEBUG(dbgs() << "  Mapping local: "
+                     << static_cast<void *>(A.getLocalAddress())
+                     << " to remote: "
+                     << format("0x%016" PRIx64, A.getRemoteAddress())
+                     << "\n");
+        Dyld.mapSectionAddress(A.getLocalAddress(), A.getRemoteAddress());
+      }
+    }
+  }
+
+  Unfinalized.push_back(std::move(Unmapped));
+  Unmapped.reset(new ObjectAllocs());
+}
+
+bool OrcRemoteTargetClient::RCMemoryManager::finalizeMemory(
+    std::string *ErrMsg) {
+  // The copies are only queued: they go out with the request that runs the
+  // code, and any error they run into is reported by it.
+  std::error_code EC;
+  for (auto &ObjAllocs : Unfinalized) {
+    for (Segment *Seg :
+         {&ObjAllocs->Code, &ObjAllocs->ROData, &ObjAllocs->RWData}) {
+      if (!Seg->Size)
+        continue;
+      for (const Alloc &A : Seg->Allocs)
+        if (!EC && A.getSize())
+          EC = Client.writeMem(A.getRemoteAddress(), A.getLocalAddress(),
+                               A.getSize());
+      if (!EC)
+        EC = Client.setProtections(Seg->RemoteAddr, Seg->Size, Seg->Flags);
+    }
+    Finalized.push_back(std::move(ObjAllocs));
+  }
+  Unfinalized.clear();
+
+  if (!EC)
+    return false;
+  if (ErrMsg)
+    *ErrMsg = EC.message();
+  return true;
+}
+
+uint64_t OrcRemoteTargetClient::RCMemoryManager::getSymbolAddress(
+    const std::string &Name) {
+  TargetAddress Addr;
+  if (Client.getSymbolAddress(Addr, Name))
+    return 0;
+  return Addr;
+}
+
+ErrorOr<std::unique_ptr<OrcRemoteTargetClient>>
+OrcRemoteTargetClient::Create(RPCChannel &Channel) {
+  std::unique_ptr<OrcRemoteTargetClient> Client(
+      new OrcRemoteTargetClient(Channel));
+
+  if (std::error_code EC = Client->startRequest(GetRemoteInfoId))
+    return EC;
+  if (std::error_code EC = Client->waitForResponse(GetRemoteInfoResponseId))
+    return EC;
+  std::string TripleStr;
+  uint32_t PointerSize, PageSize;
+  if (std::error_code EC = deserialize(Channel, TripleStr))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, PointerSize))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, PageSize))
+    return EC;
+  Client->TargetTriple = Triple(TripleStr);
+  Client->PointerSize = PointerSize;
+  Client->PageSize = PageSize;
+
+  DEBUG(dbgs() << "Remote target: " << TripleStr << ", " << PointerSize
+               << "-byte pointers, " << PageSize << "-byte pages\n");
+  return std::move(Client);
+}
+
+OrcRemoteTargetClient::OrcRemoteTargetClient(RPCChannel &Channel)
+    : Channel(Channel), PointerSize(0), PageSize(0) {}
+
+OrcRemoteTargetClient::~OrcRemoteTargetClient() {}
+
+std::error_code OrcRemoteTargetClient::startRequest(JITProcId Id) {
+  if (SessionError)
+    return SessionError;
+  DEBUG(dbgs() << "Queueing " << getJITProcIdName(Id) << "\n");
+  if (std::error_code EC = serialize(Channel, static_cast<uint32_t>(Id)))
+    return SessionError = EC;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::readResponse(JITProcId Id) {
+  uint32_t RawId, Status;
+  if (std::error_code EC = deserialize(Channel, RawId))
+    return SessionError = EC;
+  if (RawId != static_cast<uint32_t>(Id))
+    return SessionError = make_error_code(errc::io_error);
+  if (std::error_code EC = deserialize(Channel, Status))
+    return SessionError = EC;
+  if (Status) {
+    DEBUG(dbgs() << getJITProcIdName(Id) << " failed with status " << Status
+                 << "\n");
+    return std::error_code(Status, std::generic_category());
+  }
+  return std::error_code();
+}
+
+std::error_code
+OrcRemoteTargetClient::readSymbolAddresses(ArrayRef<std::string> Names) {
+  if (std::error_code EC = readResponse(GetSymbolAddressesResponseId))
+    return EC;
+  for (const std::string &Name : Names) {
+    TargetAddress Addr;
+    if (std::error_code EC = deserialize(Channel, Addr))
+      return SessionError = EC;
+    SymbolCache[Name] = Addr;
+  }
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::waitForResponse(JITProcId Id) {
+  if (std::error_code EC = Channel.send())
+    return SessionError = EC;
+
+  // Responses arrive in the order the requests were sent, so the answers to
+  // queued lookups come first.  Keep reading after a failed one to stay in
+  // step with the server, but report the first failure.
+  std::error_code Err;
+  std::vector<std::vector<std::string>> Lookups;
+  Lookups.swap(PendingLookups);
+  for (const auto &Names : Lookups) {
+    std::error_code EC = readSymbolAddresses(Names);
+    if (SessionError)
+      return SessionError;
+    if (!Err)
+      Err = EC;
+  }
+
+  std::error_code EC = readResponse(Id);
+  return Err ? Err : EC;
+}
+
+std::error_code OrcRemoteTargetClient::getSymbolAddress(TargetAddress &Addr,
+                                                        StringRef Name) {
+  auto I = SymbolCache.find(Name);
+  if (I == SymbolCache.end()) {
+    if (std::error_code EC = queueSymbolLookups(Name.str()))
+      return EC;
+    if (std::error_code EC = sync())
+      return EC;
+    I = SymbolCache.find(Name);
+    if (I == SymbolCache.end())
+      return make_error_code(errc::io_error);
+  }
+  Addr = I->second;
+  return std::error_code();
+}
+
+std::error_code
+OrcRemoteTargetClient::queueSymbolLookups(ArrayRef<std::string> Names) {
+  std::vector<std::string> Missing;
+  for (const std::string &Name : Names)
+    if (!SymbolCache.count(Name))
+      Missing.push_back(Name);
+  if (Missing.empty())
+    return std::error_code();
+
+  if (std::error_code EC = startRequest(GetSymbolAddressesId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Missing))
+    return SessionError = EC;
+  PendingLookups.push_back(std::move(Missing));
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::reserveMem(TargetAddress &Addr,
+                                                  uint64_t Size) {
+  if (std::error_code EC = startRequest(ReserveMemId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Size))
+    return SessionError = EC;
+  if (std::error_code EC = waitForResponse(ReserveMemResponseId))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return SessionError = EC;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::writeMem(TargetAddress Addr,
+                                                const char *Src,
+                                                uint64_t Size) {
+  if (std::error_code EC = startRequest(WriteMemId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return SessionError = EC;
+  if (std::error_code EC = serialize(Channel, Size))
+    return SessionError = EC;
+  if (std::error_code EC = Channel.appendBytes(Src, Size))
+    return SessionError = EC;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::setProtections(TargetAddress Addr,
+                                                      uint64_t Size,
+                                                      unsigned Flags) {
+  if (std::error_code EC = startRequest(SetProtectionsId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return SessionError = EC;
+  if (std::error_code EC = serialize(Channel, Size))
+    return SessionError = EC;
+  if (std::error_code EC = serialize(Channel, static_cast<uint32_t>(Flags)))
+    return SessionError = EC;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::releaseMem(TargetAddress Addr) {
+  if (std::error_code EC = startRequest(ReleaseMemId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return SessionError = EC;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::sync() {
+  if (std::error_code EC = startRequest(SyncId))
+    return EC;
+  return waitForResponse(SyncResponseId);
+}
+
+std::error_code OrcRemoteTargetClient::callIntVoid(int &Result,
+                                                   TargetAddress Addr) {
+  DEBUG(dbgs() << "Calling int(*)(void) " << format("0x%016" PRIx64, Addr)
+               << "\n");
+  if (std::error_code EC = startRequest(CallIntVoidId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return SessionError = EC;
+  if (std::error_code EC = waitForResponse(CallIntVoidResponseId))
+    return EC;
+  int32_t Result32;
+  if (std::error_code EC = deserialize(Channel, Result32))
+    return SessionError = EC;
+  Result = Result32;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::callMain(int &Result,
+                                                TargetAddress Addr,
+                                                ArrayRef<std::string> Args) {
+  DEBUG(dbgs() << "Calling int(*)(int, char*[]) "
+               << format("0x%016" PRIx64, Addr) << "\n");
+  if (std::error_code EC = startRequest(CallMainId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return SessionError = EC;
+  if (std::error_code EC = serialize(Channel, Args))
+    return SessionError = EC;
+  if (std::error_code EC = waitForResponse(CallMainResponseId))
+    return EC;
+  int32_t Result32;
+  if (std::error_code EC = deserialize(Channel, Result32))
+    return SessionError = EC;
+  Result = Result32;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetClient::terminateSession() {
+  if (std::error_code EC = startRequest(TerminateSessionId))
+    return EC;
+  std::error_code EC = Channel.send();
+  // Answers to queued lookups will never be read.
+  PendingLookups.clear();
+  SessionError = EC ? EC : make_error_code(errc::io_error);
+  return EC;
+}
+
+} // End namespace remote.
+} // End namespace orc.
+} // End namespace llvm.
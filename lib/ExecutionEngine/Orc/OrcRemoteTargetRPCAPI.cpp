@@ -0,0 +1,48 @@
+//===------- OrcRemoteTargetRPCAPI.cpp - Orc Remote-target RPC API --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetRPCAPI.h"
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+#define PROCNAME(X) \
+  case X ## Id: \
+  return #X
+
+const char *OrcRemoteTargetRPCAPI::getJITProcIdName(JITProcId Id) {
+  switch (Id) {
+  case InvalidId:
+    return "*** Invalid JITProcId ***";
+  PROCNAME(GetRemoteInfo);
+  PROCNAME(GetRemoteInfoResponse);
+  PROCNAME(ReserveMem);
+  PROCNAME(ReserveMemResponse);
+  PROCNAME(WriteMem);
+  PROCNAME(SetProtections);
+  PROCNAME(ReleaseMem);
+  PROCNAME(GetSymbolAddresses);
+  PROCNAME(GetSymbolAddressesResponse);
+  PROCNAME(CallIntVoid);
+  PROCNAME(CallIntVoidResponse);
+  PROCNAME(CallMain);
+  PROCNAME(CallMainResponse);
+  PROCNAME(Sync);
+  PROCNAME(SyncResponse);
+  PROCNAME(TerminateSession);
+  };
+  return nullptr;
+}
+
+#undef PROCNAME
+
+} // End namespace remote.
+} // End namespace orc.
+} // End namespace llvm.
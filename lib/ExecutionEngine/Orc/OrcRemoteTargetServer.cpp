@@ -0,0 +1,311 @@
+//===------- OrcRemoteTargetServer.cpp - Orc Remote-target Server ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetServer.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cerrno>
+
+#define DEBUG_TYPE "orc-remote"
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+OrcRemoteTargetServer::OrcRemoteTargetServer(RPCChannel &Channel,
+                                             SymbolLookupFtor SymbolLookup)
+    : Channel(Channel), SymbolLookup(std::move(SymbolLookup)) {
+  if (!this->SymbolLookup)
+    this->SymbolLookup = RTDyldMemoryManager::getSymbolAddressInProcess;
+}
+
+OrcRemoteTargetServer::~OrcRemoteTargetServer() {
+  for (auto &A : Allocs)
+    sys::Memory::releaseMappedMemory(A.second);
+}
+
+std::error_code OrcRemoteTargetServer::run() {
+  while (true) {
+    JITProcId Id = InvalidId;
+    if (std::error_code EC = getNextProcId(Id))
+      return EC;
+    if (Id == TerminateSessionId)
+      return std::error_code();
+    if (std::error_code EC = handleKnownProcedure(Id))
+      return EC;
+  }
+}
+
+std::error_code OrcRemoteTargetServer::getNextProcId(JITProcId &Id) {
+  uint32_t RawId;
+  if (std::error_code EC = deserialize(Channel, RawId))
+    return EC;
+  Id = static_cast<JITProcId>(RawId);
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetServer::handleKnownProcedure(JITProcId Id) {
+  DEBUG(dbgs() << "Handling " << getJITProcIdName(Id) << "\n");
+
+  switch (Id) {
+  case GetRemoteInfoId:
+    return handleGetRemoteInfo();
+  case ReserveMemId:
+    return handleReserveMem();
+  case WriteMemId:
+    return handleWriteMem();
+  case SetProtectionsId:
+    return handleSetProtections();
+  case ReleaseMemId:
+    return handleReleaseMem();
+  case GetSymbolAddressesId:
+    return handleGetSymbolAddresses();
+  case CallIntVoidId:
+    return handleCallIntVoid();
+  case CallMainId:
+    return handleCallMain();
+  case SyncId:
+    return handleSync();
+  case TerminateSessionId:
+    return std::error_code();
+  default:
+    // The stream can't be trusted past a request we don't understand.
+    return make_error_code(errc::invalid_argument);
+  }
+}
+
+std::error_code OrcRemoteTargetServer::startResponse(JITProcId Id) {
+  if (std::error_code EC = serialize(Channel, static_cast<uint32_t>(Id)))
+    return EC;
+  return serialize(Channel, static_cast<uint32_t>(0));
+}
+
+std::error_code OrcRemoteTargetServer::respondWithError(JITProcId Id,
+                                                        std::error_code Err) {
+  DEBUG(dbgs() << "  failed: " << Err.message() << "\n");
+  // Zero means success, so make sure a failure is never reported as one.
+  uint32_t Status = Err.value() ? Err.value() : EINVAL;
+  PendingError = std::error_code();
+  if (std::error_code EC = serialize(Channel, static_cast<uint32_t>(Id)))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Status))
+    return EC;
+  return Channel.send();
+}
+
+bool OrcRemoteTargetServer::isReserved(TargetAddress Addr,
+                                       uint64_t Size) const {
+  auto I = Allocs.upper_bound(Addr);
+  if (I == Allocs.begin())
+    return false;
+  --I;
+  uint64_t Offset = Addr - I->first;
+  return Offset <= I->second.size() && Size <= I->second.size() - Offset;
+}
+
+std::error_code OrcRemoteTargetServer::handleGetRemoteInfo() {
+  if (PendingError)
+    return respondWithError(GetRemoteInfoResponseId, PendingError);
+  if (std::error_code EC = startResponse(GetRemoteInfoResponseId))
+    return EC;
+  std::string ProcessTriple = sys::getProcessTriple();
+  if (std::error_code EC = serialize(Channel, StringRef(ProcessTriple)))
+    return EC;
+  if (std::error_code EC =
+          serialize(Channel, static_cast<uint32_t>(sizeof(void *))))
+    return EC;
+  if (std::error_code EC = serialize(
+          Channel, static_cast<uint32_t>(sys::Process::getPageSize())))
+    return EC;
+  return Channel.send();
+}
+
+std::error_code OrcRemoteTargetServer::handleReserveMem() {
+  uint64_t Size;
+  if (std::error_code EC = deserialize(Channel, Size))
+    return EC;
+  if (PendingError)
+    return respondWithError(ReserveMemResponseId, PendingError);
+
+  std::error_code Err;
+  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(
+      Size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, Err);
+  if (Err)
+    return respondWithError(ReserveMemResponseId, Err);
+
+  TargetAddress Addr = static_cast<TargetAddress>(
+      reinterpret_cast<uintptr_t>(MB.base()));
+  Allocs[Addr] = MB;
+  DEBUG(dbgs() << "  reserved " << Size << " bytes at "
+               << format("0x%016" PRIx64, Addr) << "\n");
+
+  if (std::error_code EC = startResponse(ReserveMemResponseId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Addr))
+    return EC;
+  return Channel.send();
+}
+
+std::error_code OrcRemoteTargetServer::handleWriteMem() {
+  TargetAddress Addr;
+  uint64_t Size;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, Size))
+    return EC;
+
+  if (!PendingError && isReserved(Addr, Size))
+    return Channel.readBytes(reinterpret_cast<char *>(
+                                 static_cast<uintptr_t>(Addr)), Size);
+
+  if (!PendingError)
+    PendingError = make_error_code(errc::bad_address);
+  // Drain the contents to stay in step with the client.
+  char Discard[4096];
+  while (Size) {
+    size_t Count = std::min<uint64_t>(Size, sizeof(Discard));
+    if (std::error_code EC = Channel.readBytes(Discard, Count))
+      return EC;
+    Size -= Count;
+  }
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetServer::handleSetProtections() {
+  TargetAddress Addr;
+  uint64_t Size;
+  uint32_t Flags;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, Size))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, Flags))
+    return EC;
+  if (PendingError)
+    return std::error_code();
+
+  if (!isReserved(Addr, Size)) {
+    PendingError = make_error_code(errc::bad_address);
+    return std::error_code();
+  }
+
+  void *Base = reinterpret_cast<void *>(static_cast<uintptr_t>(Addr));
+  sys::MemoryBlock MB(Base, Size);
+  PendingError = sys::Memory::protectMappedMemory(MB, Flags);
+  if (!PendingError && (Flags & sys::Memory::MF_EXEC))
+    sys::Memory::InvalidateInstructionCache(Base, Size);
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetServer::handleReleaseMem() {
+  TargetAddress Addr;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return EC;
+
+  auto I = Allocs.find(Addr);
+  if (I == Allocs.end()) {
+    if (!PendingError)
+      PendingError = make_error_code(errc::bad_address);
+    return std::error_code();
+  }
+  std::error_code Err = sys::Memory::releaseMappedMemory(I->second);
+  Allocs.erase(I);
+  if (!PendingError)
+    PendingError = Err;
+  return std::error_code();
+}
+
+std::error_code OrcRemoteTargetServer::handleGetSymbolAddresses() {
+  std::vector<std::string> Names;
+  if (std::error_code EC = deserialize(Channel, Names))
+    return EC;
+  if (PendingError)
+    return respondWithError(GetSymbolAddressesResponseId, PendingError);
+
+  if (std::error_code EC = startResponse(GetSymbolAddressesResponseId))
+    return EC;
+  for (const std::string &Name : Names) {
+    TargetAddress Addr = SymbolLookup(Name);
+    DEBUG(dbgs() << "  " << Name << " = " << format("0x%016" PRIx64, Addr)
+                 << "\n");
+    if (std::error_code EC = serialize(Channel, Addr))
+      return EC;
+  }
+  return Channel.send();
+}
+
+std::error_code OrcRemoteTargetServer::handleCallIntVoid() {
+  typedef int (*IntVoidFnTy)();
+
+  TargetAddress Addr;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return EC;
+  if (PendingError)
+    return respondWithError(CallIntVoidResponseId, PendingError);
+
+  DEBUG(dbgs() << "  calling " << format("0x%016" PRIx64, Addr) << "\n");
+  IntVoidFnTy Fn =
+      reinterpret_cast<IntVoidFnTy>(static_cast<uintptr_t>(Addr));
+  int32_t Result = Fn();
+  DEBUG(dbgs() << "  result = " << Result << "\n");
+
+  if (std::error_code EC = startResponse(CallIntVoidResponseId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Result))
+    return EC;
+  return Channel.send();
+}
+
+std::error_code OrcRemoteTargetServer::handleCallMain() {
+  typedef int (*MainFnTy)(int, const char *[]);
+
+  TargetAddress Addr;
+  std::vector<std::string> Args;
+  if (std::error_code EC = deserialize(Channel, Addr))
+    return EC;
+  if (std::error_code EC = deserialize(Channel, Args))
+    return EC;
+  if (PendingError)
+    return respondWithError(CallMainResponseId, PendingError);
+
+  std::vector<const char *> ArgV;
+  for (const std::string &Arg : Args)
+    ArgV.push_back(Arg.c_str());
+  ArgV.push_back(nullptr);
+
+  DEBUG(dbgs() << "  calling " << format("0x%016" PRIx64, Addr) << " with "
+               << Args.size() << " arguments\n");
+  MainFnTy Fn = reinterpret_cast<MainFnTy>(static_cast<uintptr_t>(Addr));
+  int32_t Result = Fn(static_cast<int>(Args.size()), ArgV.data());
+  DEBUG(dbgs() << "  result = " << Result << "\n");
+
+  if (std::error_code EC = startResponse(CallMainResponseId))
+    return EC;
+  if (std::error_code EC = serialize(Channel, Result))
+    return EC;
+  return Channel.send();
+}
+
+std::error_code OrcRemoteTargetServer::handleSync() {
+  if (PendingError)
+    return respondWithError(SyncResponseId, PendingError);
+  if (std::error_code EC = startResponse(SyncResponseId))
+    return EC;
+  return Channel.send();
+}
+
+} // End namespace remote.
+} // End namespace orc.
+} // End namespace llvm.
@@ -0,0 +1,144 @@
+//===--------------- RPCChannel.cpp - Byte stream for RPC -----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/RPCChannel.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Errc.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#ifdef LLVM_ON_UNIX
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace llvm {
+namespace orc {
+namespace remote {
+
+// Reads are done in chunks of this size, so that several small messages can
+// be picked up with one system call.
+static const size_t ReadChunkSize = 4096;
+
+// readFD/writeFD - Transfer at most Size bytes, returning the number actually
+// transferred, or -1 with errno set.  The Windows CRT takes an unsigned count
+// and returns an int.
+static long readFD(int FD, char *Dst, size_t Size) {
+#ifdef LLVM_ON_UNIX
+  return ::read(FD, Dst, Size);
+#else
+  return ::_read(FD, Dst,
+                 static_cast<unsigned>(std::min<size_t>(Size, INT_MAX)));
+#endif
+}
+
+static long writeFD(int FD, const char *Src, size_t Size) {
+#ifdef LLVM_ON_UNIX
+  return ::write(FD, Src, Size);
+#else
+  return ::_write(FD, Src,
+                  static_cast<unsigned>(std::min<size_t>(Size, INT_MAX)));
+#endif
+}
+
+RPCChannel::~RPCChannel() {}
+
+std::error_code serialize(RPCChannel &C, StringRef S) {
+  if (std::error_code EC = serialize(C, static_cast<uint32_t>(S.size())))
+    return EC;
+  return C.appendBytes(S.data(), S.size());
+}
+
+std::error_code deserialize(RPCChannel &C, std::string &S) {
+  uint32_t Size;
+  if (std::error_code EC = deserialize(C, Size))
+    return EC;
+  S.resize(Size);
+  return Size ? C.readBytes(&S[0], Size) : std::error_code();
+}
+
+std::error_code serialize(RPCChannel &C, ArrayRef<std::string> Strings) {
+  if (std::error_code EC = serialize(C, static_cast<uint32_t>(Strings.size())))
+    return EC;
+  for (const std::string &S : Strings)
+    if (std::error_code EC = serialize(C, StringRef(S)))
+      return EC;
+  return std::error_code();
+}
+
+std::error_code deserialize(RPCChannel &C, std::vector<std::string> &Strings) {
+  uint32_t Count;
+  if (std::error_code EC = deserialize(C, Count))
+    return EC;
+  Strings.resize(Count);
+  for (std::string &S : Strings)
+    if (std::error_code EC = deserialize(C, S))
+      return EC;
+  return std::error_code();
+}
+
+FDRPCChannel::FDRPCChannel(int InFD, int OutFD)
+    : InFD(InFD), OutFD(OutFD), InPos(0) {}
+
+FDRPCChannel::~FDRPCChannel() {}
+
+std::error_code FDRPCChannel::readBytes(char *Dst, size_t Size) {
+  while (Size) {
+    if (InPos == InBuffer.size()) {
+      InBuffer.resize(std::max(Size, ReadChunkSize));
+      InPos = 0;
+      long NumRead = readFD(InFD, InBuffer.data(), InBuffer.size());
+      if (NumRead <= 0) {
+        InBuffer.clear();
+        if (NumRead == -1 && errno == EINTR)
+          continue;
+        if (NumRead == -1)
+          return std::error_code(errno, std::generic_category());
+        // The other end hung up in the middle of a message.
+        return make_error_code(errc::io_error);
+      }
+      InBuffer.resize(NumRead);
+    }
+    size_t Count = std::min(Size, InBuffer.size() - InPos);
+    memcpy(Dst, InBuffer.data() + InPos, Count);
+    InPos += Count;
+    Dst += Count;
+    Size -= Count;
+  }
+  return std::error_code();
+}
+
+std::error_code FDRPCChannel::appendBytes(const char *Src, size_t Size) {
+  OutBuffer.insert(OutBuffer.end(), Src, Src + Size);
+  return std::error_code();
+}
+
+std::error_code FDRPCChannel::send() {
+  const char *Data = OutBuffer.data();
+  size_t Size = OutBuffer.size();
+  while (Size) {
+    long NumWritten = writeFD(OutFD, Data, Size);
+    if (NumWritten == -1) {
+      if (errno == EINTR)
+        continue;
+      OutBuffer.clear();
+      return std::error_code(errno, std::generic_category());
+    }
+    Data += NumWritten;
+    Size -= NumWritten;
+  }
+  OutBuffer.clear();
+  return std::error_code();
+}
+
+} // End namespace remote.
+} // End namespace orc.
+} // End namespace llvm.
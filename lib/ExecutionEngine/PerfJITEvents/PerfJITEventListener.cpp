@@ -0,0 +1,386 @@
+//===-- PerfJITEventListener.cpp - Tell Linux's perf about JITted code ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that tells perf about JITted
+// functions in the two formats perf understands:
+//
+//  * /tmp/perf-<pid>.map, which lists the name and address range of each
+//    function and is read by "perf report" directly.
+//
+//  * A jitdump file, which additionally holds the code of each function and
+//    its line table.  "perf inject --jit" turns it into ELF images that perf
+//    can annotate.  The file is announced to "perf record" (which must be run
+//    with "-k 1" so that timestamps match) by mapping it into memory.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace llvm::object;
+
+#define DEBUG_TYPE "perf-jit-event-listener"
+
+namespace {
+
+// The jitdump format, as described in tools/perf/Documentation/jitdump-
+// specification.txt in the Linux kernel sources.
+namespace jitdump {
+
+const uint32_t Magic = 0x4A695444; // "JiTD"
+const uint32_t Version = 1;
+
+enum RecordType : uint32_t {
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_MOVE = 1,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+struct FileHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t TotalSize;
+  uint32_t ElfMach;
+  uint32_t Pad1;
+  uint32_t Pid;
+  uint64_t Timestamp;
+  uint64_t Flags;
+};
+
+struct RecordHeader {
+  uint32_t Id;
+  uint32_t TotalSize;
+  uint64_t Timestamp;
+};
+
+// Followed by the null terminated function name and the code.
+struct CodeLoadRecord {
+  RecordHeader Header;
+  uint32_t Pid;
+  uint32_t Tid;
+  uint64_t Vma;
+  uint64_t CodeAddr;
+  uint64_t CodeSize;
+  uint64_t CodeIndex;
+};
+
+// Followed by NrEntry entries.
+struct DebugInfoRecord {
+  RecordHeader Header;
+  uint64_t CodeAddr;
+  uint64_t NrEntry;
+};
+
+// Followed by the null terminated file name.
+struct DebugEntry {
+  uint64_t Addr;
+  int32_t Lineno;
+  int32_t Discrim;
+};
+
+} // end namespace jitdump
+
+class PerfJITEventListener : public JITEventListener {
+public:
+  PerfJITEventListener();
+  ~PerfJITEventListener() override;
+
+  void NotifyObjectEmitted(const ObjectFile &Obj,
+                           const RuntimeDyld::LoadedObjectInfo &L) override;
+
+private:
+  bool openPerfMap();
+  bool openJITDump();
+  void closeJITDump();
+
+  void writeDebugInfo(uint64_t Addr, const DILineInfoTable &Lines);
+  void writeCodeLoad(StringRef Name, uint64_t Addr, StringRef Code);
+
+  template <typename T> void write(const T &Value) {
+    JITDump->write(reinterpret_cast<const char *>(&Value), sizeof(T));
+  }
+
+  // Objects may be emitted by several threads at once.
+  sys::Mutex Lock;
+  uint32_t Pid;
+  uint64_t CodeIndex;
+
+  std::unique_ptr<raw_fd_ostream> PerfMap;
+
+  std::unique_ptr<raw_fd_ostream> JITDump;
+  int JITDumpFD;
+  void *JITDumpMarker;
+  size_t JITDumpMarkerSize;
+};
+
+/// The clock perf uses for its timestamps with "-k 1".
+static uint64_t getTimestamp() {
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS))
+    return 0;
+  return uint64_t(TS.tv_sec) * 1000000000 + TS.tv_nsec;
+}
+
+static uint32_t getThreadID() {
+  return static_cast<uint32_t>(syscall(SYS_gettid));
+}
+
+static uint32_t getELFMachine(Triple::ArchType Arch) {
+  switch (Arch) {
+  case Triple::x86:
+    return ELF::EM_386;
+  case Triple::x86_64:
+    return ELF::EM_X86_64;
+  case Triple::arm:
+  case Triple::armeb:
+  case Triple::thumb:
+  case Triple::thumbeb:
+    return ELF::EM_ARM;
+  case Triple::aarch64:
+  case Triple::aarch64_be:
+    return ELF::EM_AARCH64;
+  case Triple::mips:
+  case Triple::mipsel:
+  case Triple::mips64:
+  case Triple::mips64el:
+    return ELF::EM_MIPS;
+  case Triple::ppc:
+    return ELF::EM_PPC;
+  case Triple::ppc64:
+  case Triple::ppc64le:
+    return ELF::EM_PPC64;
+  case Triple::systemz:
+    return ELF::EM_S390;
+  default:
+    return ELF::EM_NONE;
+  }
+}
+
+PerfJITEventListener::PerfJITEventListener()
+    : Pid(static_cast<uint32_t>(::getpid())), CodeIndex(0), JITDumpFD(-1),
+      JITDumpMarker(nullptr), JITDumpMarkerSize(0) {
+  if (!openPerfMap())
+    PerfMap.reset();
+  if (!openJITDump())
+    closeJITDump();
+}
+
+PerfJITEventListener::~PerfJITEventListener() {
+  if (JITDump) {
+    jitdump::RecordHeader Close;
+    Close.Id = jitdump::JIT_CODE_CLOSE;
+    Close.TotalSize = sizeof(Close);
+    Close.Timestamp = getTimestamp();
+    write(Close);
+  }
+  closeJITDump();
+}
+
+bool PerfJITEventListener::openPerfMap() {
+  SmallString<64> Path;
+  raw_svector_ostream(Path) << "/tmp/perf-" << Pid << ".map";
+  std::error_code EC;
+  PerfMap.reset(new raw_fd_ostream(Path, EC, sys::fs::F_Text));
+  if (EC) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << EC.message() << "\n");
+    return false;
+  }
+  // perf may read the map while we are still running, so keep it complete.
+  PerfMap->SetUnbuffered();
+  return true;
+}
+
+bool PerfJITEventListener::openJITDump() {
+  // perf inject looks for the file by the name it was mapped under, so it can
+  // go anywhere.  Honour the same variable as other JITs for the directory.
+  SmallString<128> Path;
+  if (const char *Dir = ::getenv("JITDUMPDIR"))
+    Path = Dir;
+  else
+    Path = "/tmp";
+  sys::path::append(Path, "jit-" + Twine(Pid) + ".dump");
+
+  if (std::error_code EC =
+          sys::fs::openFileForWrite(Path, JITDumpFD, sys::fs::F_RW)) {
+    DEBUG(dbgs() << "Failed to open " << Path << ": " << EC.message() << "\n");
+    JITDumpFD = -1;
+    return false;
+  }
+
+  // Mapping the file with execute permission makes perf record an mmap event
+  // for it, which is how perf inject finds the file.
+  JITDumpMarkerSize = sys::Process::getPageSize();
+  JITDumpMarker = ::mmap(nullptr, JITDumpMarkerSize, PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE, JITDumpFD, 0);
+  if (JITDumpMarker == MAP_FAILED) {
+    DEBUG(dbgs() << "Failed to map " << Path << ": " << sys::StrError()
+                 << "\n");
+    JITDumpMarker = nullptr;
+    return false;
+  }
+
+  JITDump.reset(new raw_fd_ostream(JITDumpFD, /*shouldClose=*/false));
+
+  jitdump::FileHeader Header;
+  Header.Magic = jitdump::Magic;
+  Header.Version = jitdump::Version;
+  Header.TotalSize = sizeof(Header);
+  Header.ElfMach =
+      getELFMachine(Triple(sys::getProcessTriple()).getArch());
+  Header.Pad1 = 0;
+  Header.Pid = Pid;
+  Header.Timestamp = getTimestamp();
+  Header.Flags = 0;
+  write(Header);
+  JITDump->flush();
+  return !JITDump->has_error();
+}
+
+void PerfJITEventListener::closeJITDump() {
+  if (JITDump) {
+    JITDump->flush();
+    JITDump->clear_error();
+    JITDump.reset();
+  }
+  if (JITDumpMarker)
+    ::munmap(JITDumpMarker, JITDumpMarkerSize);
+  JITDumpMarker = nullptr;
+  if (JITDumpFD != -1)
+    sys::Process::SafelyCloseFileDescriptor(JITDumpFD);
+  JITDumpFD = -1;
+}
+
+void PerfJITEventListener::writeDebugInfo(uint64_t Addr,
+                                          const DILineInfoTable &Lines) {
+  uint64_t Size = sizeof(jitdump::DebugInfoRecord);
+  for (const auto &Line : Lines)
+    Size += sizeof(jitdump::DebugEntry) + Line.second.FileName.size() + 1;
+
+  jitdump::DebugInfoRecord Record;
+  Record.Header.Id = jitdump::JIT_CODE_DEBUG_INFO;
+  Record.Header.TotalSize = Size;
+  Record.Header.Timestamp = getTimestamp();
+  Record.CodeAddr = Addr;
+  Record.NrEntry = Lines.size();
+  write(Record);
+
+  for (const auto &Line : Lines) {
+    jitdump::DebugEntry Entry;
+    Entry.Addr = Line.first;
+    Entry.Lineno = Line.second.Line;
+    Entry.Discrim = 0;
+    write(Entry);
+    *JITDump << Line.second.FileName << '\0';
+  }
+}
+
+void PerfJITEventListener::writeCodeLoad(StringRef Name, uint64_t Addr,
+                                         StringRef Code) {
+  jitdump::CodeLoadRecord Record;
+  Record.Header.Id = jitdump::JIT_CODE_LOAD;
+  Record.Header.TotalSize = sizeof(Record) + Name.size() + 1 + Code.size();
+  Record.Header.Timestamp = getTimestamp();
+  Record.Pid = Pid;
+  Record.Tid = getThreadID();
+  Record.Vma = Addr;
+  Record.CodeAddr = Addr;
+  Record.CodeSize = Code.size();
+  Record.CodeIndex = CodeIndex++;
+  write(Record);
+  *JITDump << Name << '\0';
+  *JITDump << Code;
+}
+
+void PerfJITEventListener::NotifyObjectEmitted(
+                                       const ObjectFile &Obj,
+                                       const RuntimeDyld::LoadedObjectInfo &L) {
+  MutexGuard Guard(Lock);
+  if (!PerfMap && !JITDump)
+    return;
+
+  OwningBinary<ObjectFile> DebugObjOwner = L.getObjectForDebug(Obj);
+  const ObjectFile &DebugObj = *DebugObjOwner.getBinary();
+  std::unique_ptr<DIContext> Context;
+  if (JITDump)
+    Context.reset(new DWARFContextInMemory(DebugObj));
+
+  // Use symbol info to iterate functions in the object.
+  for (const std::pair<SymbolRef, uint64_t> &P : computeSymbolSizes(DebugObj)) {
+    SymbolRef Sym = P.first;
+    if (Sym.getType() != SymbolRef::ST_Function)
+      continue;
+
+    ErrorOr<StringRef> NameOrErr = Sym.getName();
+    if (NameOrErr.getError())
+      continue;
+    StringRef Name = *NameOrErr;
+    ErrorOr<uint64_t> AddrOrErr = Sym.getAddress();
+    if (AddrOrErr.getError())
+      continue;
+    uint64_t Addr = *AddrOrErr;
+    uint64_t Size = P.second;
+    if (!Size)
+      continue;
+
+    if (PerfMap)
+      *PerfMap << format("%" PRIx64 " %" PRIx64 " ", Addr, Size) << Name
+               << '\n';
+
+    if (JITDump) {
+      // perf expects the line table of a function before its code.
+      DILineInfoTable Lines = Context->getLineInfoForAddressRange(Addr, Size);
+      if (!Lines.empty())
+        writeDebugInfo(Addr, Lines);
+      // Take the code from the object rather than from Addr, which may be in
+      // another process when the JIT targets a remote one.
+      section_iterator Section = DebugObj.section_end();
+      StringRef Contents;
+      if (Sym.getSection(Section) || Section == DebugObj.section_end() ||
+          Section->getContents(Contents))
+        continue;
+      uint64_t Offset = Addr - Section->getAddress();
+      if (Offset + Size > Contents.size())
+        continue;
+      writeCodeLoad(Name, Addr, Contents.substr(Offset, Size));
+    }
+  }
+
+  if (JITDump)
+    JITDump->flush();
+}
+
+} // anonymous namespace.
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return new PerfJITEventListener();
+}
+
+} // namespace llvm
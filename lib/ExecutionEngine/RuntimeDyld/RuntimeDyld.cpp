@@ -85,9 +85,12 @@ void RuntimeDyldImpl::resolveRelocations() {
   // First, resolve relocations associated with external symbols.
   resolveExternalSymbols();
 
-  // Just iterate over the sections we have and resolve all the relocations
-  // in them. Gross overkill, but it gets the job done.
-  for (int i = 0, e = Sections.size(); i != e; ++i) {
+  // Iterate over the sections we have and resolve the relocations based on
+  // each of them, all at once.  Sections without relocations are skipped.
+  for (int i = 0, e = Sections.size(); i != e && !Relocations.empty(); ++i) {
+    auto RI = Relocations.find(i);
+    if (RI == Relocations.end())
+      continue;
     // The Section here (Sections[i]) refers to the section in which the
     // symbol for the relocation is located.  The SectionID in the relocation
     // entry provides the section to which the relocation will be applied.
@@ -95,9 +98,9 @@ void RuntimeDyldImpl::resolveRelocations() {
     DEBUG(dbgs() << "Resolving relocations Section #" << i << "\t"
                  << format("%p", (uintptr_t)Addr) << "\n");
     DEBUG(dumpSectionMemory(Sections[i], "before relocations"));
-    resolveRelocationList(Relocations[i], Addr);
+    resolveRelocationList(RI->second, Addr);
     DEBUG(dumpSectionMemory(Sections[i], "after relocations"));
-    Relocations.erase(i);
+    Relocations.erase(RI);
   }
 }
 
@@ -231,6 +234,9 @@ RuntimeDyldImpl::loadObjectImpl(const object::ObjectFile &Obj) {
   // Give the subclasses a chance to tie-up any loose ends.
   finalizeLoad(Obj, LocalSections);
 
+  // The cache is keyed by addresses in Obj, which may go away.
+  SymbolLookupCache.clear();
+
   unsigned SectionsAddedEndIdx = Sections.size();
 
   return std::make_pair(SectionsAddedBeginIdx, SectionsAddedEndIdx);
@@ -639,19 +645,41 @@ void RuntimeDyldImpl::addRelocationForSymbol(const RelocationEntry &RE,
                                              StringRef SymbolName) {
   // Relocation by symbol.  If the symbol is found in the global symbol table,
   // create an appropriate section relocation.  Otherwise, add it to
-  // ExternalSymbolRelocations.
-  RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(SymbolName);
-  if (Loc == GlobalSymbolTable.end()) {
-    ExternalSymbolRelocations[SymbolName].push_back(RE);
+  // ExternalSymbolRelocations.  The symbol table does not change while the
+  // relocations of an object are processed, so the outcome of the lookup is
+  // remembered for the remaining relocations against the same name.
+  SymbolLookup &Lookup = SymbolLookupCache[SymbolName.data()];
+  if (Lookup.NameSize != SymbolName.size()) {
+    Lookup.NameSize = SymbolName.size();
+    RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(SymbolName);
+    if (Loc == GlobalSymbolTable.end()) {
+      Lookup.Entry = nullptr;
+      Lookup.ExternalID = getExternalSymbolID(SymbolName);
+    } else
+      Lookup.Entry = &Loc->second;
+  }
+
+  if (!Lookup.Entry) {
+    ExternalSymbolRelocations[Lookup.ExternalID].Relocs.push_back(RE);
   } else {
     // Copy the RE since we want to modify its addend.
     RelocationEntry RECopy = RE;
-    const auto &SymInfo = Loc->second;
+    const auto &SymInfo = *Lookup.Entry;
     RECopy.Addend += SymInfo.getOffset();
     Relocations[SymInfo.getSectionID()].push_back(RECopy);
   }
 }
 
+unsigned RuntimeDyldImpl::getExternalSymbolID(StringRef Name) {
+  auto Inserted = ExternalSymbolIDs.insert(
+      std::make_pair(Name, (unsigned)ExternalSymbolRelocations.size()));
+  if (Inserted.second) {
+    ExternalSymbolRelocations.push_back(ExternalSymbolRelocs());
+    ExternalSymbolRelocations.back().Name = Inserted.first->first();
+  }
+  return Inserted.first->second;
+}
+
 uint8_t *RuntimeDyldImpl::createStubFunction(uint8_t *Addr,
                                              unsigned AbiVariant) {
   if (Arch == Triple::aarch64 || Arch == Triple::aarch64_be) {
@@ -751,40 +779,60 @@ void RuntimeDyldImpl::reassignSectionAddress(unsigned SectionID,
 
 void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
                                             uint64_t Value) {
+  // Relocations are mostly grouped by the section they apply to, so only
+  // check whether that section was loaded when it changes.
+  unsigned LastSectionID = RTDYLD_INVALID_SECTION_ID;
+  bool SectionLoaded = false;
   for (unsigned i = 0, e = Relocs.size(); i != e; ++i) {
     const RelocationEntry &RE = Relocs[i];
+    if (RE.SectionID != LastSectionID) {
+      LastSectionID = RE.SectionID;
+      SectionLoaded = Sections[RE.SectionID].Address != nullptr;
+    }
     // Ignore relocations for sections that were not loaded
-    if (Sections[RE.SectionID].Address == nullptr)
+    if (!SectionLoaded)
       continue;
     resolveRelocation(RE, Value);
   }
 }
 
 void RuntimeDyldImpl::resolveExternalSymbols() {
-  while (!ExternalSymbolRelocations.empty()) {
-    StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
-
-    StringRef Name = i->first();
-    if (Name.size() == 0) {
-      // This is an absolute symbol, use an address of zero.
-      DEBUG(dbgs() << "Resolving absolute relocations."
-                   << "\n");
-      RelocationList &Relocs = i->second;
-      resolveRelocationList(Relocs, 0);
-    } else {
+  // Resolving a symbol may load further objects, which can add relocations
+  // for new symbols as well as for symbols that were already resolved, so
+  // keep going until no symbol has relocations left.  Entries are only ever
+  // appended while this runs, and are accessed by index, so the list may grow
+  // under us.
+  bool Changed;
+  do {
+    Changed = false;
+    for (unsigned i = 0; i != ExternalSymbolRelocations.size(); ++i) {
+      if (ExternalSymbolRelocations[i].Relocs.empty())
+        continue;
+      Changed = true;
+
+      StringRef Name = ExternalSymbolRelocations[i].Name;
+      if (Name.size() == 0) {
+        // This is an absolute symbol, use an address of zero.
+        DEBUG(dbgs() << "Resolving absolute relocations."
+                     << "\n");
+        RelocationList &Relocs = ExternalSymbolRelocations[i].Relocs;
+        resolveRelocationList(Relocs, 0);
+        Relocs.clear();
+        continue;
+      }
+
       uint64_t Addr = 0;
       RTDyldSymbolTable::const_iterator Loc = GlobalSymbolTable.find(Name);
       if (Loc == GlobalSymbolTable.end()) {
         // This is an external symbol, try to get its address from the symbol
-        // resolver.
+        // resolver.  The name is null terminated, since it is the key of an
+        // ExternalSymbolIDs entry.
         Addr = Resolver.findSymbol(Name.data()).getAddress();
         // The call to getSymbolAddress may have caused additional modules to
         // be loaded, which may have added new entries to the
-        // ExternalSymbolRelocations map.  Consquently, we need to update our
-        // iterator.  This is also why retrieval of the relocation list
-        // associated with this symbol is deferred until below this point.
-        // New entries may have been added to the relocation list.
-        i = ExternalSymbolRelocations.find(Name);
+        // ExternalSymbolRelocations list, or new relocations to this one.
+        // This is why retrieval of the relocation list associated with this
+        // symbol is deferred until below this point.
       } else {
         // We found the symbol in our global table.  It was probably in a
         // Module that we loaded previously.
@@ -798,20 +846,23 @@ void RuntimeDyldImpl::resolveExternalSymbols() {
         report_fatal_error("Program used external function '" + Name +
                            "' which could not be resolved!");
 
+      // This list may have been updated when we called getSymbolAddress, so
+      // don't change this code to get the list earlier.
+      RelocationList &Relocs = ExternalSymbolRelocations[i].Relocs;
+
       // If Resolver returned UINT64_MAX, the client wants to handle this symbol
       // manually and we shouldn't resolve its relocations.
       if (Addr != UINT64_MAX) {
         DEBUG(dbgs() << "Resolving relocations Name: " << Name << "\t"
                      << format("0x%lx", Addr) << "\n");
-        // This list may have been updated when we called getSymbolAddress, so
-        // don't change this code to get the list earlier.
-        RelocationList &Relocs = i->second;
         resolveRelocationList(Relocs, Addr);
       }
+      Relocs.clear();
     }
+  } while (Changed);
 
-    ExternalSymbolRelocations.erase(i);
-  }
+  ExternalSymbolRelocations.clear();
+  ExternalSymbolIDs.clear();
 }
 
 //===----------------------------------------------------------------------===//
@@ -898,7 +949,9 @@ RuntimeDyld::loadObject(const ObjectFile &Obj) {
   if (!Dyld->isCompatibleFile(Obj))
     report_fatal_error("Incompatible object format!");
 
-  return Dyld->loadObject(Obj);
+  std::unique_ptr<LoadedObjectInfo> LoadedObjInfo = Dyld->loadObject(Obj);
+  MemMgr.notifyObjectLoaded(*this, Obj);
+  return LoadedObjInfo;
 }
 
 void *RuntimeDyld::getSymbolLocalAddress(StringRef Name) const {
@@ -228,8 +228,25 @@ protected:
 
   // Relocations to external symbols that are not yet resolved.  Symbols are
   // external when they aren't found in the global symbol table of all loaded
-  // modules.  This map is indexed by symbol name.
-  StringMap<RelocationList> ExternalSymbolRelocations;
+  // modules.  Each name is interned into an index into this list the first
+  // time it is referenced, so resolving the relocations never hashes it again.
+  struct ExternalSymbolRelocs {
+    StringRef Name; // Points into the key of the ExternalSymbolIDs entry.
+    RelocationList Relocs;
+  };
+  std::vector<ExternalSymbolRelocs> ExternalSymbolRelocations;
+  StringMap<unsigned> ExternalSymbolIDs;
+
+  // The symbols looked up by addRelocationForSymbol while loading an object,
+  // keyed by the address of their name in the object.  Many relocations refer
+  // to the same symbol, and this avoids hashing its name for each of them.
+  struct SymbolLookup {
+    SymbolLookup() : NameSize(~size_t(0)), Entry(nullptr), ExternalID(0) {}
+    size_t NameSize;
+    const SymbolTableEntry *Entry; // Null if the symbol is external.
+    unsigned ExternalID;
+  };
+  DenseMap<const char *, SymbolLookup> SymbolLookupCache;
 
 
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
@@ -341,9 +358,14 @@ protected:
   void addRelocationForSection(const RelocationEntry &RE, unsigned SectionID);
 
   // \brief Add a relocation entry that uses the given symbol.  This symbol may
-  // be found in the global symbol table, or it may be external.
+  // be found in the global symbol table, or it may be external.  The name must
+  // point into the object being loaded.
   void addRelocationForSymbol(const RelocationEntry &RE, StringRef SymbolName);
 
+  // \brief Return the index of the relocation list for the external symbol
+  // \p Name in ExternalSymbolRelocations, creating it if needed.
+  unsigned getExternalSymbolID(StringRef Name);
+
   /// \brief Emits long jump instruction to Addr.
   /// \return Pointer to the memory area for emitting target address.
   uint8_t *createStubFunction(uint8_t *Addr, unsigned AbiVariant = 0);
@@ -15,9 +15,146 @@
 #include "llvm/Config/config.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
 
 namespace llvm {
 
+SectionMemoryPool::SectionMemoryPool(size_t SlabSize, size_t MaxFreeBytes)
+    : SlabSize(SlabSize), MaxFreeBytes(MaxFreeBytes),
+      PageSize(sys::Process::getPageSize()), FreeBytes(0) {}
+
+SectionMemoryPool::~SectionMemoryPool() {
+  for (const auto &Slab : Slabs) {
+    sys::MemoryBlock MB((void*)Slab.first, Slab.second);
+    sys::Memory::releaseMappedMemory(MB);
+  }
+}
+
+std::map<uintptr_t, size_t>::const_iterator
+SectionMemoryPool::findSlab(uintptr_t Addr) const {
+  auto I = Slabs.upper_bound(Addr);
+  if (I == Slabs.begin())
+    return Slabs.end();
+  --I;
+  return Addr < I->first + I->second ? I : Slabs.end();
+}
+
+sys::MemoryBlock SectionMemoryPool::allocate(size_t Size, std::error_code &EC) {
+  EC = std::error_code();
+  if (!Size)
+    return sys::MemoryBlock();
+  Size = RoundUpToAlignment(Size, PageSize);
+
+  MutexGuard Guard(Lock);
+
+  // Reuse the first free run that is large enough.
+  for (auto I = FreeRuns.begin(), E = FreeRuns.end(); I != E; ++I) {
+    if (I->second < Size)
+      continue;
+    uintptr_t Addr = I->first;
+    size_t Remaining = I->second - Size;
+    FreeRuns.erase(I);
+    if (Remaining)
+      FreeRuns[Addr + Size] = Remaining;
+    FreeBytes -= Size;
+    return sys::MemoryBlock((void*)Addr, Size);
+  }
+
+  // Map a new slab, next to the previous one if possible.
+  sys::MemoryBlock Slab = sys::Memory::allocateMappedMemory(
+      std::max(Size, SlabSize), &Near,
+      sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+  if (EC)
+    return sys::MemoryBlock();
+  Near = Slab;
+
+  uintptr_t Addr = (uintptr_t)Slab.base();
+  Slabs[Addr] = Slab.size();
+  if (Slab.size() > Size) {
+    FreeRuns[Addr + Size] = Slab.size() - Size;
+    FreeBytes += Slab.size() - Size;
+  }
+  return sys::MemoryBlock((void*)Addr, Size);
+}
+
+void SectionMemoryPool::release(sys::MemoryBlock Block) {
+  if (!Block.base() || !Block.size())
+    return;
+
+  // The block may have been made executable or read-only; make it writable
+  // again so it can be handed out for any kind of section.
+  sys::Memory::protectMappedMemory(Block,
+                                   sys::Memory::MF_READ | sys::Memory::MF_WRITE);
+
+  MutexGuard Guard(Lock);
+  uintptr_t Addr = (uintptr_t)Block.base();
+  size_t Size = Block.size();
+  FreeBytes += Size;
+
+  // Merge with the neighbouring free runs of the same slab.  Runs never span
+  // slabs, so that every allocation lies within a single mapping.
+  auto Slab = findSlab(Addr);
+  assert(Slab != Slabs.end() && "Block was not allocated from this pool");
+  auto Next = FreeRuns.lower_bound(Addr);
+  if (Next != FreeRuns.begin()) {
+    auto Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Addr && Prev->first >= Slab->first) {
+      Addr = Prev->first;
+      Size += Prev->second;
+      FreeRuns.erase(Prev);
+    }
+  }
+  if (Next != FreeRuns.end() && Addr + Size == Next->first &&
+      Next->first < Slab->first + Slab->second) {
+    Size += Next->second;
+    FreeRuns.erase(Next);
+  }
+  FreeRuns[Addr] = Size;
+
+  if (FreeBytes > MaxFreeBytes)
+    unmapFreeSlabs();
+}
+
+void SectionMemoryPool::unmapFreeSlabs() {
+  for (auto I = Slabs.begin(), E = Slabs.end();
+       I != E && FreeBytes > MaxFreeBytes;) {
+    auto Run = FreeRuns.find(I->first);
+    if (Run == FreeRuns.end() || Run->second != I->second) {
+      ++I;
+      continue;
+    }
+    // Forget the region nearby which the next slab should be mapped if it
+    // is about to disappear.
+    if ((uintptr_t)Near.base() == I->first)
+      Near = sys::MemoryBlock();
+    FreeRuns.erase(Run);
+    FreeBytes -= I->second;
+    sys::MemoryBlock MB((void*)I->first, I->second);
+    sys::Memory::releaseMappedMemory(MB);
+    I = Slabs.erase(I);
+  }
+}
+
+size_t SectionMemoryPool::getMappedBytes() const {
+  MutexGuard Guard(Lock);
+  size_t Bytes = 0;
+  for (const auto &Slab : Slabs)
+    Bytes += Slab.second;
+  return Bytes;
+}
+
+SectionMemoryManager::SectionMemoryManager(SectionMemoryPool *Pool)
+    : Pool(Pool) {
+  // A memory manager of its own maps small slabs, since all of its memory is
+  // unmapped when it is destroyed anyway.
+  if (!this->Pool) {
+    OwnedPool.reset(new SectionMemoryPool(64 * 1024));
+    this->Pool = OwnedPool.get();
+  }
+}
+
 uint8_t *SectionMemoryManager::allocateDataSection(uintptr_t Size,
                                                    unsigned Alignment,
                                                    unsigned SectionID,
@@ -58,33 +195,21 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
       // Store cutted free memory block.
       MemGroup.FreeMem[i] = sys::MemoryBlock((void*)(Addr + Size),
                                              EndOfBlock - Addr - Size);
+      MemGroup.PendingMem.push_back(sys::MemoryBlock((void*)Addr, Size));
       return (uint8_t*)Addr;
     }
   }
 
-  // No pre-allocated free block was large enough. Allocate a new memory region.
-  // Note that all sections get allocated as read-write.  The permissions will
-  // be updated later based on memory group.
-  //
-  // FIXME: It would be useful to define a default allocation size (or add
-  // it as a constructor parameter) to minimize the number of allocations.
-  //
-  // FIXME: Initialize the Near member for each memory group to avoid
-  // interleaving.
+  // No pre-allocated free block was large enough. Take a new memory region
+  // from the pool.  Note that all sections get allocated as read-write.  The
+  // permissions will be updated later based on memory group.
   std::error_code ec;
-  sys::MemoryBlock MB = sys::Memory::allocateMappedMemory(RequiredSize,
-                                                          &MemGroup.Near,
-                                                          sys::Memory::MF_READ |
-                                                            sys::Memory::MF_WRITE,
-                                                          ec);
+  sys::MemoryBlock MB = Pool->allocate(RequiredSize, ec);
   if (ec) {
     // FIXME: Add error propagation to the interface.
     return nullptr;
   }
 
-  // Save this address as the basis for our next request
-  MemGroup.Near = MB;
-
   MemGroup.AllocatedMem.push_back(MB);
   Addr = (uintptr_t)MB.base();
   uintptr_t EndOfBlock = Addr + MB.size();
@@ -97,6 +222,7 @@ uint8_t *SectionMemoryManager::allocateSection(MemoryGroup &MemGroup,
   unsigned FreeSize = EndOfBlock-Addr-Size;
   if (FreeSize > 16)
     MemGroup.FreeMem.push_back(sys::MemoryBlock((void*)(Addr + Size), FreeSize));
+  MemGroup.PendingMem.push_back(sys::MemoryBlock((void*)Addr, Size));
 
   // Return aligned address
   return (uint8_t*)Addr;
@@ -107,9 +233,6 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   // FIXME: Should in-progress permissions be reverted if an error occurs?
   std::error_code ec;
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  CodeMem.FreeMem.clear();
-
   // Make code memory executable.
   ec = applyMemoryGroupPermissions(CodeMem,
                                    sys::Memory::MF_READ | sys::Memory::MF_EXEC);
@@ -120,9 +243,6 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
     return true;
   }
 
-  // Don't allow free memory blocks to be used after setting protection flags.
-  RODataMem.FreeMem.clear();
-
   // Make read-only data memory read-only.
   ec = applyMemoryGroupPermissions(RODataMem,
                                    sys::Memory::MF_READ | sys::Memory::MF_EXEC);
@@ -134,6 +254,7 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
   }
 
   // Read-write data memory already has the correct permissions
+  RWDataMem.PendingMem.clear();
 
   // Some platforms with separate data cache and instruction cache require
   // explicit cache flush, otherwise JIT code manipulations (like resolved
@@ -146,16 +267,57 @@ bool SectionMemoryManager::finalizeMemory(std::string *ErrMsg)
 std::error_code
 SectionMemoryManager::applyMemoryGroupPermissions(MemoryGroup &MemGroup,
                                                   unsigned Permissions) {
+  // Only the pages holding memory allocated since the last finalization need
+  // new permissions; earlier pages already have them.
+  uintptr_t PageSize = sys::Process::getPageSize();
+  SmallVector<std::pair<uintptr_t, uintptr_t>, 16> Pages;
+  for (const sys::MemoryBlock &MB : MemGroup.PendingMem) {
+    uintptr_t Start = (uintptr_t)MB.base() & ~(PageSize - 1);
+    uintptr_t End = RoundUpToAlignment((uintptr_t)MB.base() + MB.size(), PageSize);
+    Pages.push_back(std::make_pair(Start, End));
+  }
+  MemGroup.PendingMem.clear();
+  std::sort(Pages.begin(), Pages.end());
 
-  for (int i = 0, e = MemGroup.AllocatedMem.size(); i != e; ++i) {
-    std::error_code ec;
-    ec =
-        sys::Memory::protectMappedMemory(MemGroup.AllocatedMem[i], Permissions);
+  // Merge overlapping and adjacent runs of pages, so each run is protected
+  // by a single call.
+  unsigned NumRuns = 0;
+  for (const auto &Run : Pages) {
+    if (NumRuns && Run.first <= Pages[NumRuns - 1].second)
+      Pages[NumRuns - 1].second = std::max(Pages[NumRuns - 1].second,
+                                           Run.second);
+    else
+      Pages[NumRuns++] = Run;
+  }
+  Pages.resize(NumRuns);
+
+  for (const auto &Run : Pages) {
+    std::error_code ec = sys::Memory::protectMappedMemory(
+        sys::MemoryBlock((void*)Run.first, Run.second - Run.first),
+        Permissions);
     if (ec) {
       return ec;
     }
   }
 
+  // Don't allow free memory on pages that are no longer writable to be used.
+  // The rest of each free block stays available.
+  SmallVector<sys::MemoryBlock, 16> FreeMem;
+  for (const sys::MemoryBlock &MB : MemGroup.FreeMem) {
+    uintptr_t Start = (uintptr_t)MB.base();
+    uintptr_t End = Start + MB.size();
+    for (const auto &Run : Pages) {
+      if (Run.second <= Start || Run.first >= End)
+        continue;
+      if (Run.first > Start)
+        FreeMem.push_back(sys::MemoryBlock((void*)Start, Run.first - Start));
+      Start = std::min(End, Run.second);
+    }
+    if (End - Start > 16)
+      FreeMem.push_back(sys::MemoryBlock((void*)Start, End - Start));
+  }
+  MemGroup.FreeMem = std::move(FreeMem);
+
   return std::error_code();
 }
 
@@ -167,11 +329,11 @@ void SectionMemoryManager::invalidateInstructionCache() {
 
 SectionMemoryManager::~SectionMemoryManager() {
   for (unsigned i = 0, e = CodeMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(CodeMem.AllocatedMem[i]);
+    Pool->release(CodeMem.AllocatedMem[i]);
   for (unsigned i = 0, e = RWDataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RWDataMem.AllocatedMem[i]);
+    Pool->release(RWDataMem.AllocatedMem[i]);
   for (unsigned i = 0, e = RODataMem.AllocatedMem.size(); i != e; ++i)
-    sys::Memory::releaseMappedMemory(RODataMem.AllocatedMem[i]);
+    Pool->release(RODataMem.AllocatedMem[i]);
 }
 
 } // namespace llvm
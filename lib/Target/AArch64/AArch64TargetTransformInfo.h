@@ -76,6 +76,9 @@ public:
   /// \name Vector TTI Implementations
   /// @{
 
+  // Interleaved groups are lowered to ldN/stN by the InterleavedAccess pass.
+  bool enableInterleavedAccessVectorization() { return true; }
+
   unsigned getNumberOfRegisters(bool Vector) {
     if (Vector) {
       if (ST->hasNEON())
@@ -96,6 +99,9 @@ public:
 
   unsigned getMaxInterleaveFactor(unsigned VF);
 
+  // All current AArch64 cores have at least a 32KB L1 data cache.
+  unsigned getCacheSize() { return 32 * 1024; }
+
   unsigned getCastInstrCost(unsigned Opcode, Type *Dst, Type *Src);
 
   unsigned getVectorInstrCost(unsigned Opcode, Type *Val, unsigned Index);
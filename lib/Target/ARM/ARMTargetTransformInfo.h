@@ -63,6 +63,9 @@ public:
   /// \name Vector TTI Implementations
   /// @{
 
+  // Interleaved groups are lowered to vldN/vstN by the InterleavedAccess pass.
+  bool enableInterleavedAccessVectorization() { return true; }
+
   unsigned getNumberOfRegisters(bool Vector) {
     if (Vector) {
       if (ST->hasNEON())
@@ -84,6 +84,14 @@ unsigned X86TTIImpl::getMaxInterleaveFactor(unsigned VF) {
   return 2;
 }
 
+unsigned X86TTIImpl::getCacheSize() {
+  // Atom and Silvermont have a 24KB L1 data cache; the big cores since Core 2
+  // all have 32KB.
+  if (ST->isAtom() || ST->isSLM())
+    return 24 * 1024;
+  return 32 * 1024;
+}
+
 unsigned X86TTIImpl::getArithmeticInstrCost(
     unsigned Opcode, Type *Ty, TTI::OperandValueKind Op1Info,
     TTI::OperandValueKind Op2Info, TTI::OperandValueProperties Opd1PropInfo,
@@ -11,7 +11,9 @@
 // call-graph, looking for functions which do not access or only read
 // non-local memory, and marking them readnone/readonly.  It does the
 // same with function arguments independently, marking them readonly/
-// readnone/nocapture.  Finally, well-known library call declarations
+// readnone/nocapture, and with return values, marking them noalias/nonnull/
+// dereferenceable.
+// Finally, well-known library call declarations
 // are marked with all attributes that are consistent with the
 // function's standard definition. This pass is implemented as a
 // bottom-up traversal of the call-graph.
@@ -19,6 +21,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
@@ -27,11 +30,16 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include "llvm/Analysis/CaptureTracking.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DataLayout.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "functionattrs"
@@ -42,6 +50,10 @@ STATISTIC(NumNoCapture, "Number of arguments marked nocapture");
 STATISTIC(NumReadNoneArg, "Number of arguments marked readnone");
 STATISTIC(NumReadOnlyArg, "Number of arguments marked readonly");
 STATISTIC(NumNoAlias, "Number of function returns marked noalias");
+STATISTIC(NumNonNullReturn, "Number of function returns marked nonnull");
+STATISTIC(NumDereferenceableReturn,
+          "Number of function returns marked dereferenceable");
+STATISTIC(NumNoUnwind, "Number of functions marked nounwind");
 STATISTIC(NumAnnotated, "Number of attributes added to library functions");
 
 namespace {
@@ -67,6 +79,23 @@ namespace {
     // AddNoAliasAttrs - Deduce noalias attributes for the SCC.
     bool AddNoAliasAttrs(const CallGraphSCC &SCC);
 
+    // IsReturnNonNull - Is this function known not to return null?
+    bool IsReturnNonNull(Function *F, SmallPtrSet<Function*, 8> &,
+                         bool &Speculative) const;
+
+    // AddNonNullAttrs - Deduce nonnull attributes for the SCC.
+    bool AddNonNullAttrs(const CallGraphSCC &SCC);
+
+    // ReturnDereferenceableBytes - How many bytes can be dereferenced through
+    // any pointer this function returns?
+    uint64_t ReturnDereferenceableBytes(Function *F) const;
+
+    // AddDereferenceableAttrs - Deduce dereferenceable attributes for the SCC.
+    bool AddDereferenceableAttrs(const CallGraphSCC &SCC);
+
+    // AddNoUnwindAttrs - Deduce nounwind attributes for the SCC.
+    bool AddNoUnwindAttrs(const CallGraphSCC &SCC);
+
     // Utility methods used by inferPrototypeAttributes to add attributes
     // and maintain annotation statistics.
 
@@ -836,6 +865,310 @@ bool FunctionAttrs::AddNoAliasAttrs(const CallGraphSCC &SCC) {
   return MadeChange;
 }
 
+/// IsReturnNonNull - Tests whether this function is known not to return null.
+/// Calls to functions in the SCC are assumed to return nonnull pointers; if
+/// the result depends on that assumption, Speculative is set to true.
+bool FunctionAttrs::IsReturnNonNull(Function *F,
+                                    SmallPtrSet<Function*, 8> &SCCNodes,
+                                    bool &Speculative) const {
+  assert(F->getReturnType()->isPointerTy() &&
+         "nonnull only meaningful on pointer types");
+  Speculative = false;
+
+  SmallSetVector<Value *, 8> FlowsToReturn;
+  for (Function::iterator I = F->begin(), E = F->end(); I != E; ++I)
+    if (ReturnInst *Ret = dyn_cast<ReturnInst>(I->getTerminator()))
+      FlowsToReturn.insert(Ret->getReturnValue());
+
+  for (unsigned i = 0; i != FlowsToReturn.size(); ++i) {
+    Value *RetVal = FlowsToReturn[i];
+
+    // If this value is locally known to be non-null, we're good.
+    if (isKnownNonNull(RetVal, TLI))
+      continue;
+
+    // Otherwise, we need to look upwards since we can't make any local
+    // conclusions.
+    Instruction *RVI = dyn_cast<Instruction>(RetVal);
+    if (!RVI)
+      return false;
+    switch (RVI->getOpcode()) {
+      // Extend the analysis by looking upwards.
+      case Instruction::BitCast:
+        FlowsToReturn.insert(RVI->getOperand(0));
+        continue;
+      case Instruction::GetElementPtr:
+        // Only an inbounds GEP of a nonnull pointer is known to be nonnull.
+        if (!cast<GetElementPtrInst>(RVI)->isInBounds())
+          return false;
+        FlowsToReturn.insert(RVI->getOperand(0));
+        continue;
+      case Instruction::Select: {
+        SelectInst *SI = cast<SelectInst>(RVI);
+        FlowsToReturn.insert(SI->getTrueValue());
+        FlowsToReturn.insert(SI->getFalseValue());
+        continue;
+      }
+      case Instruction::PHI: {
+        PHINode *PN = cast<PHINode>(RVI);
+        for (Value *IncValue : PN->incoming_values())
+          FlowsToReturn.insert(IncValue);
+        continue;
+      }
+      case Instruction::Call:
+      case Instruction::Invoke: {
+        CallSite CS(RVI);
+        Function *Callee = CS.getCalledFunction();
+        // A call to a node within the SCC is assumed to return nonnull until
+        // proven otherwise.
+        if (Callee && SCCNodes.count(Callee)) {
+          Speculative = true;
+          continue;
+        }
+        return false;
+      }
+      default:
+        return false;  // Unknown source, may be null.
+    }
+  }
+
+  return true;
+}
+
+/// AddNonNullAttrs - Deduce nonnull attributes for the SCC.
+bool FunctionAttrs::AddNonNullAttrs(const CallGraphSCC &SCC) {
+  SmallPtrSet<Function*, 8> SCCNodes;
+
+  // Fill SCCNodes with the elements of the SCC.  Used for quickly
+  // looking up whether a given CallGraphNode is in this SCC.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I)
+    SCCNodes.insert((*I)->getFunction());
+
+  // Speculate that all functions in the SCC return only nonnull pointers.  We
+  // may refute this as we analyze the functions.
+  bool SCCReturnsNonNull = true;
+
+  bool MadeChange = false;
+
+  // Check each function in turn, determining which functions return nonnull
+  // pointers.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    if (!F || F->hasFnAttribute(Attribute::OptimizeNone))
+      // External node or node we don't want to optimize - skip it;
+      return MadeChange;
+
+    // Already nonnull.
+    if (F->getAttributes().hasAttribute(AttributeSet::ReturnIndex,
+                                        Attribute::NonNull))
+      continue;
+
+    // Definitions with weak linkage may be overridden at linktime, so
+    // treat them like declarations.
+    if (F->isDeclaration() || F->mayBeOverridden())
+      return MadeChange;
+
+    // We annotate nonnull return values, which are only applicable to
+    // pointer types.
+    if (!F->getReturnType()->isPointerTy())
+      continue;
+
+    bool Speculative = false;
+    if (IsReturnNonNull(F, SCCNodes, Speculative)) {
+      if (!Speculative) {
+        // Mark the function eagerly since we may discover a function
+        // which prevents us from speculating about the entire SCC.
+        DEBUG(dbgs() << "Eagerly marking " << F->getName() << " as nonnull\n");
+        F->addAttribute(AttributeSet::ReturnIndex, Attribute::NonNull);
+        ++NumNonNullReturn;
+        MadeChange = true;
+      }
+      continue;
+    }
+    // At least one function returns something which could be null, can't
+    // speculate any more.
+    SCCReturnsNonNull = false;
+  }
+
+  if (SCCReturnsNonNull) {
+    for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+      Function *F = (*I)->getFunction();
+      if (F->getAttributes().hasAttribute(AttributeSet::ReturnIndex,
+                                          Attribute::NonNull) ||
+          !F->getReturnType()->isPointerTy())
+        continue;
+
+      DEBUG(dbgs() << "SCC marking " << F->getName() << " as nonnull\n");
+      F->addAttribute(AttributeSet::ReturnIndex, Attribute::NonNull);
+      ++NumNonNullReturn;
+      MadeChange = true;
+    }
+  }
+
+  return MadeChange;
+}
+
+/// ReturnDereferenceableBytes - Returns the number of bytes that are known to
+/// be dereferenceable through every pointer this function returns, or zero.
+uint64_t FunctionAttrs::ReturnDereferenceableBytes(Function *F) const {
+  assert(F->getReturnType()->isPointerTy() &&
+         "dereferenceable only meaningful on pointer types");
+  const DataLayout &DL = F->getParent()->getDataLayout();
+
+  // The offset of each value from the returned pointer.  A value reached at
+  // two different offsets, such as a pointer advanced in a loop, is given up
+  // on.
+  SmallDenseMap<Value *, uint64_t, 8> Offsets;
+  SmallVector<Value *, 8> Worklist;
+  auto Visit = [&](Value *V, uint64_t Offset) {
+    auto Inserted = Offsets.insert(std::make_pair(V, Offset));
+    if (Inserted.second)
+      Worklist.push_back(V);
+    return Inserted.first->second == Offset;
+  };
+
+  for (Function::iterator I = F->begin(), E = F->end(); I != E; ++I)
+    if (ReturnInst *Ret = dyn_cast<ReturnInst>(I->getTerminator()))
+      Visit(Ret->getReturnValue(), 0);
+
+  uint64_t MinBytes = ~0ULL;
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    uint64_t Offset = Offsets[V];
+
+    // The number of bytes known to be dereferenceable from V itself, or zero
+    // if V has to be looked through.
+    uint64_t Bytes = 0;
+    if (Argument *A = dyn_cast<Argument>(V)) {
+      Bytes = A->getDereferenceableBytes();
+    } else if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V)) {
+      // Weak external globals may resolve to null.
+      Type *Ty = GV->getType()->getElementType();
+      if (!GV->hasExternalWeakLinkage() && Ty->isSized())
+        Bytes = DL.getTypeStoreSize(Ty);
+    } else if (isa<CallInst>(V) || isa<InvokeInst>(V)) {
+      CallSite CS(V);
+      Bytes = CS.getDereferenceableBytes(AttributeSet::ReturnIndex);
+      if (Function *Callee = CS.getCalledFunction())
+        Bytes = std::max(
+            Bytes, Callee->getDereferenceableBytes(AttributeSet::ReturnIndex));
+    } else if (BitCastOperator *BC = dyn_cast<BitCastOperator>(V)) {
+      if (!Visit(BC->getOperand(0), Offset))
+        return 0;
+      continue;
+    } else if (GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+      // Only a constant, non-negative step into the base object is followed.
+      APInt GEPOffset(DL.getPointerTypeSizeInBits(GEP->getType()), 0);
+      if (!GEP->isInBounds() || !GEP->accumulateConstantOffset(DL, GEPOffset) ||
+          GEPOffset.isNegative() ||
+          !Visit(GEP->getPointerOperand(), Offset + GEPOffset.getZExtValue()))
+        return 0;
+      continue;
+    } else if (SelectInst *SI = dyn_cast<SelectInst>(V)) {
+      if (!Visit(SI->getTrueValue(), Offset) ||
+          !Visit(SI->getFalseValue(), Offset))
+        return 0;
+      continue;
+    } else if (PHINode *PN = dyn_cast<PHINode>(V)) {
+      for (Value *IncValue : PN->incoming_values())
+        if (!Visit(IncValue, Offset))
+          return 0;
+      continue;
+    }
+
+    if (Bytes <= Offset)
+      return 0;
+    MinBytes = std::min(MinBytes, Bytes - Offset);
+  }
+
+  return MinBytes == ~0ULL ? 0 : MinBytes;
+}
+
+/// AddDereferenceableAttrs - Deduce dereferenceable attributes for the SCC.
+/// Unlike nonnull, nothing is assumed about calls within the SCC, so each
+/// function is handled on its own.
+bool FunctionAttrs::AddDereferenceableAttrs(const CallGraphSCC &SCC) {
+  bool MadeChange = false;
+
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    // Skip external nodes, nodes we don't want to optimize and definitions
+    // that may be overridden at link time.
+    if (!F || F->hasFnAttribute(Attribute::OptimizeNone) ||
+        F->isDeclaration() || F->mayBeOverridden() ||
+        !F->getReturnType()->isPointerTy())
+      continue;
+
+    uint64_t Bytes = ReturnDereferenceableBytes(F);
+    if (Bytes <= F->getDereferenceableBytes(AttributeSet::ReturnIndex))
+      continue;
+
+    DEBUG(dbgs() << "Marking " << F->getName() << " as dereferenceable("
+                 << Bytes << ")\n");
+    F->removeAttributes(AttributeSet::ReturnIndex,
+                        AttributeSet::get(F->getContext(),
+                                          AttributeSet::ReturnIndex,
+                                          Attribute::Dereferenceable));
+    F->addDereferenceableAttr(AttributeSet::ReturnIndex, Bytes);
+    ++NumDereferenceableReturn;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
+/// AddNoUnwindAttrs - Deduce nounwind attributes for the SCC.  No function in
+/// the SCC unwinds if none of them resumes unwinding, and every call that is
+/// not an invoke is known not to throw or stays within the SCC.  Exceptions
+/// raised by invoked callees are caught by their landing pads, and can only
+/// escape through a resume.
+bool FunctionAttrs::AddNoUnwindAttrs(const CallGraphSCC &SCC) {
+  SmallPtrSet<Function*, 8> SCCNodes;
+
+  // Fill SCCNodes with the elements of the SCC.  Used for quickly
+  // looking up whether a given CallGraphNode is in this SCC.
+  for (CallGraphSCC::iterator I = SCC.begin(), E = SCC.end(); I != E; ++I) {
+    Function *F = (*I)->getFunction();
+
+    // External nodes and definitions that may be overridden at link time
+    // may unwind.
+    if (!F || F->hasFnAttribute(Attribute::OptimizeNone) ||
+        F->isDeclaration() || F->mayBeOverridden())
+      return false;
+    SCCNodes.insert(F);
+  }
+
+  for (Function *F : SCCNodes) {
+    if (F->doesNotThrow())
+      continue;
+    for (inst_iterator II = inst_begin(F), E = inst_end(F); II != E; ++II) {
+      if (isa<ResumeInst>(*II))
+        return false;
+      CallInst *CI = dyn_cast<CallInst>(&*II);
+      if (!CI || CI->doesNotThrow())
+        continue;
+      Function *Callee = CI->getCalledFunction();
+      if (!Callee || !SCCNodes.count(Callee))
+        return false;
+    }
+  }
+
+  bool MadeChange = false;
+  for (Function *F : SCCNodes) {
+    if (F->doesNotThrow())
+      continue;
+
+    DEBUG(dbgs() << "Marking " << F->getName() << " as nounwind\n");
+    F->setDoesNotThrow();
+    ++NumNoUnwind;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
 /// inferPrototypeAttributes - Analyze the name and prototype of the
 /// given function and set any applicable attributes.  Returns true
 /// if any attributes were set and false otherwise.
@@ -1711,5 +2044,8 @@ bool FunctionAttrs::runOnSCC(CallGraphSCC &SCC) {
   Changed |= AddReadAttrs(SCC);
   Changed |= AddArgumentAttrs(SCC);
   Changed |= AddNoAliasAttrs(SCC);
+  Changed |= AddNonNullAttrs(SCC);
+  Changed |= AddDereferenceableAttrs(SCC);
+  Changed |= AddNoUnwindAttrs(SCC);
   return Changed;
 }
@@ -13,9 +13,15 @@
 // deletes whatever is left over.  This allows it to delete recursive chunks of
 // the program which are unreachable.
 //
+// Liveness is computed from a graph of the dependencies between global values,
+// built from their use lists.  The graph is rebuilt from scratch on every run:
+// it is not kept alive between runs, nor updated by GlobalOpt or Internalize,
+// so repeated runs in the LTO pipeline each pay for a full module walk.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Constants.h"
@@ -47,13 +53,36 @@ namespace {
 
   private:
     SmallPtrSet<GlobalValue*, 32> AliveGlobals;
-    SmallPtrSet<Constant *, 8> SeenConstants;
+
+    /// GVDependencies - Maps each global value to the globals that it uses,
+    /// i.e. the globals that must be kept alive if it is alive.
+    DenseMap<GlobalValue *, SmallPtrSet<GlobalValue *, 4>> GVDependencies;
+
+    /// ConstantDependenciesCache - The global values that (transitively) use
+    /// each constant, so that constant expressions shared by many users are
+    /// only walked once.
+    std::unordered_map<Constant *, SmallPtrSet<GlobalValue *, 8>>
+        ConstantDependenciesCache;
+
     std::unordered_multimap<Comdat *, GlobalValue *> ComdatMembers;
 
-    /// GlobalIsNeeded - mark the specific global value as needed, and
-    /// recursively mark anything that it uses as also needed.
-    void GlobalIsNeeded(GlobalValue *GV);
-    void MarkUsedGlobalsAsNeeded(Constant *C);
+    /// UpdateGVDependencies - Record GV as a dependency of every global value
+    /// that uses it.
+    void UpdateGVDependencies(GlobalValue &GV);
+
+    /// ComputeDependencies - Add to Deps the global values that contain or
+    /// are the user V.
+    void ComputeDependencies(Value *V, SmallPtrSetImpl<GlobalValue *> &Deps);
+
+    /// MarkLive - Mark GV and the other members of its comdat as alive,
+    /// adding the newly alive globals to Updates if it is non-null.
+    void MarkLive(GlobalValue &GV,
+                  SmallVectorImpl<GlobalValue *> *Updates = nullptr);
+
+    /// MarkGlobalsInConstantLive - Mark every global value referenced by C as
+    /// alive, adding the newly alive globals to Updates.
+    void MarkGlobalsInConstantLive(Constant *C,
+                                   SmallVectorImpl<GlobalValue *> &Updates);
 
     bool RemoveUnusedGlobalValue(GlobalValue &GV);
   };
@@ -91,14 +120,19 @@ bool GlobalDCE::runOnModule(Module &M) {
     if (Comdat *C = GA.getComdat())
       ComdatMembers.insert(std::make_pair(C, &GA));
 
-  // Loop over the module, adding globals which are obviously necessary.
+  // Loop over the module, adding globals which are obviously necessary, and
+  // record which globals each global value uses.  Walking the use lists of the
+  // globals, rather than the bodies of the live functions, keeps the cost
+  // proportional to the number of references to globals instead of to the
+  // size of the module.
   for (Module::iterator I = M.begin(), E = M.end(); I != E; ++I) {
     Changed |= RemoveUnusedGlobalValue(*I);
     // Functions with external linkage are needed if they have a body
     if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage()) {
       if (!I->isDiscardableIfUnused())
-        GlobalIsNeeded(I);
+        MarkLive(*I);
     }
+    UpdateGVDependencies(*I);
   }
 
   for (Module::global_iterator I = M.global_begin(), E = M.global_end();
@@ -108,16 +142,37 @@ bool GlobalDCE::runOnModule(Module &M) {
     // initializer.
     if (!I->isDeclaration() && !I->hasAvailableExternallyLinkage()) {
       if (!I->isDiscardableIfUnused())
-        GlobalIsNeeded(I);
+        MarkLive(*I);
     }
+    UpdateGVDependencies(*I);
   }
 
   for (Module::alias_iterator I = M.alias_begin(), E = M.alias_end();
        I != E; ++I) {
     Changed |= RemoveUnusedGlobalValue(*I);
     // Externally visible aliases are needed.
-    if (!I->isDiscardableIfUnused()) {
-      GlobalIsNeeded(I);
+    if (!I->isDiscardableIfUnused())
+      MarkLive(*I);
+    UpdateGVDependencies(*I);
+  }
+
+  // Propagate liveness from the roots through the dependency graph.
+  SmallVector<GlobalValue *, 64> NewLiveGVs(AliveGlobals.begin(),
+                                            AliveGlobals.end());
+  while (!NewLiveGVs.empty()) {
+    GlobalValue *LGV = NewLiveGVs.pop_back_val();
+    auto Deps = GVDependencies.find(LGV);
+    if (Deps != GVDependencies.end())
+      for (GlobalValue *GVD : Deps->second)
+        MarkLive(*GVD, &NewLiveGVs);
+
+    // Prefix and prologue data are not operands of the function, so the
+    // globals they reference are not found through the use lists.
+    if (Function *F = dyn_cast<Function>(LGV)) {
+      if (F->hasPrefixData())
+        MarkGlobalsInConstantLive(F->getPrefixData(), NewLiveGVs);
+      if (F->hasPrologueData())
+        MarkGlobalsInConstantLive(F->getPrologueData(), NewLiveGVs);
     }
   }
 
@@ -189,69 +244,76 @@ bool GlobalDCE::runOnModule(Module &M) {
 
   // Make sure that all memory is released
   AliveGlobals.clear();
-  SeenConstants.clear();
+  GVDependencies.clear();
+  ConstantDependenciesCache.clear();
   ComdatMembers.clear();
 
   return Changed;
 }
 
-/// GlobalIsNeeded - the specific global value as needed, and
-/// recursively mark anything that it uses as also needed.
-void GlobalDCE::GlobalIsNeeded(GlobalValue *G) {
+void GlobalDCE::ComputeDependencies(Value *V,
+                                    SmallPtrSetImpl<GlobalValue *> &Deps) {
+  if (Instruction *I = dyn_cast<Instruction>(V)) {
+    // Instructions holding prefix or prologue data have no parent; those
+    // references are handled when the owning function becomes alive.
+    if (BasicBlock *BB = I->getParent())
+      Deps.insert(BB->getParent());
+  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    Deps.insert(GV);
+  } else if (Constant *C = dyn_cast<Constant>(V)) {
+    // Avoid walking the users of a shared constant expression more than once.
+    auto Where = ConstantDependenciesCache.find(C);
+    if (Where != ConstantDependenciesCache.end()) {
+      Deps.insert(Where->second.begin(), Where->second.end());
+      return;
+    }
+    SmallPtrSetImpl<GlobalValue *> &LocalDeps = ConstantDependenciesCache[C];
+    for (User *CU : C->users())
+      ComputeDependencies(CU, LocalDeps);
+    Deps.insert(LocalDeps.begin(), LocalDeps.end());
+  }
+}
+
+void GlobalDCE::UpdateGVDependencies(GlobalValue &GV) {
+  SmallPtrSet<GlobalValue *, 8> Deps;
+  for (User *U : GV.users())
+    ComputeDependencies(U, Deps);
+  Deps.erase(&GV); // Remove self-reference.
+  for (GlobalValue *GVU : Deps)
+    GVDependencies[GVU].insert(&GV);
+}
+
+void GlobalDCE::MarkLive(GlobalValue &GV,
+                         SmallVectorImpl<GlobalValue *> *Updates) {
   // If the global is already in the set, no need to reprocess it.
-  if (!AliveGlobals.insert(G).second)
+  if (!AliveGlobals.insert(&GV).second)
     return;
 
-  if (Comdat *C = G->getComdat()) {
-    for (auto &&CM : make_range(ComdatMembers.equal_range(C)))
-      GlobalIsNeeded(CM.second);
-  }
+  if (Updates)
+    Updates->push_back(&GV);
 
-  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(G)) {
-    // If this is a global variable, we must make sure to add any global values
-    // referenced by the initializer to the alive set.
-    if (GV->hasInitializer())
-      MarkUsedGlobalsAsNeeded(GV->getInitializer());
-  } else if (GlobalAlias *GA = dyn_cast<GlobalAlias>(G)) {
-    // The target of a global alias is needed.
-    MarkUsedGlobalsAsNeeded(GA->getAliasee());
-  } else {
-    // Otherwise this must be a function object.  We have to scan the body of
-    // the function looking for constants and global values which are used as
-    // operands.  Any operands of these types must be processed to ensure that
-    // any globals used will be marked as needed.
-    Function *F = cast<Function>(G);
-
-    if (F->hasPrefixData())
-      MarkUsedGlobalsAsNeeded(F->getPrefixData());
-
-    if (F->hasPrologueData())
-      MarkUsedGlobalsAsNeeded(F->getPrologueData());
-
-    if (F->hasPersonalityFn())
-      MarkUsedGlobalsAsNeeded(F->getPersonalityFn());
-
-    for (Function::iterator BB = F->begin(), E = F->end(); BB != E; ++BB)
-      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
-        for (User::op_iterator U = I->op_begin(), E = I->op_end(); U != E; ++U)
-          if (GlobalValue *GV = dyn_cast<GlobalValue>(*U))
-            GlobalIsNeeded(GV);
-          else if (Constant *C = dyn_cast<Constant>(*U))
-            MarkUsedGlobalsAsNeeded(C);
-  }
+  // The recursion depth is at most two, since only members of the same comdat
+  // are visited.
+  if (Comdat *C = GV.getComdat())
+    for (auto &&CM : make_range(ComdatMembers.equal_range(C)))
+      MarkLive(*CM.second, Updates);
 }
 
-void GlobalDCE::MarkUsedGlobalsAsNeeded(Constant *C) {
-  if (GlobalValue *GV = dyn_cast<GlobalValue>(C))
-    return GlobalIsNeeded(GV);
-
-  // Loop over all of the operands of the constant, adding any globals they
-  // use to the list of needed globals.
-  for (User::op_iterator I = C->op_begin(), E = C->op_end(); I != E; ++I) {
-    // If we've already processed this constant there's no need to do it again.
-    Constant *Op = dyn_cast<Constant>(*I);
-    if (Op && SeenConstants.insert(Op).second)
-      MarkUsedGlobalsAsNeeded(Op);
+void GlobalDCE::MarkGlobalsInConstantLive(
+    Constant *C, SmallVectorImpl<GlobalValue *> &Updates) {
+  SmallPtrSet<Constant *, 8> Visited;
+  SmallVector<Constant *, 8> Worklist;
+  Worklist.push_back(C);
+  while (!Worklist.empty()) {
+    Constant *Cur = Worklist.pop_back_val();
+    if (GlobalValue *GV = dyn_cast<GlobalValue>(Cur)) {
+      MarkLive(*GV, &Updates);
+      continue;
+    }
+    for (User::op_iterator I = Cur->op_begin(), E = Cur->op_end(); I != E; ++I)
+      if (Constant *Op = dyn_cast<Constant>(*I))
+        if (Visited.insert(Op).second)
+          Worklist.push_back(Op);
   }
 }
 
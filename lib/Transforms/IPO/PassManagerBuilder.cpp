@@ -89,6 +89,14 @@ static cl::opt<bool> EnableLoopDistribute(
     "enable-loop-distribute", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopDistribution Pass"));
 
+static cl::opt<bool> EnableLoopFusion(
+    "enable-loop-fusion", cl::init(false), cl::Hidden,
+    cl::desc("Enable the new, experimental LoopFusion Pass"));
+
+static cl::opt<bool> EnableLoopTiling(
+    "enable-loop-tiling", cl::init(false), cl::Hidden,
+    cl::desc("Enable the new, experimental LoopTiling Pass"));
+
 PassManagerBuilder::PassManagerBuilder() {
     OptLevel = 2;
     SizeLevel = 0;
@@ -253,6 +261,8 @@ void PassManagerBuilder::populateModulePassManager(
     MPM.add(createLoopInterchangePass()); // Interchange loops
     MPM.add(createCFGSimplificationPass());
   }
+  if (EnableLoopTiling)
+    MPM.add(createLoopTilingPass());          // Tile loop nests
   if (!DisableUnrollLoops)
     MPM.add(createSimpleLoopUnrollPass());    // Unroll small loops
   addExtensionsToPM(EP_LoopOptimizerEnd, MPM);
@@ -323,6 +333,11 @@ void PassManagerBuilder::populateModulePassManager(
   // on the rotated form. Disable header duplication at -Oz.
   MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
 
+  // Fuse adjacent loops over the same iteration space before the vectorizer
+  // sees them, so that each array is streamed through once.
+  if (EnableLoopFusion)
+    MPM.add(createLoopFusionPass());
+
   // Distribute loops to allow partial vectorization.  I.e. isolate dependences
   // into separate loop that would otherwise inhibit vectorization.
   if (EnableLoopDistribute)
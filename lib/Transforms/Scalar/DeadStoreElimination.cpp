@@ -7,8 +7,11 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a trivial dead store elimination that only considers
-// basic-block local redundant stores.
+// This file implements a trivial dead store elimination that mostly considers
+// basic-block local redundant stores.  Stores are also removed from the
+// predecessors of a block when every path out of them falls through into a
+// store that overwrites them, or into a function exit at which the stored-to
+// stack object is dead.
 //
 // FIXME: This should eventually be extended to be a post-dominator tree
 // traversal.  Doing so would be pretty trivial.
@@ -18,6 +21,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/CaptureTracking.h"
@@ -33,6 +37,7 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -42,6 +47,12 @@ using namespace llvm;
 
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
+STATISTIC(NumNonLocalStores, "Number of stores deleted in predecessor blocks");
+
+static cl::opt<unsigned>
+MaxNonLocalBlocks("dse-max-nonlocal-blocks", cl::init(16), cl::Hidden,
+  cl::desc("Max number of predecessor blocks scanned for each store or "
+           "function exit by dead store elimination (default = 16)"));
 
 namespace {
   struct DSE : public FunctionPass {
@@ -77,7 +88,11 @@ namespace {
 
     bool runOnBasicBlock(BasicBlock &BB);
     bool HandleFree(CallInst *F);
+    bool handleNonLocalStore(Instruction *Inst);
     bool handleEndBlock(BasicBlock &BB);
+    void scanEndBlock(BasicBlock &BB,
+                      SmallSetVector<Value *, 16> &DeadStackObjects,
+                      SmallVectorImpl<Value *> &Erased, bool &MadeChange);
     void RemoveAccessedObjects(const MemoryLocation &LoadedLoc,
                                SmallSetVector<Value *, 16> &DeadStackObjects,
                                const DataLayout &DL);
@@ -116,7 +131,8 @@ FunctionPass *llvm::createDeadStoreEliminationPass() { return new DSE(); }
 static void DeleteDeadInstruction(Instruction *I,
                                MemoryDependenceAnalysis &MD,
                                const TargetLibraryInfo *TLI,
-                               SmallSetVector<Value*, 16> *ValueSet = nullptr) {
+                               SmallSetVector<Value*, 16> *ValueSet = nullptr,
+                               SmallVectorImpl<Value*> *Erased = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
 
   NowDeadInsts.push_back(I);
@@ -146,7 +162,8 @@ static void DeleteDeadInstruction(Instruction *I,
 
     DeadInst->eraseFromParent();
 
-    if (ValueSet) ValueSet->remove(DeadInst);
+    if (ValueSet && ValueSet->remove(DeadInst) && Erased)
+      Erased->push_back(DeadInst);
   } while (!NowDeadInsts.empty());
 }
 
@@ -493,8 +510,14 @@ bool DSE::runOnBasicBlock(BasicBlock &BB) {
 
     MemDepResult InstDep = MD->getDependency(Inst);
 
-    // Ignore any store where we can't find a local dependence.
-    // FIXME: cross-block DSE would be fun. :)
+    // Nothing earlier in the block touches the stored location; look for
+    // stores it overwrites in the predecessors instead.
+    if (InstDep.isNonLocal()) {
+      MadeChange |= handleNonLocalStore(Inst);
+      continue;
+    }
+
+    // Ignore any store where we can't find a dependence.
     if (!InstDep.isDef() && !InstDep.isClobber())
       continue;
 
@@ -640,6 +663,64 @@ static void FindUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
   }
 }
 
+/// handleNonLocalStore - Remove stores in the predecessors of Inst's block
+/// that Inst completely overwrites.  Inst must have no dependence in its own
+/// block.  Only predecessors that branch unconditionally are considered, so
+/// that every path from a removed store falls through into Inst.
+bool DSE::handleNonLocalStore(Instruction *Inst) {
+  MemoryLocation Loc = getLocForWrite(Inst, *AA);
+  if (!Loc.Ptr)
+    return false;
+
+  BasicBlock *BB = Inst->getParent();
+  const DataLayout &DL = BB->getModule()->getDataLayout();
+  bool MadeChange = false;
+
+  SmallVector<BasicBlock *, 16> Blocks;
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  FindUnconditionalPreds(Blocks, BB, DT);
+  unsigned NumScanned = 0;
+
+  while (!Blocks.empty()) {
+    BasicBlock *Pred = Blocks.pop_back_val();
+    // Skip blocks we have seen, and backedges: a store reached around a loop
+    // is not overwritten by the current iteration's store.
+    if (!Visited.insert(Pred).second || DT->dominates(BB, Pred))
+      continue;
+    if (++NumScanned > MaxNonLocalBlocks)
+      break;
+
+    MemDepResult Dep =
+        MD->getPointerDependencyFrom(Loc, false, Pred->getTerminator(), Pred);
+    if (Dep.isNonLocal()) {
+      FindUnconditionalPreds(Blocks, Pred, DT);
+      continue;
+    }
+    if (!Dep.isDef() && !Dep.isClobber())
+      continue;
+
+    Instruction *DepWrite = Dep.getInst();
+    if (!hasMemoryWrite(DepWrite, TLI) || !isRemovable(DepWrite))
+      continue;
+    MemoryLocation DepLoc = getLocForWrite(DepWrite, *AA);
+    if (!DepLoc.Ptr || isPossibleSelfRead(Inst, Loc, DepWrite, *AA))
+      continue;
+
+    int64_t InstWriteOffset, DepWriteOffset;
+    if (isOverwrite(Loc, DepLoc, DL, TLI, DepWriteOffset, InstWriteOffset) !=
+        OverwriteComplete)
+      continue;
+
+    DEBUG(dbgs() << "DSE: Remove Non-Local Dead Store:\n  DEAD: "
+                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
+    DeleteDeadInstruction(DepWrite, *MD, TLI);
+    ++NumNonLocalStores;
+    MadeChange = true;
+  }
+
+  return MadeChange;
+}
+
 /// HandleFree - Handle frees of entire structures whose dependency is a store
 /// to a field of that structure.
 bool DSE::HandleFree(CallInst *F) {
@@ -722,6 +803,49 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     if (AI->hasByValOrInAllocaAttr())
       DeadStackObjects.insert(AI);
 
+  // Scan the exit block, then keep going into the predecessors that fall
+  // through into a block already scanned: whatever is dead on entry to that
+  // block is dead at the end of the predecessor.
+  typedef std::pair<BasicBlock *, SmallSetVector<Value *, 16>> WorkItem;
+  SmallVector<WorkItem, 8> Worklist;
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  Worklist.push_back(WorkItem(&BB, DeadStackObjects));
+  unsigned NumScanned = 0;
+
+  while (!Worklist.empty()) {
+    WorkItem Item = Worklist.pop_back_val();
+    BasicBlock *Cur = Item.first;
+    if (!Visited.insert(Cur).second)
+      continue;
+    if (Cur != &BB && ++NumScanned > MaxNonLocalBlocks)
+      break;
+
+    SmallVector<Value *, 4> Erased;
+    scanEndBlock(*Cur, Item.second, Erased, MadeChange);
+    // An object deleted along with its last store is gone on every path, not
+    // just on this one; the sets of the pending blocks must forget it too.
+    for (Value *V : Erased)
+      for (WorkItem &Pending : Worklist)
+        Pending.second.remove(V);
+    if (Item.second.empty())
+      continue;
+
+    SmallVector<BasicBlock *, 4> Preds;
+    FindUnconditionalPreds(Preds, Cur, DT);
+    for (BasicBlock *Pred : Preds)
+      Worklist.push_back(WorkItem(Pred, Item.second));
+  }
+
+  return MadeChange;
+}
+
+/// scanEndBlock - Scan BB backwards, removing stores to objects in
+/// DeadStackObjects, which must be dead at the end of BB.  On return
+/// DeadStackObjects holds the objects that are dead on entry to BB, and
+/// Erased holds the objects that were deleted because they became unused.
+void DSE::scanEndBlock(BasicBlock &BB,
+                       SmallSetVector<Value *, 16> &DeadStackObjects,
+                       SmallVectorImpl<Value *> &Erased, bool &MadeChange) {
   const DataLayout &DL = BB.getModule()->getDataLayout();
 
   // Scan the basic block backwards
@@ -757,7 +881,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects);
+        DeleteDeadInstruction(Dead, *MD, TLI, &DeadStackObjects, &Erased);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -767,7 +891,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(BBI, TLI)) {
       Instruction *Inst = BBI++;
-      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects);
+      DeleteDeadInstruction(Inst, *MD, TLI, &DeadStackObjects, &Erased);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -813,8 +937,10 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
 
     // If we encounter a use of the pointer, it is no longer considered dead
     if (LoadInst *L = dyn_cast<LoadInst>(BBI)) {
-      if (!L->isUnordered()) // Be conservative with atomic/volatile load
+      if (!L->isUnordered()) { // Be conservative with atomic/volatile load
+        DeadStackObjects.clear();
         break;
+      }
       LoadedLoc = MemoryLocation::get(L);
     } else if (VAArgInst *V = dyn_cast<VAArgInst>(BBI)) {
       LoadedLoc = MemoryLocation::get(V);
@@ -826,6 +952,7 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
       continue;
     } else {
       // Unknown inst; assume it clobbers everything.
+      DeadStackObjects.clear();
       break;
     }
 
@@ -838,8 +965,6 @@ bool DSE::handleEndBlock(BasicBlock &BB) {
     if (DeadStackObjects.empty())
       break;
   }
-
-  return MadeChange;
 }
 
 /// RemoveAccessedObjects - Check to see if the specified location may alias any
@@ -26,10 +26,13 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/CFG.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/Loads.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
 #include "llvm/Analysis/MemoryDependenceAnalysis.h"
 #include "llvm/Analysis/PHITransAddr.h"
@@ -68,6 +71,11 @@ static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
 
+static cl::opt<unsigned>
+MaxLoadPREPreds("max-load-pre-preds", cl::Hidden, cl::init(4),
+                cl::desc("Max number of predecessors load PRE may insert a "
+                         "load into (default = 4)"));
+
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
 MaxRecurseDepth("max-recurse-depth", cl::Hidden, cl::init(1000), cl::ZeroOrMore,
@@ -594,6 +602,12 @@ namespace {
     DominatorTree *DT;
     const TargetLibraryInfo *TLI;
     AssumptionCache *AC;
+    // Only load PRE into several predecessors needs block frequencies, so
+    // they are computed on first use by getBlockFreqInfo(), and dropped by
+    // releaseBlockFreqInfo() whenever GVN changes the CFG.
+    std::unique_ptr<LoopInfo> FreqLoops;
+    std::unique_ptr<BranchProbabilityInfo> BPI;
+    std::unique_ptr<BlockFrequencyInfo> BFI;
     SetVector<BasicBlock *> DeadBlocks;
 
     ValueTable VN;
@@ -704,6 +718,10 @@ namespace {
                                  UnavailBlkVect &UnavailableBlocks);
     bool PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock, 
                         UnavailBlkVect &UnavailableBlocks);
+    bool isLoadPREProfitable(BasicBlock *LoadBB,
+                             ArrayRef<BasicBlock *> UnavailablePreds);
+    BlockFrequencyInfo &getBlockFreqInfo(Function &F);
+    void releaseBlockFreqInfo();
 
     // Other helper routines
     bool processInstruction(Instruction *I);
@@ -1508,15 +1526,70 @@ void GVN::AnalyzeLoadAvailability(LoadInst *LI, LoadDepVect &Deps,
   }
 }
 
+/// Return true if it pays to replace the load in \p LoadBB with copies in each
+/// of \p UnavailablePreds.
+///
+/// The copies run on the edges into LoadBB, so they always execute less often
+/// than the original load.  Since they also grow the code, require that LoadBB
+/// is entered along edges where the value is available at least as often as
+/// along edges where it is not.
+bool GVN::isLoadPREProfitable(BasicBlock *LoadBB,
+                              ArrayRef<BasicBlock *> UnavailablePreds) {
+  if (UnavailablePreds.size() > MaxLoadPREPreds)
+    return false;
+
+  // The frequencies are recomputed after every CFG change, so a block
+  // without a frequency is unreachable; don't guess.
+  BlockFrequencyInfo &BlockFreqs = getBlockFreqInfo(*LoadBB->getParent());
+  uint64_t LoadFreq = BlockFreqs.getBlockFreq(LoadBB).getFrequency();
+  if (!LoadFreq)
+    return false;
+
+  uint64_t InsertedFreq = 0;
+  for (BasicBlock *Pred : UnavailablePreds) {
+    BlockFrequency PredFreq = BlockFreqs.getBlockFreq(Pred);
+    if (!PredFreq.getFrequency())
+      return false;
+    InsertedFreq +=
+        (PredFreq * BPI->getEdgeProbability(Pred, LoadBB)).getFrequency();
+  }
+
+  DEBUG(dbgs() << "GVN LOAD PRE: inserted frequency " << InsertedFreq
+               << " vs. load frequency " << LoadFreq << '\n');
+  return InsertedFreq <= LoadFreq && InsertedFreq <= LoadFreq - InsertedFreq;
+}
+
+/// Return the block frequencies of \p F, computing them (along with the loop
+/// info and branch probabilities they are derived from) on the first call.
+BlockFrequencyInfo &GVN::getBlockFreqInfo(Function &F) {
+  if (!BFI) {
+    FreqLoops.reset(new LoopInfo());
+    FreqLoops->Analyze(*DT);
+    BPI.reset(new BranchProbabilityInfo());
+    BPI->calculate(F, *FreqLoops);
+    BFI.reset(new BlockFrequencyInfo());
+    BFI->calculate(F, *BPI, *FreqLoops);
+  }
+  return *BFI;
+}
+
+/// Drop the block frequencies, which no longer describe the CFG once an edge
+/// has been split. They are recomputed on the next use.
+void GVN::releaseBlockFreqInfo() {
+  BFI.reset();
+  BPI.reset();
+  FreqLoops.reset();
+}
+
 bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock, 
                          UnavailBlkVect &UnavailableBlocks) {
   // Okay, we have *some* definitions of the value.  This means that the value
   // is available in some of our (transitive) predecessors.  Lets think about
   // doing PRE of this load.  This will involve inserting a new load into the
-  // predecessor when it's not available.  We could do this in general, but
-  // prefer to not increase code size.  As such, we only do this when we know
-  // that we only have to insert *one* load (which means we're basically moving
-  // the load, not inserting a new one).
+  // predecessor when it's not available.  When we only have to insert *one*
+  // load we're basically moving the load, not inserting a new one, so that is
+  // always done.  Inserting into several predecessors grows the code, so it
+  // is only done when block frequencies say fewer loads will execute.
 
   SmallPtrSet<BasicBlock *, 4> Blockers;
   for (unsigned i = 0, e = UnavailableBlocks.size(); i != e; ++i)
@@ -1589,12 +1662,19 @@ bool GVN::PerformLoadPRE(LoadInst *LI, AvailValInBlkVect &ValuesPerBlock,
   assert(NumUnavailablePreds != 0 &&
          "Fully available value should already be eliminated!");
 
-  // If this load is unavailable in multiple predecessors, reject it.
+  // If this load is unavailable in multiple predecessors, only PRE it if the
+  // inserted loads are expected to execute less often than the original.
   // FIXME: If we could restructure the CFG, we could make a common pred with
   // all the preds that don't have an available LI and insert a new load into
   // that one block.
-  if (NumUnavailablePreds != 1)
+  if (NumUnavailablePreds != 1) {
+    SmallVector<BasicBlock *, 4> UnavailablePreds(CriticalEdgePred.begin(),
+                                                  CriticalEdgePred.end());
+    for (const auto &PredLoad : PredLoads)
+      UnavailablePreds.push_back(PredLoad.first);
+    if (!isLoadPREProfitable(LoadBB, UnavailablePreds))
       return false;
+  }
 
   // Split critical edges, and update the unavailable predecessors accordingly.
   for (BasicBlock *OrigPred : CriticalEdgePred) {
@@ -2378,6 +2458,7 @@ bool GVN::runOnFunction(Function& F) {
   // Do not cleanup DeadBlocks in cleanupGlobalSets() as it's called for each
   // iteration. 
   DeadBlocks.clear();
+  releaseBlockFreqInfo();
 
   return Changed;
 }
@@ -2641,6 +2722,7 @@ BasicBlock *GVN::splitCriticalEdges(BasicBlock *Pred, BasicBlock *Succ) {
       Pred, Succ, CriticalEdgeSplittingOptions(getAliasAnalysis(), DT));
   if (MD)
     MD->invalidateCachedPredecessors();
+  releaseBlockFreqInfo();
   return BB;
 }
 
@@ -2655,6 +2737,7 @@ bool GVN::splitCriticalEdges() {
                       CriticalEdgeSplittingOptions(getAliasAnalysis(), DT));
   } while (!toSplit.empty());
   if (MD) MD->invalidateCachedPredecessors();
+  releaseBlockFreqInfo();
   return true;
 }
 
@@ -0,0 +1,398 @@
+//===- LoopFusion.cpp - Fuse adjacent loops -------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass fuses adjacent innermost loops that execute the same number of
+// iterations into a single loop, so that data produced by the first loop is
+// consumed by the second one while it is still in cache.
+//
+// Two loops L1 and L2 are candidates when:
+//  - both are innermost, in simplified and rotated form, and exit only from
+//    their latch;
+//  - the exit block of L1 is the preheader of L2 and contains nothing but
+//    instructions that can be hoisted above L1;
+//  - ScalarEvolution computes the same backedge-taken count for both;
+//  - no value defined in L1 is used outside of it.
+//
+// Fusion moves the body of L2 into the iteration of L1 that has the same
+// index. It is legal if no dependence from an access in L1 to an access in L2
+// is carried backwards by the fused loop, i.e. L2 never touches in iteration
+// j a location that L1 touches in a later iteration i > j. DependenceAnalysis
+// is used to discard independent pairs, and the remaining pairs must be
+// affine accesses with equal strides whose distance ScalarEvolution proves
+// safe.
+//
+// Fusion is only considered profitable when both loops access a common
+// underlying object, since that is where the memory traffic is saved.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-fusion"
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+
+static cl::opt<unsigned> FusionThreshold(
+    "loop-fusion-threshold", cl::init(200), cl::Hidden,
+    cl::desc("Maximum number of instructions in a fused loop"));
+
+namespace {
+
+typedef SmallVector<Instruction *, 16> MemInstList;
+
+struct LoopFusion : public FunctionPass {
+  static char ID; // Pass identification, replacement for typeid
+  LoopFusion()
+      : FunctionPass(ID), SE(nullptr), LI(nullptr), DA(nullptr), DT(nullptr),
+        DL(nullptr) {
+    initializeLoopFusionPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<ScalarEvolution>();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DependenceAnalysis>();
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  Loop *getFusionCandidate(Loop *L1);
+  bool collectMemoryAccesses(Loop *L, MemInstList &Accesses, unsigned &Size);
+  bool isSafeDependence(Instruction *Src, Instruction *Dst, Loop *L1,
+                        Loop *L2);
+  bool canFuse(Loop *L1, Loop *L2);
+  void fuse(Loop *L1, Loop *L2);
+
+  ScalarEvolution *SE;
+  LoopInfo *LI;
+  DependenceAnalysis *DA;
+  DominatorTree *DT;
+  const DataLayout *DL;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static Type *getAccessType(Instruction *I) {
+  if (auto *SI = dyn_cast<StoreInst>(I))
+    return SI->getValueOperand()->getType();
+  return I->getType();
+}
+
+/// Return the loop that directly follows \p L1, or null if there is none that
+/// has the shape required for fusion.
+Loop *LoopFusion::getFusionCandidate(Loop *L1) {
+  if (!L1->empty() || !L1->getLoopPreheader())
+    return nullptr;
+  BasicBlock *Latch = L1->getLoopLatch();
+  if (!Latch || L1->getExitingBlock() != Latch)
+    return nullptr;
+  BasicBlock *Exit = L1->getExitBlock();
+  if (!Exit)
+    return nullptr;
+  BasicBlock *Succ = Exit->getSingleSuccessor();
+  if (!Succ)
+    return nullptr;
+  Loop *L2 = LI->getLoopFor(Succ);
+  if (!L2 || L2 == L1 || L2->getHeader() != Succ || !L2->empty() ||
+      L2->getLoopPreheader() != Exit ||
+      L2->getParentLoop() != L1->getParentLoop())
+    return nullptr;
+  BasicBlock *Latch2 = L2->getLoopLatch();
+  if (!Latch2 || L2->getExitingBlock() != Latch2 || !L2->getExitBlock())
+    return nullptr;
+  return L2;
+}
+
+/// Collect the memory accesses of \p L into \p Accesses and count its
+/// instructions in \p Size. Returns false if \p L contains an instruction
+/// whose memory behavior cannot be reasoned about.
+bool LoopFusion::collectMemoryAccesses(Loop *L, MemInstList &Accesses,
+                                       unsigned &Size) {
+  for (BasicBlock *BB : L->getBlocks()) {
+    for (Instruction &I : *BB) {
+      ++Size;
+      if (!I.mayReadOrWriteMemory())
+        continue;
+      if (auto *LD = dyn_cast<LoadInst>(&I)) {
+        if (!LD->isSimple())
+          return false;
+      } else if (auto *ST = dyn_cast<StoreInst>(&I)) {
+        if (!ST->isSimple())
+          return false;
+      } else {
+        DEBUG(dbgs() << "LF: Unsupported memory instruction: " << I << "\n");
+        return false;
+      }
+      Accesses.push_back(&I);
+    }
+  }
+  return true;
+}
+
+/// Return true if executing \p Dst (in \p L2) in the same iteration as \p Src
+/// (in \p L1), instead of after all iterations of \p L1, cannot reorder
+/// conflicting accesses.
+bool LoopFusion::isSafeDependence(Instruction *Src, Instruction *Dst, Loop *L1,
+                                  Loop *L2) {
+  auto *SrcAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(getPointerOperand(Src)));
+  auto *DstAR =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(getPointerOperand(Dst)));
+  if (!SrcAR || !DstAR || SrcAR->getLoop() != L1 || DstAR->getLoop() != L2 ||
+      !SrcAR->isAffine() || !DstAR->isAffine())
+    return false;
+
+  // Both accesses must advance by the same constant number of bytes per
+  // iteration, and start a constant distance apart.
+  const SCEV *Step = SrcAR->getStepRecurrence(*SE);
+  auto *C = dyn_cast<SCEVConstant>(Step);
+  if (!C || Step != DstAR->getStepRecurrence(*SE) || C->getValue()->isZero())
+    return false;
+  auto *Dist = dyn_cast<SCEVConstant>(
+      SE->getMinusSCEV(DstAR->getStart(), SrcAR->getStart()));
+  if (!Dist)
+    return false;
+
+  int64_t Stride = C->getValue()->getSExtValue();
+  int64_t Distance = Dist->getValue()->getSExtValue();
+  int64_t SrcSize = DL->getTypeStoreSize(getAccessType(Src));
+  int64_t DstSize = DL->getTypeStoreSize(getAccessType(Dst));
+
+  // Iteration j of L2 must not overlap any iteration i > j of L1. With a
+  // positive stride, it has to stay entirely below the accesses of iteration
+  // j + 1 of L1; with a negative one, entirely above them.
+  if (Stride > 0)
+    return Distance + DstSize <= Stride;
+  return Distance >= Stride + SrcSize;
+}
+
+bool LoopFusion::canFuse(Loop *L1, Loop *L2) {
+  const SCEV *BTC = SE->getBackedgeTakenCount(L1);
+  if (isa<SCEVCouldNotCompute>(BTC) || BTC != SE->getBackedgeTakenCount(L2)) {
+    DEBUG(dbgs() << "LF: Trip counts differ or are unknown.\n");
+    return false;
+  }
+
+  if (!isa<BranchInst>(L1->getLoopLatch()->getTerminator()) ||
+      !isa<BranchInst>(L2->getLoopLatch()->getTerminator()))
+    return false;
+
+  // Everything between the loops is hoisted above L1.
+  BasicBlock *Between = L2->getLoopPreheader();
+  for (Instruction &I : *Between) {
+    if (&I == Between->getTerminator())
+      break;
+    if (isa<PHINode>(I) || I.mayReadOrWriteMemory() ||
+        !isSafeToSpeculativelyExecute(&I))
+      return false;
+    for (Value *Op : I.operands())
+      if (auto *OpI = dyn_cast<Instruction>(Op))
+        if (L1->contains(OpI))
+          return false;
+  }
+
+  // L2 can be moved into L1 only if it does not need L1's final values.
+  for (BasicBlock *BB : L1->getBlocks())
+    for (Instruction &I : *BB)
+      for (User *U : I.users())
+        if (!L1->contains(cast<Instruction>(U))) {
+          DEBUG(dbgs() << "LF: Value used outside of the first loop: " << I
+                       << "\n");
+          return false;
+        }
+
+  MemInstList Accesses1, Accesses2;
+  unsigned Size = 0;
+  if (!collectMemoryAccesses(L1, Accesses1, Size) ||
+      !collectMemoryAccesses(L2, Accesses2, Size))
+    return false;
+  if (Size > FusionThreshold) {
+    DEBUG(dbgs() << "LF: Fused loop would be too large.\n");
+    return false;
+  }
+
+  bool SharesObject = false;
+  for (Instruction *Src : Accesses1) {
+    Value *SrcObj = GetUnderlyingObject(getPointerOperand(Src), *DL);
+    for (Instruction *Dst : Accesses2) {
+      if (GetUnderlyingObject(getPointerOperand(Dst), *DL) == SrcObj)
+        SharesObject = true;
+      if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+        continue;
+      if (!DA->depends(Src, Dst, true))
+        continue;
+      if (!isSafeDependence(Src, Dst, L1, L2)) {
+        DEBUG(dbgs() << "LF: Fusion would violate dependence from " << *Src
+                     << " to " << *Dst << "\n");
+        return false;
+      }
+    }
+  }
+
+  if (!SharesObject) {
+    DEBUG(dbgs() << "LF: Loops do not access common memory.\n");
+    return false;
+  }
+  return true;
+}
+
+/// Fuse \p L2 into \p L1. The header of \p L2 becomes the successor of the
+/// latch of \p L1, and the latch of \p L2 becomes the latch of the fused loop.
+void LoopFusion::fuse(Loop *L1, Loop *L2) {
+  BasicBlock *Preheader = L1->getLoopPreheader();
+  BasicBlock *Header1 = L1->getHeader();
+  BasicBlock *Latch1 = L1->getLoopLatch();
+  BasicBlock *Between = L2->getLoopPreheader();
+  BasicBlock *Header2 = L2->getHeader();
+  BasicBlock *Latch2 = L2->getLoopLatch();
+
+  SE->forgetLoop(L1);
+  SE->forgetLoop(L2);
+
+  // Hoist the instructions between the loops into the preheader of L1.
+  while (&Between->front() != Between->getTerminator())
+    Between->front().moveBefore(Preheader->getTerminator());
+
+  // L1 no longer exits; its latch falls through to the body of L2.
+  BranchInst *OldBr = cast<BranchInst>(Latch1->getTerminator());
+  Value *OldCond = OldBr->isConditional() ? OldBr->getCondition() : nullptr;
+  BranchInst::Create(Header2, OldBr);
+  OldBr->eraseFromParent();
+  if (OldCond)
+    RecursivelyDeleteTriviallyDeadInstructions(OldCond);
+
+  // The fused loop is entered from the preheader of L1 and iterates from the
+  // latch of L2, so merge the header PHIs of both loops accordingly.
+  for (Instruction &I : *Header1) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Latch1), Latch2);
+  }
+  Instruction *InsertPt = Header1->getFirstNonPHI();
+  while (PHINode *PN = dyn_cast<PHINode>(&Header2->front())) {
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Between), Preheader);
+    PN->moveBefore(InsertPt);
+  }
+
+  BranchInst *Br2 = cast<BranchInst>(Latch2->getTerminator());
+  for (unsigned i = 0, e = Br2->getNumSuccessors(); i != e; ++i)
+    if (Br2->getSuccessor(i) == Header2)
+      Br2->setSuccessor(i, Header1);
+
+  // Move the blocks of L2 into L1 and delete L2 and the now empty block that
+  // separated the loops.
+  for (BasicBlock *BB : L2->getBlocks()) {
+    L1->addBlockEntry(BB);
+    LI->changeLoopFor(BB, L1);
+  }
+  if (Loop *Parent = L2->getParentLoop())
+    Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), L2));
+  else
+    LI->removeLoop(std::find(LI->begin(), LI->end(), L2));
+  delete L2;
+
+  // The latch of L1 is now the only predecessor of the header of L2. No
+  // other block changes its immediate dominator.
+  DT->changeImmediateDominator(Header2, Latch1);
+  DT->eraseNode(Between);
+  LI->removeBlock(Between);
+  Between->eraseFromParent();
+
+  MergeBlockIntoPredecessor(Header2, DT, LI);
+}
+
+bool LoopFusion::runOnFunction(Function &F) {
+  if (skipOptnoneFunction(F))
+    return false;
+
+  SE = &getAnalysis<ScalarEvolution>();
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DA = &getAnalysis<DependenceAnalysis>();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  DL = &F.getParent()->getDataLayout();
+
+  SmallVector<Loop *, 8> Worklist;
+  SmallVector<Loop *, 8> Stack(LI->begin(), LI->end());
+  while (!Stack.empty()) {
+    Loop *L = Stack.pop_back_val();
+    if (L->empty())
+      Worklist.push_back(L);
+    Stack.append(L->begin(), L->end());
+  }
+
+  bool Changed = false;
+  SmallPtrSet<Loop *, 8> Fused;
+  for (Loop *L1 : Worklist) {
+    if (Fused.count(L1))
+      continue;
+    // Keep fusing the following loop into L1 for as long as possible.
+    while (Loop *L2 = getFusionCandidate(L1)) {
+      DEBUG(dbgs() << "LF: Checking " << *L1 << " and " << *L2);
+      if (!canFuse(L1, L2))
+        break;
+      DEBUG(dbgs() << "LF: Fusing loops.\n");
+      Fused.insert(L2);
+      fuse(L1, L2);
+      ++NumLoopsFused;
+      Changed = true;
+    }
+  }
+
+  return Changed;
+}
+
+char LoopFusion::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopFusion, "loop-fusion", "Fuse adjacent loops", false,
+                      false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_END(LoopFusion, "loop-fusion", "Fuse adjacent loops", false,
+                    false)
+
+FunctionPass *llvm::createLoopFusionPass() { return new LoopFusion(); }
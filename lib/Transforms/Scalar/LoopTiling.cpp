@@ -0,0 +1,448 @@
+//===- LoopTiling.cpp - Tile loop nests for cache locality ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass tiles the innermost loop of a perfect two-level loop nest:
+//
+//   for (i = ...)                    for (jj = S; jj < N; jj += T)
+//     for (j = S; j < N; ++j)   =>     for (i = ...)
+//       body(i, j)                       for (j = jj; j < min(jj + T, N); ++j)
+//                                          body(i, j)
+//
+// When the inner loop touches data that is reused by every iteration of the
+// outer loop, but the data touched by a whole inner loop does not fit in the
+// cache, tiling keeps a block of T iterations worth of data cache resident
+// while the outer loop sweeps over it. T is derived from the data cache size
+// reported by TargetTransformInfo.
+//
+// The transform reorders iterations (i, j) and (i', j') for i < i' whenever j
+// lies in a later tile than j'. It is therefore only legal if no dependence
+// between accesses of the nest has an outer direction of '<' and an inner
+// direction of '>' (or the reverse), which is checked with
+// DependenceAnalysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Scalar.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-tiling"
+
+STATISTIC(NumLoopsTiled, "Number of loops tiled");
+
+static cl::opt<unsigned>
+    TileSize("loop-tile-size", cl::init(0), cl::Hidden,
+             cl::desc("Use this number of inner loop iterations per tile "
+                      "instead of deriving it from the cache size"));
+
+static cl::opt<unsigned>
+    TilingCacheSize("loop-tiling-cache-size", cl::init(0), cl::Hidden,
+                    cl::desc("Override the data cache size (in bytes) used "
+                             "to choose tile sizes"));
+
+namespace {
+
+/// The induction variable of the inner loop, in the form the transform
+/// requires: a PHI starting at Start, incremented by one and compared against
+/// the loop invariant bound End by the latch.
+struct InnerIV {
+  PHINode *Phi;
+  Value *Start;
+  ICmpInst *Cmp;
+  Value *End;
+  bool IsSigned;
+};
+
+struct LoopTiling : public FunctionPass {
+  static char ID; // Pass identification, replacement for typeid
+  LoopTiling()
+      : FunctionPass(ID), SE(nullptr), LI(nullptr), DA(nullptr), DT(nullptr),
+        TTI(nullptr), DL(nullptr) {
+    initializeLoopTilingPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<ScalarEvolution>();
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addRequired<DependenceAnalysis>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+  }
+
+  bool runOnFunction(Function &F) override;
+
+private:
+  bool isPerfectNest(Loop *Outer, Loop *Inner);
+  bool findInnerIV(Loop *Outer, Loop *Inner, InnerIV &IV);
+  bool isLegal(Loop *Outer, Loop *Inner);
+  bool canStepBy(InnerIV &IV, unsigned Size);
+  unsigned getTileSize(Loop *Outer, Loop *Inner);
+  void tile(Loop *Outer, Loop *Inner, InnerIV &IV, unsigned Size);
+
+  ScalarEvolution *SE;
+  LoopInfo *LI;
+  DependenceAnalysis *DA;
+  DominatorTree *DT;
+  const TargetTransformInfo *TTI;
+  const DataLayout *DL;
+};
+
+} // end anonymous namespace
+
+static Value *getPointerOperand(Instruction *I) {
+  if (auto *LI = dyn_cast<LoadInst>(I))
+    return LI->getPointerOperand();
+  return cast<StoreInst>(I)->getPointerOperand();
+}
+
+static bool hasUsesOutside(Loop *L) {
+  for (BasicBlock *BB : L->getBlocks())
+    for (Instruction &I : *BB)
+      for (User *U : I.users())
+        if (!L->contains(cast<Instruction>(U)))
+          return true;
+  return false;
+}
+
+/// Check that \p Inner is the only loop in \p Outer, that both are in
+/// simplified form with a single exiting latch, and that no code of \p Outer
+/// outside of \p Inner touches memory.
+bool LoopTiling::isPerfectNest(Loop *Outer, Loop *Inner) {
+  for (Loop *L : {Outer, Inner}) {
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!L->getLoopPreheader() || !Latch || L->getExitingBlock() != Latch ||
+        !L->getExitBlock() || !isa<BranchInst>(Latch->getTerminator()))
+      return false;
+  }
+
+  for (BasicBlock *BB : Outer->getBlocks()) {
+    if (Inner->contains(BB))
+      continue;
+    for (Instruction &I : *BB)
+      if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects())
+        return false;
+  }
+  for (BasicBlock *BB : Inner->getBlocks())
+    for (Instruction &I : *BB)
+      if (I.mayReadOrWriteMemory() && !isa<LoadInst>(I) &&
+          !isa<StoreInst>(I)) {
+        DEBUG(dbgs() << "LT: Unsupported memory instruction: " << I << "\n");
+        return false;
+      }
+
+  // Each inner loop now only runs a slice of its iterations, and the outer
+  // loop runs once per tile, so neither may produce values used after it.
+  if (hasUsesOutside(Inner) || hasUsesOutside(Outer))
+    return false;
+  return true;
+}
+
+bool LoopTiling::findInnerIV(Loop *Outer, Loop *Inner, InnerIV &IV) {
+  BasicBlock *Header = Inner->getHeader();
+  BasicBlock *Latch = Inner->getLoopLatch();
+  auto *Phi = dyn_cast<PHINode>(&Header->front());
+  if (!Phi || isa<PHINode>(Phi->getNextNode()) ||
+      !Phi->getType()->isIntegerTy())
+    return false;
+
+  // The bounds of the inner loop must be available above the tile loop.
+  IV.Phi = Phi;
+  IV.Start = Phi->getIncomingValueForBlock(Inner->getLoopPreheader());
+  if (!Outer->isLoopInvariant(IV.Start))
+    return false;
+
+  auto *Next = dyn_cast<BinaryOperator>(Phi->getIncomingValueForBlock(Latch));
+  if (!Next || Next->getOpcode() != Instruction::Add ||
+      Next->getOperand(0) != Phi)
+    return false;
+  auto *Step = dyn_cast<ConstantInt>(Next->getOperand(1));
+  if (!Step || !Step->isOne())
+    return false;
+
+  BranchInst *BI = cast<BranchInst>(Latch->getTerminator());
+  if (!BI->isConditional())
+    return false;
+  IV.Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+  if (!IV.Cmp || !IV.Cmp->hasOneUse() || IV.Cmp->getOperand(0) != Next)
+    return false;
+  IV.End = IV.Cmp->getOperand(1);
+  if (!Outer->isLoopInvariant(IV.End))
+    return false;
+
+  ICmpInst::Predicate Pred = IV.Cmp->getPredicate();
+  if (BI->getSuccessor(0) != Header)
+    Pred = ICmpInst::getInversePredicate(Pred);
+  if (Pred != ICmpInst::ICMP_SLT && Pred != ICmpInst::ICMP_ULT &&
+      Pred != ICmpInst::ICMP_NE)
+    return false;
+  IV.IsSigned = Pred != ICmpInst::ICMP_ULT;
+
+  // Every tile has to execute at least one iteration, which holds if the
+  // original loop does.
+  const SCEV *StartS = SE->getSCEV(IV.Start);
+  const SCEV *EndS = SE->getSCEV(IV.End);
+  ICmpInst::Predicate LT =
+      IV.IsSigned ? ICmpInst::ICMP_SLT : ICmpInst::ICMP_ULT;
+  if (!SE->isKnownPredicate(LT, StartS, EndS) &&
+      !SE->isLoopEntryGuardedByCond(Outer, LT, StartS, EndS))
+    return false;
+  return true;
+}
+
+/// Tiling reorders the iterations of the nest like an interchange of the tile
+/// loop with the outer loop. Reject it if a dependence is carried by the outer
+/// loop in one direction and by the inner loop in the other.
+bool LoopTiling::isLegal(Loop *Outer, Loop *Inner) {
+  SmallVector<Instruction *, 16> MemInsts;
+  for (BasicBlock *BB : Inner->getBlocks())
+    for (Instruction &I : *BB)
+      if (isa<LoadInst>(I) || isa<StoreInst>(I))
+        MemInsts.push_back(&I);
+
+  unsigned OuterLevel = Outer->getLoopDepth();
+  unsigned InnerLevel = Inner->getLoopDepth();
+  for (unsigned i = 0, e = MemInsts.size(); i != e; ++i) {
+    for (unsigned j = i; j != e; ++j) {
+      Instruction *Src = MemInsts[i], *Dst = MemInsts[j];
+      if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+        continue;
+      auto D = DA->depends(Src, Dst, true);
+      if (!D)
+        continue;
+      if (D->isConfused() || D->getLevels() < InnerLevel) {
+        DEBUG(dbgs() << "LT: Unknown dependence between " << *Src << " and "
+                     << *Dst << "\n");
+        return false;
+      }
+      unsigned OuterDir = D->getDirection(OuterLevel);
+      unsigned InnerDir = D->getDirection(InnerLevel);
+      if (((OuterDir & Dependence::DVEntry::LT) &&
+           (InnerDir & Dependence::DVEntry::GT)) ||
+          ((OuterDir & Dependence::DVEntry::GT) &&
+           (InnerDir & Dependence::DVEntry::LT))) {
+        DEBUG(dbgs() << "LT: Tiling would reverse dependence between " << *Src
+                     << " and " << *Dst << "\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// Return true if advancing an induction variable below End by \p Size
+/// cannot overflow.
+bool LoopTiling::canStepBy(InnerIV &IV, unsigned Size) {
+  const SCEV *EndS = SE->getSCEV(IV.End);
+  unsigned BitWidth = IV.Phi->getType()->getIntegerBitWidth();
+  APInt Step(BitWidth, Size);
+  if (IV.IsSigned)
+    return SE->getSignedRange(EndS).getSignedMax().sle(
+        APInt::getSignedMaxValue(BitWidth) - Step);
+  return SE->getUnsignedRange(EndS).getUnsignedMax().ule(
+      APInt::getMaxValue(BitWidth) - Step);
+}
+
+/// Return the number of inner iterations per tile, or 0 if tiling is not
+/// expected to pay off.
+unsigned LoopTiling::getTileSize(Loop *Outer, Loop *Inner) {
+  // Tiling only helps if the outer loop revisits what the inner loop
+  // touches, i.e. some address only depends on the inner induction variable.
+  unsigned BytesPerIteration = 0;
+  bool HasReuse = false;
+  for (BasicBlock *BB : Inner->getBlocks())
+    for (Instruction &I : *BB) {
+      if (!isa<LoadInst>(I) && !isa<StoreInst>(I))
+        continue;
+      Value *Ptr = getPointerOperand(&I);
+      BytesPerIteration +=
+          DL->getTypeStoreSize(Ptr->getType()->getPointerElementType());
+      auto *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(Ptr));
+      if (AR && AR->getLoop() == Inner &&
+          SE->isLoopInvariant(AR->getStart(), Outer))
+        HasReuse = true;
+    }
+  if (!HasReuse || !BytesPerIteration) {
+    DEBUG(dbgs() << "LT: No reuse across the outer loop.\n");
+    return 0;
+  }
+
+  unsigned TripCount = SE->getSmallConstantTripCount(Inner);
+  if (TileSize)
+    return TripCount && TileSize >= TripCount ? 0 : TileSize;
+
+  unsigned CacheSize =
+      TilingCacheSize ? TilingCacheSize : TTI->getCacheSize();
+  if (!CacheSize)
+    return 0;
+
+  // Leave half of the cache for data that is not reused.
+  unsigned Size = PowerOf2Floor(CacheSize / 2 / BytesPerIteration);
+  if (Size < 4)
+    return 0;
+  if (TripCount && TripCount <= Size) {
+    DEBUG(dbgs() << "LT: The inner loop already fits in the cache.\n");
+    return 0;
+  }
+  return Size;
+}
+
+void LoopTiling::tile(Loop *Outer, Loop *Inner, InnerIV &IV, unsigned Size) {
+  BasicBlock *Preheader = Outer->getLoopPreheader();
+  BasicBlock *OuterHeader = Outer->getHeader();
+  BasicBlock *OuterLatch = Outer->getLoopLatch();
+  BasicBlock *Exit = Outer->getExitBlock();
+  Function *F = OuterHeader->getParent();
+  LLVMContext &Ctx = F->getContext();
+  Type *Ty = IV.Phi->getType();
+
+  SE->forgetLoop(Outer);
+
+  BasicBlock *TileHeader =
+      BasicBlock::Create(Ctx, "tile.header", F, OuterHeader);
+  BasicBlock *TileLatch = BasicBlock::Create(Ctx, "tile.latch", F, Exit);
+
+  // The tile header picks the bounds of the next slice of inner iterations.
+  IRBuilder<> B(TileHeader);
+  PHINode *TileIV = B.CreatePHI(Ty, 2, "tile.iv");
+  TileIV->addIncoming(IV.Start, Preheader);
+  Value *TileNext = B.CreateAdd(TileIV, ConstantInt::get(Ty, Size),
+                                "tile.next", false, IV.IsSigned);
+  Value *InRange = IV.IsSigned ? B.CreateICmpSLT(TileNext, IV.End)
+                               : B.CreateICmpULT(TileNext, IV.End);
+  Value *TileEnd = B.CreateSelect(InRange, TileNext, IV.End, "tile.end");
+  B.CreateBr(OuterHeader);
+
+  B.SetInsertPoint(TileLatch);
+  Value *More = IV.IsSigned ? B.CreateICmpSLT(TileNext, IV.End, "tile.cmp")
+                            : B.CreateICmpULT(TileNext, IV.End, "tile.cmp");
+  B.CreateCondBr(More, TileHeader, Exit);
+  TileIV->addIncoming(TileNext, TileLatch);
+
+  // Enter the outer loop from the tile header, and go to the next tile once
+  // it is done.
+  Preheader->getTerminator()->replaceUsesOfWith(OuterHeader, TileHeader);
+  for (Instruction &I : *OuterHeader) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), TileHeader);
+  }
+  OuterLatch->getTerminator()->replaceUsesOfWith(Exit, TileLatch);
+  // No value of the nest is used outside of it, so whatever the exit block's
+  // PHIs receive from the outer latch is available in the tile latch too.
+  for (Instruction &I : *Exit) {
+    PHINode *PN = dyn_cast<PHINode>(&I);
+    if (!PN)
+      break;
+    PN->setIncomingBlock(PN->getBasicBlockIndex(OuterLatch), TileLatch);
+  }
+
+  // Restrict the inner loop to the current tile.
+  unsigned StartIdx = IV.Phi->getBasicBlockIndex(Inner->getLoopPreheader());
+  IV.Phi->setIncomingValue(StartIdx, TileIV);
+  IV.Cmp->setOperand(1, TileEnd);
+
+  // Register the tile loop between the outer loop and its parent.
+  Loop *TileLoop = new Loop();
+  if (Loop *Parent = Outer->getParentLoop())
+    Parent->replaceChildLoopWith(Outer, TileLoop);
+  else
+    LI->changeTopLevelLoop(Outer, TileLoop);
+  TileLoop->addChildLoop(Outer);
+  TileLoop->addBasicBlockToLoop(TileHeader, *LI);
+  TileLoop->addBasicBlockToLoop(TileLatch, *LI);
+  for (BasicBlock *BB : Outer->getBlocks())
+    TileLoop->addBlockEntry(BB);
+
+  DT->addNewBlock(TileHeader, Preheader);
+  DT->changeImmediateDominator(OuterHeader, TileHeader);
+  DT->addNewBlock(TileLatch, OuterLatch);
+  DT->changeImmediateDominator(Exit, TileLatch);
+}
+
+bool LoopTiling::runOnFunction(Function &F) {
+  if (skipOptnoneFunction(F))
+    return false;
+
+  SE = &getAnalysis<ScalarEvolution>();
+  LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  DA = &getAnalysis<DependenceAnalysis>();
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+  TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  DL = &F.getParent()->getDataLayout();
+
+  // Collect the loops whose only child is an innermost loop.
+  SmallVector<Loop *, 8> Worklist;
+  SmallVector<Loop *, 8> Stack(LI->begin(), LI->end());
+  while (!Stack.empty()) {
+    Loop *L = Stack.pop_back_val();
+    if (L->getSubLoops().size() == 1 && L->getSubLoops()[0]->empty())
+      Worklist.push_back(L);
+    Stack.append(L->begin(), L->end());
+  }
+
+  bool Changed = false;
+  for (Loop *Outer : Worklist) {
+    Loop *Inner = Outer->getSubLoops()[0];
+    DEBUG(dbgs() << "LT: Checking " << *Outer);
+    InnerIV IV;
+    if (!isPerfectNest(Outer, Inner) || !findInnerIV(Outer, Inner, IV)) {
+      DEBUG(dbgs() << "LT: Unsupported loop nest.\n");
+      continue;
+    }
+    unsigned Size = getTileSize(Outer, Inner);
+    if (!Size || !canStepBy(IV, Size) || !isLegal(Outer, Inner))
+      continue;
+
+    DEBUG(dbgs() << "LT: Tiling inner loop by " << Size << "\n");
+    tile(Outer, Inner, IV, Size);
+    ++NumLoopsTiled;
+    Changed = true;
+  }
+  return Changed;
+}
+
+char LoopTiling::ID = 0;
+INITIALIZE_PASS_BEGIN(LoopTiling, "loop-tiling",
+                      "Tile loop nests for cache locality", false, false)
+INITIALIZE_AG_DEPENDENCY(AliasAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysis)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolution)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(LoopTiling, "loop-tiling",
+                    "Tile loop nests for cache locality", false, false)
+
+FunctionPass *llvm::createLoopTilingPass() { return new LoopTiling(); }
@@ -25,7 +25,9 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
@@ -71,6 +73,15 @@ static cl::opt<bool>
 UnrollRuntime("unroll-runtime", cl::ZeroOrMore, cl::init(false), cl::Hidden,
   cl::desc("Unroll loops with run-time trip counts"));
 
+static cl::opt<bool>
+UnrollAllowPeeling("unroll-allow-peeling", cl::init(true), cl::Hidden,
+  cl::desc("Allows loops to be peeled when the profiled trip count is "
+           "small."));
+
+static cl::opt<unsigned>
+UnrollPeelMaxCount("unroll-peel-max-count", cl::init(7), cl::Hidden,
+  cl::desc("Largest profiled trip count for which a loop is peeled."));
+
 static cl::opt<unsigned>
 PragmaUnrollThreshold("pragma-unroll-threshold", cl::init(16 * 1024), cl::Hidden,
   cl::desc("Unrolled size limit for loops with an unroll(full) or "
@@ -146,6 +157,7 @@ namespace {
       AU.addRequired<ScalarEvolution>();
       AU.addPreserved<ScalarEvolution>();
       AU.addRequired<TargetTransformInfoWrapperPass>();
+      AU.addRequired<DominatorTreeWrapperPass>();
       // FIXME: Loop unroll requires LCSSA. And LCSSA requires dom info.
       // If loop unroll does not preserve dom info then LCSSA pass on next
       // loop will receive invalid dom info.
@@ -206,9 +218,13 @@ namespace {
                                        ? CurrentDynamicCostSavingsDiscount
                                        : UP.DynamicCostSavingsDiscount;
 
+      // Loops in functions the profile says are never entered are treated
+      // like loops in optsize functions: unrolling them only grows the code.
+      const Function *F = L->getHeader()->getParent();
+      Optional<uint64_t> EntryCount = F->getEntryCount();
       if (!UserThreshold &&
-          L->getHeader()->getParent()->hasFnAttribute(
-              Attribute::OptimizeForSize)) {
+          (F->hasFnAttribute(Attribute::OptimizeForSize) ||
+           (EntryCount && *EntryCount == 0))) {
         Threshold = UP.OptSizeThreshold;
         PartialThreshold = UP.PartialOptSizeThreshold;
       }
@@ -235,6 +251,7 @@ char LoopUnroll::ID = 0;
 INITIALIZE_PASS_BEGIN(LoopUnroll, "loop-unroll", "Unroll loops", false, false)
 INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
 INITIALIZE_PASS_DEPENDENCY(LCSSA)
@@ -614,13 +631,13 @@ static unsigned UnrollCountPragmaValue(const Loop *L) {
 // unrolling pass is run more than once (which it generally is).
 static void SetLoopAlreadyUnrolled(Loop *L) {
   MDNode *LoopID = L->getLoopID();
-  if (!LoopID) return;
 
   // First remove any existing loop unrolling metadata.
   SmallVector<Metadata *, 4> MDs;
   // Reserve first location for self reference to the LoopID metadata node.
   MDs.push_back(nullptr);
-  for (unsigned i = 1, ie = LoopID->getNumOperands(); i < ie; ++i) {
+  for (unsigned i = 1, ie = LoopID ? LoopID->getNumOperands() : 1; i < ie;
+       ++i) {
     bool IsUnrollMetadata = false;
     MDNode *MD = dyn_cast<MDNode>(LoopID->getOperand(i));
     if (MD) {
@@ -644,6 +661,38 @@ static void SetLoopAlreadyUnrolled(Loop *L) {
   L->setLoopID(NewLoopID);
 }
 
+// Returns the trip count of the loop as estimated from the branch weights on
+// its latch, or None if the latch carries no usable profile.
+static Optional<unsigned> getLoopEstimatedTripCount(const Loop *L) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch)
+    return None;
+  BranchInst *LatchBR = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!LatchBR || !LatchBR->isConditional() || !L->isLoopExiting(Latch))
+    return None;
+
+  MDNode *WeightNode = LatchBR->getMetadata(LLVMContext::MD_prof);
+  if (!WeightNode || WeightNode->getNumOperands() != 3)
+    return None;
+  ConstantInt *W0 =
+      mdconst::dyn_extract<ConstantInt>(WeightNode->getOperand(1));
+  ConstantInt *W1 =
+      mdconst::dyn_extract<ConstantInt>(WeightNode->getOperand(2));
+  if (!W0 || !W1)
+    return None;
+
+  bool HeaderFirst = LatchBR->getSuccessor(0) == L->getHeader();
+  uint64_t BackedgeWeight = (HeaderFirst ? W0 : W1)->getZExtValue();
+  uint64_t ExitWeight = (HeaderFirst ? W1 : W0)->getZExtValue();
+  if (ExitWeight == 0)
+    return None;
+
+  // Each exit from the loop corresponds to one entry into it, so the average
+  // number of backedges taken per entry is BackedgeWeight / ExitWeight.
+  uint64_t TripCount = (BackedgeWeight + ExitWeight / 2) / ExitWeight + 1;
+  return (unsigned)std::min<uint64_t>(TripCount, UINT_MAX);
+}
+
 bool LoopUnroll::canUnrollCompletely(Loop *L, unsigned Threshold,
                                      unsigned PercentDynamicCostSavedThreshold,
                                      unsigned DynamicCostSavingsDiscount,
@@ -838,6 +887,24 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     Unrolling = Runtime;
   }
 
+  Optional<unsigned> EstimatedTripCount;
+  if (Unrolling == Runtime)
+    EstimatedTripCount = getLoopEstimatedTripCount(L);
+
+  // If the profile says the loop almost always runs the same small number of
+  // iterations, peel those iterations off instead: the common case then runs
+  // straight-line code and never enters the loop.
+  if (EstimatedTripCount && UnrollAllowPeeling && !HasPragma && !UserCount &&
+      *EstimatedTripCount <= UnrollPeelMaxCount &&
+      (uint64_t)LoopSize * *EstimatedTripCount <= Threshold) {
+    DominatorTree *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    if (PeelLoop(L, *EstimatedTripCount, LI, SE, DT, &AC, this)) {
+      // The remaining loop is cold; don't peel or unroll it again.
+      SetLoopAlreadyUnrolled(L);
+      return true;
+    }
+  }
+
   // Reduce count based on the type of unrolling and the threshold values.
   unsigned OriginalCount = Count;
   bool AllowRuntime =
@@ -873,6 +940,11 @@ bool LoopUnroll::runOnLoop(Loop *L, LPPassManager &LPM) {
     }
     if (Count > UP.MaxCount)
       Count = UP.MaxCount;
+    // Don't unroll past the number of iterations the loop is profiled to
+    // run: the extra copies would only ever be skipped by the prolog.
+    if (EstimatedTripCount && !CountSetExplicitly && !HasPragma &&
+        Count > *EstimatedTripCount)
+      Count = PowerOf2Floor(*EstimatedTripCount);
     DEBUG(dbgs() << "  partially unrolling with count: " << Count << "\n");
   }
 
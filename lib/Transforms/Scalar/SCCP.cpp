@@ -27,6 +27,7 @@
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -164,6 +165,13 @@ class SCCPSolver : public InstVisitor<SCCPSolver> {
   ///
   DenseMap<std::pair<Value*, unsigned>, LatticeVal> StructValueState;
 
+  /// ValueRanges - For integer PHI nodes, tracked arguments and the results
+  /// of calls to tracked functions, the union of the values merged into them
+  /// so far.  While such a value is overdefined, it is known to lie in this
+  /// range.  The entry of a tracked Function holds the range of its return
+  /// value.
+  DenseMap<Value*, ConstantRange> ValueRanges;
+
   /// GlobalValue - If we are tracking any values for the contents of a global
   /// variable, we keep a mapping from the constant accessor to the element of
   /// the global, to the currently known value.  If the value becomes
@@ -362,6 +370,44 @@ private:
     mergeInValue(ValueState[V], V, MergeWithV);
   }
 
+  /// getRange - Return the range of integer values described by IV, the state
+  /// of V.  Constants give a single value, undefined values the empty set,
+  /// and overdefined values the range recorded for them, if any.
+  ConstantRange getRange(LatticeVal IV, Value *V, unsigned BitWidth) {
+    if (IV.isUndefined())
+      return ConstantRange(BitWidth, /*isFullSet=*/false);
+    if (ConstantInt *CI = IV.getConstantInt())
+      return ConstantRange(CI->getValue());
+    if (IV.isOverdefined()) {
+      DenseMap<Value*, ConstantRange>::iterator I = ValueRanges.find(V);
+      if (I != ValueRanges.end() && !I->second.isEmptySet())
+        return I->second;
+    }
+    return ConstantRange(BitWidth);
+  }
+
+  ConstantRange getValueRange(Value *V) {
+    return getRange(getValueState(V), V,
+                    cast<IntegerType>(V->getType())->getBitWidth());
+  }
+
+  /// mergeInRange - Add R to the range recorded for V, whose state is IV.  If
+  /// V is overdefined and its range grew, its users are revisited.
+  void mergeInRange(LatticeVal &IV, Value *V, const ConstantRange &R) {
+    if (R.isEmptySet())
+      return;
+    std::pair<DenseMap<Value*, ConstantRange>::iterator, bool> I =
+      ValueRanges.insert(std::make_pair(V, R));
+    if (!I.second) {
+      ConstantRange Union = I.first->second.unionWith(R);
+      if (Union == I.first->second)
+        return;
+      I.first->second = Union;
+    }
+    if (IV.isOverdefined())
+      OverdefinedInstWorkList.push_back(V);
+  }
+
 
   /// getValueState - Return the LatticeVal object that corresponds to the
   /// value.  This function handles the case when the value hasn't been seen yet
@@ -657,7 +703,9 @@ void SCCPSolver::visitPHINode(PHINode &PN) {
   if (PN.getType()->isStructTy())
     return markAnythingOverdefined(&PN);
 
-  if (getValueState(&PN).isOverdefined())
+  // An overdefined integer PHI may still narrow the range of its value.
+  IntegerType *IntTy = dyn_cast<IntegerType>(PN.getType());
+  if (getValueState(&PN).isOverdefined() && !IntTy)
     return;  // Quick exit
 
   // Super-extra-high-degree PHI nodes are unlikely to ever be marked constant,
@@ -669,32 +717,43 @@ void SCCPSolver::visitPHINode(PHINode &PN) {
   // are overdefined, the PHI becomes overdefined as well.  If they are all
   // constant, and they agree with each other, the PHI becomes the identical
   // constant.  If they are constant and don't agree, the PHI is overdefined.
-  // If there are no executable operands, the PHI remains undefined.
+  // If there are no executable operands, the PHI remains undefined.  For
+  // integer PHIs, the union of the ranges of the executable operands is
+  // collected as well.
   //
   Constant *OperandVal = nullptr;
+  bool Overdefined = getValueState(&PN).isOverdefined();
+  ConstantRange Range(IntTy ? IntTy->getBitWidth() : 1, /*isFullSet=*/false);
   for (unsigned i = 0, e = PN.getNumIncomingValues(); i != e; ++i) {
-    LatticeVal IV = getValueState(PN.getIncomingValue(i));
+    Value *InVal = PN.getIncomingValue(i);
+    LatticeVal IV = getValueState(InVal);
     if (IV.isUndefined()) continue;  // Doesn't influence PHI node.
 
     if (!isEdgeFeasible(PN.getIncomingBlock(i), PN.getParent()))
       continue;
 
     if (IV.isOverdefined())    // PHI node becomes overdefined!
-      return markOverdefined(&PN);
-
-    if (!OperandVal) {   // Grab the first value.
+      Overdefined = true;
+    else if (!OperandVal)      // Grab the first value.
       OperandVal = IV.getConstant();
+    else if (IV.getConstant() != OperandVal)
+      // There is already a reachable operand, and two different constants
+      // are merging, so the PHI node is overdefined.
+      Overdefined = true;
+
+    if (!IntTy) {
+      if (Overdefined)
+        return markOverdefined(&PN);
       continue;
     }
+    Range = Range.unionWith(getRange(IV, InVal, IntTy->getBitWidth()));
+    if (Overdefined && Range.isFullSet())
+      break;
+  }
 
-    // There is already a reachable operand.  If we conflict with it,
-    // then the PHI node becomes overdefined.  If we agree with it, we
-    // can continue on.
-
-    // Check to see if there are two different constants merging, if so, the PHI
-    // node is overdefined.
-    if (IV.getConstant() != OperandVal)
-      return markOverdefined(&PN);
+  if (Overdefined) {
+    markOverdefined(&PN);
+    return mergeInRange(ValueState[&PN], &PN, Range);
   }
 
   // If we exited the loop, this means that the PHI node only has constant
@@ -718,6 +777,8 @@ void SCCPSolver::visitReturnInst(ReturnInst &I) {
       TrackedRetVals.find(F);
     if (TFRVI != TrackedRetVals.end()) {
       mergeInValue(TFRVI->second, F, getValueState(ResultOp));
+      if (ResultOp->getType()->isIntegerTy())
+        mergeInRange(TFRVI->second, F, getValueRange(ResultOp));
       return;
     }
   }
@@ -918,6 +979,24 @@ void SCCPSolver::visitCmpInst(CmpInst &I) {
   if (!V1State.isOverdefined() && !V2State.isOverdefined())
     return;
 
+  // The ranges the operands are known to lie in may still decide an integer
+  // comparison.
+  if (!V1State.isUndefined() && !V2State.isUndefined() &&
+      I.getOperand(0)->getType()->isIntegerTy()) {
+    ConstantRange R1 = getValueRange(I.getOperand(0));
+    ConstantRange R2 = getValueRange(I.getOperand(1));
+    Constant *C = nullptr;
+    if (ConstantRange::makeSatisfyingICmpRegion(I.getPredicate(), R2)
+            .contains(R1))
+      C = ConstantInt::getTrue(I.getType());
+    else if (ConstantRange::makeSatisfyingICmpRegion(
+                 I.getInversePredicate(), R2).contains(R1))
+      C = ConstantInt::getFalse(I.getType());
+    // Keep a result found earlier only if it still holds.
+    if (C && (!IV.isConstant() || IV.getConstant() == C))
+      return markConstant(IV, &I, C);
+  }
+
   markOverdefined(&I);
 }
 
@@ -1146,6 +1225,10 @@ CallOverdefined:
         }
       } else {
         mergeInValue(AI, getValueState(*CAI));
+        if (AI->getType()->isIntegerTy()) {
+          ConstantRange R = getValueRange(*CAI);
+          mergeInRange(ValueState[AI], AI, R);
+        }
       }
     }
   }
@@ -1167,6 +1250,10 @@ CallOverdefined:
 
     // If so, propagate the return value of the callee into this call result.
     mergeInValue(I, TFRVI->second);
+    if (IntegerType *IntTy = dyn_cast<IntegerType>(I->getType())) {
+      ConstantRange R = getRange(TFRVI->second, F, IntTy->getBitWidth());
+      mergeInRange(ValueState[I], I, R);
+    }
   }
 }
 
@@ -0,0 +1,253 @@
+//===-- LoopUnrollPeel.cpp - Loop peeling utilities -----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements some loop unrolling utilities for peeling loops
+// with dynamically inferred (from profile) trip counts. See LoopUnroll.cpp for
+// unrolling loops with compile-time constant trip counts.
+//
+// Peeling a loop by a count N clones the first N iterations of the loop in
+// front of it.  Each peeled iteration exits directly to the loop's exit block
+// if the original exit condition holds, and otherwise falls through to the
+// next peeled iteration and finally to the remaining loop.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/UnrollLoop.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/LoopIterator.h"
+#include "llvm/Analysis/LoopPass.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "loop-unroll"
+
+STATISTIC(NumPeeled, "Number of loops peeled");
+
+/// Scale down the backedge weight of the latch of \p L to account for the
+/// \p PeelCount iterations that no longer execute inside the loop.
+static void updateBranchWeights(Loop *L, BasicBlock *Latch,
+                                unsigned PeelCount) {
+  BranchInst *BI = cast<BranchInst>(Latch->getTerminator());
+  MDNode *WeightNode = BI->getMetadata(LLVMContext::MD_prof);
+  if (!WeightNode || WeightNode->getNumOperands() != 3)
+    return;
+
+  ConstantInt *W0 =
+      mdconst::dyn_extract<ConstantInt>(WeightNode->getOperand(1));
+  ConstantInt *W1 =
+      mdconst::dyn_extract<ConstantInt>(WeightNode->getOperand(2));
+  if (!W0 || !W1)
+    return;
+
+  unsigned HeaderIdx = BI->getSuccessor(0) == L->getHeader() ? 0 : 1;
+  uint64_t BackedgeWeight = HeaderIdx == 0 ? W0->getZExtValue()
+                                           : W1->getZExtValue();
+  uint64_t ExitWeight = HeaderIdx == 0 ? W1->getZExtValue()
+                                       : W0->getZExtValue();
+
+  // Every peeled iteration that did not exit would have taken the backedge
+  // once per entry into the loop.
+  uint64_t Peeled = (uint64_t)PeelCount * ExitWeight;
+  uint64_t NewBackedgeWeight =
+      BackedgeWeight > Peeled ? BackedgeWeight - Peeled : 1;
+
+  MDBuilder MDB(BI->getContext());
+  MDNode *NewWeights =
+      HeaderIdx == 0
+          ? MDB.createBranchWeights(NewBackedgeWeight, ExitWeight)
+          : MDB.createBranchWeights(ExitWeight, NewBackedgeWeight);
+  BI->setMetadata(LLVMContext::MD_prof, NewWeights);
+}
+
+/// Peel off the first \p PeelCount iterations of loop \p L.
+///
+/// The loop must be an innermost loop in simplified form whose only exiting
+/// block is its latch.  The remaining loop is left in simplified and LCSSA
+/// form.  Returns true if the loop was peeled.
+bool llvm::PeelLoop(Loop *L, unsigned PeelCount, LoopInfo *LI,
+                    ScalarEvolution *SE, DominatorTree *DT,
+                    AssumptionCache *AC, Pass *PP) {
+  if (!PeelCount || !DT)
+    return false;
+
+  if (!L->empty())
+    return false;
+
+  BasicBlock *PreHeader = L->getLoopPreheader();
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!PreHeader || !Latch || L->getExitingBlock() != Latch)
+    return false;
+
+  BranchInst *LatchBR = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!LatchBR || !LatchBR->isConditional())
+    return false;
+
+  DEBUG(dbgs() << "PEELING loop %" << Header->getName() << " with count "
+               << PeelCount << "\n");
+
+  // The exit values of the loop and of every loop containing it change.
+  if (SE) {
+    Loop *OutermostLoop = L;
+    while (Loop *Parent = OutermostLoop->getParentLoop())
+      OutermostLoop = Parent;
+    SE->forgetLoop(OutermostLoop);
+  }
+
+  Function *F = Header->getParent();
+  Loop *ParentLoop = L->getParentLoop();
+
+  // Set up the blocks the peeled iterations are threaded between:
+  //
+  //   PreHeader -> InsertTop -> [peeled iteration] -> InsertBot
+  //             -> ... -> NewPreHeader -> Header
+  //
+  // InsertTop branches to the first peeled header, and each peeled latch
+  // continues to the next InsertTop instead of branching back to its header.
+  BasicBlock *InsertTop = SplitEdge(PreHeader, Header, DT, LI);
+  BasicBlock *InsertBot =
+      SplitBlock(InsertTop, InsertTop->getTerminator(), DT, LI);
+  BasicBlock *NewPreHeader =
+      SplitBlock(InsertBot, InsertBot->getTerminator(), DT, LI);
+  InsertTop->setName(Header->getName() + ".peel.begin");
+  InsertBot->setName(Header->getName() + ".peel.next");
+  NewPreHeader->setName(PreHeader->getName() + ".peel.newph");
+
+  // Blocks must be cloned in reverse postorder so that a block's operands
+  // are mapped before the block itself.
+  LoopBlocksDFS DFS(L);
+  DFS.perform(LI);
+
+  SmallVector<PHINode *, 8> OrigPHINodes;
+  for (BasicBlock::iterator I = Header->begin(); isa<PHINode>(I); ++I)
+    OrigPHINodes.push_back(cast<PHINode>(I));
+
+  SmallVector<BasicBlock *, 4> ExitBlocks;
+  L->getUniqueExitBlocks(ExitBlocks);
+
+  // Maps values of the original loop to their copies in the most recently
+  // peeled iteration.
+  ValueToValueMapTy LVMap;
+
+  for (unsigned It = 1; It <= PeelCount; ++It) {
+    ValueToValueMapTy VMap;
+    SmallVector<BasicBlock *, 8> NewBlocks;
+
+    for (LoopBlocksDFS::RPOIterator BB = DFS.beginRPO(), BE = DFS.endRPO();
+         BB != BE; ++BB) {
+      BasicBlock *New = CloneBasicBlock(*BB, VMap, ".peel" + Twine(It));
+      F->getBasicBlockList().insert(InsertBot, New);
+      VMap[*BB] = New;
+      if (ParentLoop)
+        ParentLoop->addBasicBlockToLoop(New, *LI);
+      NewBlocks.push_back(New);
+
+      // The peeled header is dominated by InsertTop, and every other block
+      // by the copy of its dominator in the loop, which reverse postorder
+      // has already cloned.
+      if (*BB == Header)
+        DT->addNewBlock(New, InsertTop);
+      else
+        DT->addNewBlock(New, cast<BasicBlock>(
+                                 VMap[DT->getNode(*BB)->getIDom()->getBlock()]));
+    }
+
+    // The peeled header is entered once, either from the preheader or from
+    // the previously peeled latch, so its phis fold to a single value.
+    for (PHINode *PHI : OrigPHINodes) {
+      PHINode *NewPHI = cast<PHINode>(VMap[PHI]);
+      Value *InVal;
+      if (It == 1) {
+        InVal = PHI->getIncomingValueForBlock(NewPreHeader);
+      } else {
+        InVal = PHI->getIncomingValueForBlock(Latch);
+        Instruction *InValI = dyn_cast<Instruction>(InVal);
+        if (InValI && L->contains(InValI))
+          InVal = LVMap[InValI];
+      }
+      VMap[PHI] = InVal;
+      NewPHI->eraseFromParent();
+    }
+
+    for (BasicBlock *NewBB : NewBlocks)
+      for (Instruction &I : *NewBB)
+        RemapInstruction(&I, VMap,
+                         RF_NoModuleLevelChanges | RF_IgnoreMissingEntries);
+
+    // Hook the peeled iteration in between InsertTop and InsertBot.
+    BasicBlock *NewHeader = cast<BasicBlock>(VMap[Header]);
+    BasicBlock *NewLatch = cast<BasicBlock>(VMap[Latch]);
+    InsertTop->getTerminator()->setSuccessor(0, NewHeader);
+    // The backedge was remapped to the peeled header along with the rest of
+    // the iteration.
+    BranchInst *NewLatchBR = cast<BranchInst>(NewLatch->getTerminator());
+    for (unsigned Idx = 0, E = NewLatchBR->getNumSuccessors(); Idx != E; ++Idx)
+      if (NewLatchBR->getSuccessor(Idx) == NewHeader)
+        NewLatchBR->setSuccessor(Idx, InsertBot);
+    // The peeled latch no longer closes a loop.
+    NewLatchBR->setMetadata("llvm.loop", nullptr);
+
+    DT->changeImmediateDominator(InsertBot, NewLatch);
+
+    // The peeled latch is a new predecessor of every exit block.
+    for (BasicBlock *Exit : ExitBlocks) {
+      for (BasicBlock::iterator I = Exit->begin(); isa<PHINode>(I); ++I) {
+        PHINode *PHI = cast<PHINode>(I);
+        Value *Incoming = PHI->getIncomingValueForBlock(Latch);
+        ValueToValueMapTy::iterator VI = VMap.find(Incoming);
+        if (VI != VMap.end())
+          Incoming = VI->second;
+        PHI->addIncoming(Incoming, NewLatch);
+      }
+      BasicBlock *ExitIDom = DT->getNode(Exit)->getIDom()->getBlock();
+      DT->changeImmediateDominator(
+          Exit, DT->findNearestCommonDominator(ExitIDom, NewLatch));
+    }
+
+    for (ValueToValueMapTy::iterator VI = VMap.begin(), VE = VMap.end();
+         VI != VE; ++VI)
+      LVMap[VI->first] = VI->second;
+
+    if (It != PeelCount) {
+      InsertTop = InsertBot;
+      InsertBot = SplitBlock(InsertBot, InsertBot->getTerminator(), DT, LI);
+      InsertBot->setName(Header->getName() + ".peel.next");
+    }
+  }
+
+  // The remaining loop is entered with the values produced by the last
+  // peeled iteration.
+  for (PHINode *PHI : OrigPHINodes) {
+    Value *InVal = PHI->getIncomingValueForBlock(Latch);
+    Instruction *InValI = dyn_cast<Instruction>(InVal);
+    if (InValI && L->contains(InValI))
+      InVal = LVMap[InValI];
+    PHI->setIncomingValue(PHI->getBasicBlockIndex(NewPreHeader), InVal);
+  }
+
+  updateBranchWeights(L, Latch, PeelCount);
+
+  // The exit blocks now have predecessors outside of the loop; split them
+  // again so that the remaining loop has dedicated exits.
+  simplifyLoop(L, DT, LI, PP, /*AliasAnalysis*/ nullptr, SE, AC);
+
+  ++NumPeeled;
+  return true;
+}
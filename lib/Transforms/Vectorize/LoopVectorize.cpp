@@ -95,9 +95,11 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Analysis/VectorUtils.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/UnrollLoop.h"
 #include <algorithm>
 #include <map>
 #include <tuple>
@@ -110,6 +112,9 @@ using namespace llvm::PatternMatch;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(EpiloguesVectorized, "Number of epilogue loops vectorized");
+STATISTIC(InnerLoopsFlattened,
+          "Number of inner loops unrolled to expose their outer loop");
 
 static cl::opt<bool>
 EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
@@ -142,12 +147,48 @@ static cl::opt<bool> EnableInterleavedMemAccesses(
     "enable-interleaved-mem-accesses", cl::init(false), cl::Hidden,
     cl::desc("Enable vectorization on interleaved memory accesses in a loop"));
 
+/// Interleaved accesses are analyzed when the target asks for them, unless
+/// -enable-interleaved-mem-accesses is given explicitly.
+static bool useInterleavedAccesses(const TargetTransformInfo *TTI) {
+  if (EnableInterleavedMemAccesses.getNumOccurrences() > 0)
+    return EnableInterleavedMemAccesses;
+  return TTI->enableInterleavedAccessVectorization();
+}
+
 /// Maximum factor for an interleaved memory access.
 static cl::opt<unsigned> MaxInterleaveGroupFactor(
     "max-interleave-group-factor", cl::Hidden,
     cl::desc("Maximum factor for an interleaved access group (default = 8)"),
     cl::init(8));
 
+/// This enables vectorization of the scalar remainder loop that is left
+/// behind when a loop is vectorized.  The remainder is vectorized with at most
+/// half of the main loop's vectorization factor and is not interleaved, so
+/// that short or odd trip counts spend less time in scalar code.
+static cl::opt<bool> EnableEpilogueVectorization(
+    "enable-epilogue-vectorization", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize the remainder loop of vectorized loops with a "
+             "smaller vectorization factor"));
+
+/// This enables vectorization of outer loops whose only inner loop has a small
+/// constant trip count. The inner loop is fully unrolled first, which turns
+/// the outer loop into an innermost loop that the legality checks and the
+/// cost model handle as usual.
+static cl::opt<bool> EnableOuterLoopVectorization(
+    "vectorize-outer-loops", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize outer loops by fully unrolling their short inner "
+             "loop"));
+
+static cl::opt<unsigned> OuterLoopMaxInnerTripCount(
+    "vectorize-outer-loops-max-inner-trip-count", cl::init(16), cl::Hidden,
+    cl::desc("The largest inner loop trip count for which the outer loop is "
+             "considered for vectorization"));
+
+static cl::opt<unsigned> OuterLoopUnrollThreshold(
+    "vectorize-outer-loops-unroll-threshold", cl::init(256), cl::Hidden,
+    cl::desc("The maximum number of instructions in a fully unrolled inner "
+             "loop when vectorizing its outer loop"));
+
 /// We don't interleave loops with a known constant trip count below this
 /// number.
 static const unsigned TinyTripCountInterleaveThreshold = 128;
@@ -590,7 +631,9 @@ static void propagateMetadata(SmallVectorImpl<Value *> &To, const Instruction *F
 ///        }
 ///
 /// Note: the interleaved load group could have gaps (missing members), but
-/// the interleaved store group doesn't allow gaps.
+/// the interleaved store group doesn't allow gaps. A load group missing its
+/// last member reads past the last element accessed by the scalar loop, so the
+/// vector loop must then leave at least one iteration to the scalar epilogue.
 class InterleaveGroup {
 public:
   InterleaveGroup(Instruction *Instr, int Stride, unsigned Align)
@@ -700,7 +743,7 @@ private:
 class InterleavedAccessInfo {
 public:
   InterleavedAccessInfo(ScalarEvolution *SE, Loop *L, DominatorTree *DT)
-      : SE(SE), TheLoop(L), DT(DT) {}
+      : SE(SE), TheLoop(L), DT(DT), RequiresScalarEpilogue(false) {}
 
   ~InterleavedAccessInfo() {
     SmallSet<InterleaveGroup *, 4> DelSet;
@@ -729,11 +772,20 @@ public:
     return nullptr;
   }
 
+  /// \brief Returns true if an interleaved group that may access memory
+  /// out-of-bounds requires a scalar epilogue iteration for correctness.
+  bool requiresScalarEpilogue() const { return RequiresScalarEpilogue; }
+
 private:
   ScalarEvolution *SE;
   Loop *TheLoop;
   DominatorTree *DT;
 
+  /// True if the loop may contain non-reversed interleaved groups with
+  /// out-of-bounds accesses. We ensure we don't speculatively access memory
+  /// out-of-bounds by executing at least one scalar epilogue iteration.
+  bool RequiresScalarEpilogue;
+
   /// Holds the relationships between the members and the interleave group.
   DenseMap<Instruction *, InterleaveGroup *> InterleaveGroupMap;
 
@@ -942,6 +994,12 @@ public:
     return InterleaveInfo.getInterleaveGroup(Instr);
   }
 
+  /// \brief Returns true if an interleaved group requires a scalar iteration
+  /// to handle accesses with gaps.
+  bool requiresScalarEpilogue() const {
+    return InterleaveInfo.requiresScalarEpilogue();
+  }
+
   unsigned getMaxSafeDepDistBytes() { return LAI->getMaxSafeDepDistBytes(); }
 
   bool hasStride(Value *V) { return StrideSet.count(V); }
@@ -1100,8 +1158,9 @@ public:
   /// \return The most profitable vectorization factor and the cost of that VF.
   /// This method checks every power of two up to VF. If UserVF is not ZERO
   /// then this vectorization factor will be selected if vectorization is
-  /// possible.
-  VectorizationFactor selectVectorizationFactor(bool OptForSize);
+  /// possible. If MaxVF is not ZERO, no factor wider than MaxVF is considered.
+  VectorizationFactor selectVectorizationFactor(bool OptForSize,
+                                                unsigned MaxVF = 0);
 
   /// \return The size (in bits) of the widest type in the code that
   /// needs to be vectorized. We ignore values that remain scalar such as
@@ -1423,6 +1482,15 @@ static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
     addInnerLoop(*InnerL, V);
 }
 
+/// Collect the loops whose only subloop is an innermost loop.
+static void addOuterLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
+  if (L.getSubLoops().size() == 1 && L.getSubLoops()[0]->empty())
+    return V.push_back(&L);
+
+  for (Loop *InnerL : L)
+    addOuterLoop(*InnerL, V);
+}
+
 /// The LoopVectorize Pass.
 struct LoopVectorize : public FunctionPass {
   /// Pass identification, replacement for typeid
@@ -1476,6 +1544,18 @@ struct LoopVectorize : public FunctionPass {
     if (!TTI->getNumberOfRegisters(true) && TTI->getMaxInterleaveFactor(1) < 2)
       return false;
 
+    bool Changed = false;
+
+    // Turn outer loops with a short inner loop into innermost loops when
+    // the result would be vectorized.
+    if (EnableOuterLoopVectorization) {
+      SmallVector<Loop *, 8> OuterLoops;
+      for (Loop *L : *LI)
+        addOuterLoop(*L, OuterLoops);
+      for (Loop *L : OuterLoops)
+        Changed |= flattenInnerLoop(L);
+    }
+
     // Build up a worklist of inner-loops to vectorize. This is necessary as
     // the act of vectorizing or partially unrolling a loop creates new loops
     // and can invalidate iterators across the loops.
@@ -1487,7 +1567,6 @@ struct LoopVectorize : public FunctionPass {
     LoopsAnalyzed += Worklist.size();
 
     // Now walk the identified inner loops.
-    bool Changed = false;
     while (!Worklist.empty())
       Changed |= processLoop(Worklist.pop_back_val());
 
@@ -1529,7 +1608,166 @@ struct LoopVectorize : public FunctionPass {
     }
   }
 
-  bool processLoop(Loop *L) {
+  /// Fully unroll the only subloop of L if its trip count is a small constant
+  /// and L can then be vectorized as an innermost loop.
+  ///
+  /// The unrolling is done on a copy of the loop nest that is entered through
+  /// a constant branch next to L. processLoop makes its decision on the copy
+  /// without changing it, and then the version that is not kept is deleted,
+  /// so the IR is only changed when the flattened loop will be vectorized.
+  bool flattenInnerLoop(Loop *L) {
+    LoopVectorizeHints Hints(L, DisableUnrolling);
+    if (Hints.getForce() == LoopVectorizeHints::FK_Disabled ||
+        (Hints.getWidth() == 1 && Hints.getInterleave() == 1))
+      return false;
+    if (!AlwaysVectorize && Hints.getForce() != LoopVectorizeHints::FK_Enabled)
+      return false;
+
+    // The inner trip count must be the same on every outer iteration.
+    Loop *Inner = L->getSubLoops()[0];
+    unsigned TC = SE->getSmallConstantTripCount(Inner);
+    if (TC == 0 || TC > OuterLoopMaxInnerTripCount)
+      return false;
+
+    if (MDNode *LoopID = Inner->getLoopID())
+      if (GetUnrollMetadata(LoopID, "llvm.loop.unroll.disable"))
+        return false;
+
+    unsigned InnerSize = 0;
+    for (BasicBlock *BB : Inner->getBlocks())
+      InnerSize += BB->size();
+    if (InnerSize * TC > OuterLoopUnrollThreshold)
+      return false;
+
+    // Both versions leave through the same exit block.
+    BasicBlock *Exit = L->getExitBlock();
+    BasicBlock *Exiting = L->getExitingBlock();
+    if (!Exit || !Exiting)
+      return false;
+
+    // Give L a new preheader and copy it along with the nest. The old
+    // preheader branches to the copy for as long as both versions exist.
+    BasicBlock *GuardBB = L->getLoopPreheader();
+    BasicBlock *PH = SplitBlock(GuardBB, GuardBB->getTerminator(), DT, LI);
+    ValueToValueMapTy VMap;
+    SmallVector<BasicBlock *, 16> FlatBlocks;
+    Loop *Flat = cloneLoopWithPreheader(PH, GuardBB, L, VMap, ".flat", LI, DT,
+                                        FlatBlocks);
+    remapInstructionsInBlocks(FlatBlocks, VMap);
+    BasicBlock *FlatPH = Flat->getLoopPreheader();
+
+    // cloneLoopWithPreheader does not copy subloops; rebuild the inner one.
+    Loop *FlatInner = new Loop();
+    Flat->addChildLoop(FlatInner);
+    for (BasicBlock *BB : Inner->getBlocks()) {
+      BasicBlock *NewBB = cast<BasicBlock>(VMap[BB]);
+      FlatInner->addBlockEntry(NewBB);
+      LI->changeLoopFor(NewBB, FlatInner);
+    }
+
+    Instruction *GuardTerm = GuardBB->getTerminator();
+    BranchInst::Create(FlatPH, PH,
+                       ConstantInt::getTrue(GuardBB->getContext()), GuardTerm);
+    GuardTerm->eraseFromParent();
+
+    BasicBlock *FlatExiting = cast<BasicBlock>(VMap[Exiting]);
+    PHINode *PN;
+    for (auto I = Exit->begin(); (PN = dyn_cast<PHINode>(I)); ++I) {
+      Value *V = PN->getIncomingValueForBlock(Exiting);
+      if (Value *NewV = VMap.lookup(V))
+        V = NewV;
+      PN->addIncoming(V, FlatExiting);
+      SE->forgetValue(PN);
+    }
+    DT->changeImmediateDominator(Exit, GuardBB);
+
+    // Keep the copy only if processLoop would vectorize it.
+    unsigned FlatVF = 1;
+    if (UnrollLoop(FlatInner, TC, TC, /*AllowRuntime=*/false,
+                   /*AllowExpensiveTripCount=*/false, TC, LI, this,
+                   /*LPM=*/nullptr, AC))
+      processLoop(Flat, /*EpilogueVF=*/0, &FlatVF);
+
+    if (FlatVF == 1) {
+      DEBUG(dbgs() << "LV: Not flattening an outer loop: it would not be "
+                      "vectorized.\n");
+      removeLoopVersion(Flat, FlatPH, PH, GuardBB, Exit);
+      return false;
+    }
+
+    removeLoopVersion(L, PH, FlatPH, GuardBB, Exit);
+    DEBUG(dbgs() << "LV: Unrolled an inner loop with trip count " << TC
+                 << " to vectorize its outer loop.\n");
+    ++InnerLoopsFlattened;
+    return true;
+  }
+
+  /// Returns the frequency of the block that enters L. Blocks this pass
+  /// created are unknown to BFI, so walk up to the nearest block it knows.
+  BlockFrequency getEntryFreq(Loop *L) {
+    BasicBlock *BB = L->getLoopPreheader();
+    while (!BFI->getBlockFreq(BB).getFrequency())
+      if (!(BB = BB->getSinglePredecessor()))
+        return BlockFrequency(0);
+    return BFI->getBlockFreq(BB);
+  }
+
+  /// Delete one of the two loop nests made by flattenInnerLoop: the loop Dead
+  /// with its preheader DeadPH, and everything they dominate. GuardBB then
+  /// branches to KeptPH alone, which is merged into it.
+  void removeLoopVersion(Loop *Dead, BasicBlock *DeadPH, BasicBlock *KeptPH,
+                         BasicBlock *GuardBB, BasicBlock *Exit) {
+    SmallVector<BasicBlock *, 16> DeadBlocks;
+    for (DomTreeNode *N : depth_first(DT->getNode(DeadPH)))
+      DeadBlocks.push_back(N->getBlock());
+    SmallPtrSet<BasicBlock *, 16> DeadSet(DeadBlocks.begin(), DeadBlocks.end());
+
+    Instruction *GuardTerm = GuardBB->getTerminator();
+    BranchInst::Create(KeptPH, GuardTerm);
+    GuardTerm->eraseFromParent();
+
+    // Keep the exit block's LCSSA phis even when a single entry is left.
+    for (BasicBlock *BB : DeadBlocks)
+      for (BasicBlock *Succ : successors(BB))
+        if (!DeadSet.count(Succ))
+          Succ->removePredecessor(BB, /*DontDeleteUselessPHIs=*/true);
+    PHINode *PN;
+    for (auto I = Exit->begin(); (PN = dyn_cast<PHINode>(I)); ++I)
+      SE->forgetValue(PN);
+
+    SE->forgetLoop(Dead);
+    LAA->forgetLoop(Dead);
+    for (auto I = DeadBlocks.rbegin(), E = DeadBlocks.rend(); I != E; ++I) {
+      LI->removeBlock(*I);
+      DT->eraseNode(*I);
+    }
+    if (Loop *Parent = Dead->getParentLoop())
+      Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), Dead));
+    else
+      LI->removeLoop(std::find(LI->begin(), LI->end(), Dead));
+    delete Dead;
+
+    for (BasicBlock *BB : DeadBlocks)
+      BB->dropAllReferences();
+    for (BasicBlock *BB : DeadBlocks)
+      BB->eraseFromParent();
+
+    BasicBlock *IDom = nullptr;
+    for (BasicBlock *Pred : predecessors(Exit))
+      IDom = IDom ? DT->findNearestCommonDominator(IDom, Pred) : Pred;
+    DT->changeImmediateDominator(Exit, IDom);
+
+    MergeBlockIntoPredecessor(KeptPH, DT, LI);
+  }
+
+  /// Vectorize the innermost loop L if it is legal and profitable. If
+  /// EpilogueVF is not zero, L is the remainder loop of a loop that was just
+  /// vectorized, and it is only vectorized with a width of at most EpilogueVF
+  /// and without interleaving. If DryRunVF is not null, the IR is left alone
+  /// and no remarks are emitted; the vectorization factor that would be used
+  /// is stored to it instead, or 1 if the loop would not be vectorized.
+  bool processLoop(Loop *L, unsigned EpilogueVF = 0,
+                   unsigned *DryRunVF = nullptr) {
     assert(L->empty() && "Only process inner loops.");
 
 #ifndef NDEBUG
@@ -1554,6 +1792,10 @@ struct LoopVectorize : public FunctionPass {
     // Function containing loop
     Function *F = L->getHeader()->getParent();
 
+    bool Report = !DryRunVF;
+    if (DryRunVF)
+      *DryRunVF = 1;
+
     // Looking at the diagnostic output is the only way to determine if a loop
     // was vectorized (other than looking at the IR or machine code), so it
     // is important to generate an optimization remark for each loop. Most of
@@ -1564,24 +1806,27 @@ struct LoopVectorize : public FunctionPass {
 
     if (Hints.getForce() == LoopVectorizeHints::FK_Disabled) {
       DEBUG(dbgs() << "LV: Not vectorizing: #pragma vectorize disable.\n");
-      emitOptimizationRemarkAnalysis(F->getContext(), DEBUG_TYPE, *F,
-                                     L->getStartLoc(), Hints.emitRemark());
+      if (Report)
+        emitOptimizationRemarkAnalysis(F->getContext(), DEBUG_TYPE, *F,
+                                       L->getStartLoc(), Hints.emitRemark());
       return false;
     }
 
     if (!AlwaysVectorize && Hints.getForce() != LoopVectorizeHints::FK_Enabled) {
       DEBUG(dbgs() << "LV: Not vectorizing: No #pragma vectorize enable.\n");
-      emitOptimizationRemarkAnalysis(F->getContext(), DEBUG_TYPE, *F,
-                                     L->getStartLoc(), Hints.emitRemark());
+      if (Report)
+        emitOptimizationRemarkAnalysis(F->getContext(), DEBUG_TYPE, *F,
+                                       L->getStartLoc(), Hints.emitRemark());
       return false;
     }
 
     if (Hints.getWidth() == 1 && Hints.getInterleave() == 1) {
       DEBUG(dbgs() << "LV: Not vectorizing: Disabled/already vectorized.\n");
-      emitOptimizationRemarkAnalysis(
-          F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
-          "loop not vectorized: vector width and interleave count are "
-          "explicitly set to 1");
+      if (Report)
+        emitOptimizationRemarkAnalysis(
+            F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
+            "loop not vectorized: vector width and interleave count are "
+            "explicitly set to 1");
       return false;
     }
 
@@ -1595,9 +1840,10 @@ struct LoopVectorize : public FunctionPass {
         DEBUG(dbgs() << " But vectorizing was explicitly forced.\n");
       else {
         DEBUG(dbgs() << "\n");
-        emitOptimizationRemarkAnalysis(
-            F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
-            "vectorization is not beneficial and is not explicitly forced");
+        if (Report)
+          emitOptimizationRemarkAnalysis(
+              F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
+              "vectorization is not beneficial and is not explicitly forced");
         return false;
       }
     }
@@ -1606,7 +1852,8 @@ struct LoopVectorize : public FunctionPass {
     LoopVectorizationLegality LVL(L, SE, DT, TLI, AA, F, TTI, LAA);
     if (!LVL.canVectorize()) {
       DEBUG(dbgs() << "LV: Not vectorizing: Cannot prove legality.\n");
-      emitMissedWarning(F, L, Hints);
+      if (Report)
+        emitMissedWarning(F, L, Hints);
       return false;
     }
 
@@ -1624,7 +1871,7 @@ struct LoopVectorize : public FunctionPass {
     // FIXME: This is hidden behind a flag due to pervasive problems with
     // exactly what block frequency models.
     if (LoopVectorizeWithBlockFrequency) {
-      BlockFrequency LoopEntryFreq = BFI->getBlockFreq(L->getLoopPreheader());
+      BlockFrequency LoopEntryFreq = getEntryFreq(L);
       if (Hints.getForce() != LoopVectorizeHints::FK_Enabled &&
           LoopEntryFreq < ColdEntryFreq)
         OptForSize = true;
@@ -1637,19 +1884,33 @@ struct LoopVectorize : public FunctionPass {
     if (F->hasFnAttribute(Attribute::NoImplicitFloat)) {
       DEBUG(dbgs() << "LV: Can't vectorize when the NoImplicitFloat"
             "attribute is used.\n");
-      emitOptimizationRemarkAnalysis(
-          F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
-          "loop not vectorized due to NoImplicitFloat attribute");
-      emitMissedWarning(F, L, Hints);
+      if (Report) {
+        emitOptimizationRemarkAnalysis(
+            F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
+            "loop not vectorized due to NoImplicitFloat attribute");
+        emitMissedWarning(F, L, Hints);
+      }
       return false;
     }
 
     // Select the optimal vectorization factor.
     const LoopVectorizationCostModel::VectorizationFactor VF =
-        CM.selectVectorizationFactor(OptForSize);
+        CM.selectVectorizationFactor(OptForSize, EpilogueVF);
+    if (DryRunVF) {
+      *DryRunVF = VF.Width;
+      return false;
+    }
 
-    // Select the interleave count.
-    unsigned IC = CM.selectInterleaveCount(OptForSize, VF.Width, VF.Cost);
+    // Select the interleave count. An epilogue runs for fewer iterations than
+    // the main loop's vector step, so it is never interleaved.
+    unsigned IC = 1;
+    if (!EpilogueVF)
+      IC = CM.selectInterleaveCount(OptForSize, VF.Width, VF.Cost);
+
+    if (EpilogueVF && VF.Width == 1) {
+      DEBUG(dbgs() << "LV: Not vectorizing the epilogue: not beneficial.\n");
+      return false;
+    }
 
     DEBUG(dbgs() << "LV: Found a vectorizable loop (" << VF.Width << ") in "
                  << DebugLocStr << '\n');
@@ -1687,9 +1948,20 @@ struct LoopVectorize : public FunctionPass {
 
       // Report the vectorization decision.
       emitOptimizationRemark(F->getContext(), DEBUG_TYPE, *F, L->getStartLoc(),
-                             Twine("vectorized loop (vectorization width: ") +
-                                 Twine(VF.Width) + ", interleaved count: " +
-                                 Twine(IC) + ")");
+                             Twine(EpilogueVF ? "vectorized epilogue loop"
+                                              : "vectorized loop") +
+                                 " (vectorization width: " + Twine(VF.Width) +
+                                 ", interleaved count: " + Twine(IC) + ")");
+      if (EpilogueVF)
+        ++EpiloguesVectorized;
+
+      // L is now the scalar remainder loop. When there are no runtime checks
+      // it only ever runs the last few iterations, so try to vectorize it
+      // again with a narrower width. The user's width hint, if any, applies
+      // to the main loop only.
+      if (EnableEpilogueVectorization && !EpilogueVF && VF.Width > 2 &&
+          !LB.IsSafetyChecksAdded() && Hints.getWidth() == 0)
+        vectorizeEpilogue(L, VF.Width / 2);
     }
 
     // Mark the loop as already vectorized to avoid vectorizing again.
@@ -1699,6 +1971,16 @@ struct LoopVectorize : public FunctionPass {
     return true;
   }
 
+  /// Vectorize the remainder loop L of a freshly vectorized loop with a width
+  /// of at most MaxVF.
+  void vectorizeEpilogue(Loop *L, unsigned MaxVF) {
+    // The exit block of the remainder is shared with the vector loop's middle
+    // block, so restore the simplified and LCSSA forms that legality expects.
+    simplifyLoop(L, DT, LI, this, AA, SE, AC);
+    formLCSSA(*L, *DT, LI, SE);
+    processLoop(L, MaxVF);
+  }
+
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<AssumptionCacheTracker>();
     AU.addRequiredID(LoopSimplifyID);
@@ -2625,6 +2907,16 @@ void InnerLoopVectorizer::createEmptyLoop() {
   // Now we need to generate the expression for N - (N % VF), which is
   // the part that the vectorized body will execute.
   Value *R = BypassBuilder.CreateURem(Count, Step, "n.mod.vf");
+
+  // If there is an interleaved group that may speculatively access memory
+  // past the accesses of the last scalar iteration, make sure that at least
+  // one iteration is left to the scalar epilogue: if the step evenly divides
+  // the trip count, set the remainder to be equal to the step.
+  if (VF > 1 && Legal->requiresScalarEpilogue()) {
+    Value *IsZero = BypassBuilder.CreateICmpEQ(
+        R, ConstantInt::get(R->getType(), 0), "n.mod.vf.zero");
+    R = BypassBuilder.CreateSelect(IsZero, Step, R, "n.rem");
+  }
   Value *CountRoundDown = BypassBuilder.CreateSub(Count, R, "n.vec");
   Value *IdxEndRoundDown = BypassBuilder.CreateAdd(CountRoundDown, StartIdx,
                                                      "end.idx.rnd.down");
@@ -3880,7 +4172,7 @@ bool LoopVectorizationLegality::canVectorize() {
                << "!\n");
 
   // Analyze interleaved memory accesses.
-  if (EnableInterleavedMemAccesses)
+  if (useInterleavedAccesses(TTI))
     InterleaveInfo.analyzeInterleaving(Strides);
 
   // Okay! We can vectorize. At this point we don't have any other mem analysis
@@ -4368,8 +4660,9 @@ void InterleavedAccessInfo::analyzeInterleaving(
   if (StrideAccesses.empty())
     return;
 
-  // Holds all interleaved store groups temporarily.
+  // Holds all interleaved store and load groups temporarily.
   SmallSetVector<InterleaveGroup *, 4> StoreGroups;
+  SmallSetVector<InterleaveGroup *, 4> LoadGroups;
 
   // Search the load-load/write-write pair B-A in bottom-up order and try to
   // insert B into the interleave group of A according to 3 rules:
@@ -4397,6 +4690,8 @@ void InterleavedAccessInfo::analyzeInterleaving(
 
     if (A->mayWriteToMemory())
       StoreGroups.insert(Group);
+    else
+      LoadGroups.insert(Group);
 
     for (auto II = std::next(I); II != E; ++II) {
       Instruction *B = II->first;
@@ -4440,14 +4735,33 @@ void InterleavedAccessInfo::analyzeInterleaving(
     } // Iteration on instruction B
   }   // Iteration on instruction A
 
-  // Remove interleaved store groups with gaps.
+  // Remove interleaved store groups with gaps. Writing such a group as one
+  // wide store would clobber the missing members; that needs masked stores,
+  // which are not supported here.
   for (InterleaveGroup *Group : StoreGroups)
     if (Group->getNumMembers() != Group->getFactor())
       releaseGroup(Group);
+
+  // A load group without its last member reads memory beyond the last member
+  // of the final iteration. If the group is not reversed, keep it and make the
+  // vector loop leave at least one iteration to the scalar epilogue. A
+  // reversed group would read beyond the first iteration instead, which no
+  // epilogue can cover, so remove it.
+  for (InterleaveGroup *Group : LoadGroups) {
+    if (Group->getMember(Group->getFactor() - 1))
+      continue;
+    if (Group->isReverse()) {
+      releaseGroup(Group);
+      continue;
+    }
+    DEBUG(dbgs() << "LV: Interleaved group requires epilogue iteration.\n");
+    RequiresScalarEpilogue = true;
+  }
 }
 
 LoopVectorizationCostModel::VectorizationFactor
-LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
+LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize,
+                                                      unsigned MaxVF) {
   // Width 1 means no vectorize
   VectorizationFactor Factor = { 1U, 0U };
   if (OptForSize && Legal->getRuntimePointerChecking()->Need) {
@@ -4487,6 +4801,11 @@ LoopVectorizationCostModel::selectVectorizationFactor(bool OptForSize) {
     MaxVectorSize = 1;
   }
 
+  if (MaxVF != 0 && MaxVectorSize > MaxVF) {
+    DEBUG(dbgs() << "LV: Limiting the vector width to " << MaxVF << ".\n");
+    MaxVectorSize = MaxVF;
+  }
+
   assert(MaxVectorSize <= 64 && "Did not expect to pack so many elements"
          " into one vector!");
 
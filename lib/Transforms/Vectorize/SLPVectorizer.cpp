@@ -73,11 +73,23 @@ static cl::opt<int>
 MaxVectorRegSizeOption("slp-max-reg-size", cl::init(128), cl::Hidden,
     cl::desc("Attempt to vectorize for this register size in bits"));
 
+/// Limits the size of scheduling regions in a block.
+/// It avoid long compile times for _very_ large blocks where vector
+/// instructions are spread over a wide range.
+/// This limit is way higher than needed by real-world functions.
+static cl::opt<int>
+ScheduleRegionSizeBudget("slp-schedule-budget", cl::init(100000), cl::Hidden,
+    cl::desc("Limit the size of the SLP scheduling region per block"));
+
 namespace {
 
 // FIXME: Set this via cl::opt to allow overriding.
 static const unsigned MinVecRegSize = 128;
 
+// The scheduling region of a block never shrinks below this many
+// instructions, however much of the budget earlier trees have used up.
+static const int MinScheduleRegionSize = 16;
+
 static const unsigned RecursionMaxDepth = 12;
 
 // Limit the number of alias checks. The limit is chosen so that
@@ -717,6 +729,8 @@ private:
         : BB(BB), ChunkSize(BB->size()), ChunkPos(ChunkSize),
           ScheduleStart(nullptr), ScheduleEnd(nullptr),
           FirstLoadStoreInRegion(nullptr), LastLoadStoreInRegion(nullptr),
+          ScheduleRegionSize(0),
+          ScheduleRegionSizeLimit(ScheduleRegionSizeBudget),
           // Make sure that the initial SchedulingRegionID is greater than the
           // initial SchedulingRegionID in ScheduleData (which is 0).
           SchedulingRegionID(1) {}
@@ -728,6 +742,13 @@ private:
       FirstLoadStoreInRegion = nullptr;
       LastLoadStoreInRegion = nullptr;
 
+      // Reduce the maximum schedule region size by the size of the
+      // previous scheduling run.
+      ScheduleRegionSizeLimit -= ScheduleRegionSize;
+      if (ScheduleRegionSizeLimit < MinScheduleRegionSize)
+        ScheduleRegionSizeLimit = MinScheduleRegionSize;
+      ScheduleRegionSize = 0;
+
       // Make a new scheduling region, i.e. all existing ScheduleData is not
       // in the new region yet.
       ++SchedulingRegionID;
@@ -797,14 +818,15 @@ private:
 
     /// Checks if a bundle of instructions can be scheduled, i.e. has no
     /// cyclic dependencies. This is only a dry-run, no instructions are
-    /// actually moved at this stage.
+    /// actually moved at this stage. On failure the bundle is cancelled.
     bool tryScheduleBundle(ArrayRef<Value *> VL, BoUpSLP *SLP);
 
     /// Un-bundles a group of instructions.
     void cancelScheduling(ArrayRef<Value *> VL);
 
     /// Extends the scheduling region so that V is inside the region.
-    void extendSchedulingRegion(Value *V);
+    /// \returns true if the region size is within the limit.
+    bool extendSchedulingRegion(Value *V);
 
     /// Initialize the ScheduleData structures for new instructions in the
     /// scheduling region.
@@ -858,6 +880,12 @@ private:
     /// (can be null).
     ScheduleData *LastLoadStoreInRegion;
 
+    /// The current size of the scheduling region.
+    int ScheduleRegionSize;
+
+    /// The maximum size allowed for the scheduling region.
+    int ScheduleRegionSizeLimit;
+
     /// The ID of the scheduling region. For a new vectorization iteration this
     /// is incremented which "removes" all ScheduleData from the region.
     int SchedulingRegionID;
@@ -1077,7 +1105,9 @@ void BoUpSLP::buildTree_rec(ArrayRef<Value *> VL, unsigned Depth) {
 
   if (!BS.tryScheduleBundle(VL, this)) {
     DEBUG(dbgs() << "SLP: We are not able to schedule this bundle!\n");
-    BS.cancelScheduling(VL);
+    assert((!BS.getScheduleData(VL[0]) ||
+            !BS.getScheduleData(VL[0])->isPartOfBundle()) &&
+           "tryScheduleBundle should cancelScheduling on failure");
     newTreeEntry(VL, false);
     return;
   }
@@ -2683,8 +2713,24 @@ bool BoUpSLP::BlockScheduling::tryScheduleBundle(ArrayRef<Value *> VL,
   ScheduleData *Bundle = nullptr;
   bool ReSchedule = false;
   DEBUG(dbgs() << "SLP:  bundle: " << *VL[0] << "\n");
+
+  // Make sure that the scheduling region contains all
+  // instructions of the bundle.
+  for (Value *V : VL) {
+    if (!extendSchedulingRegion(V)) {
+      // The region may already have grown at its lower end, so make sure that
+      // the dependencies are recalculated for the next bundle.
+      if (ScheduleEnd != OldScheduleEnd) {
+        for (auto *I = ScheduleStart; I != ScheduleEnd; I = I->getNextNode())
+          getScheduleData(I)->clearDependencies();
+        resetSchedule();
+        initialFillReadyList(ReadyInsts);
+      }
+      return false;
+    }
+  }
+
   for (Value *V : VL) {
-    extendSchedulingRegion(V);
     ScheduleData *BundleMember = getScheduleData(V);
     assert(BundleMember &&
            "no ScheduleData for bundle member (maybe not in same basic block)");
@@ -2745,7 +2791,11 @@ bool BoUpSLP::BlockScheduling::tryScheduleBundle(ArrayRef<Value *> VL,
       schedule(pickedSD, ReadyInsts);
     }
   }
-  return Bundle->isReady();
+  if (!Bundle->isReady()) {
+    cancelScheduling(VL);
+    return false;
+  }
+  return true;
 }
 
 void BoUpSLP::BlockScheduling::cancelScheduling(ArrayRef<Value *> VL) {
@@ -2774,9 +2824,9 @@ void BoUpSLP::BlockScheduling::cancelScheduling(ArrayRef<Value *> VL) {
   }
 }
 
-void BoUpSLP::BlockScheduling::extendSchedulingRegion(Value *V) {
+bool BoUpSLP::BlockScheduling::extendSchedulingRegion(Value *V) {
   if (getScheduleData(V))
-    return;
+    return true;
   Instruction *I = dyn_cast<Instruction>(V);
   assert(I && "bundle member must be an instruction");
   assert(!isa<PHINode>(I) && "phi nodes don't need to be scheduled");
@@ -2787,7 +2837,7 @@ void BoUpSLP::BlockScheduling::extendSchedulingRegion(Value *V) {
     ScheduleEnd = I->getNextNode();
     assert(ScheduleEnd && "tried to vectorize a TerminatorInst?");
     DEBUG(dbgs() << "SLP:  initialize schedule region to " << *I << "\n");
-    return;
+    return true;
   }
   // Search up and down at the same time, because we don't know if the new
   // instruction is above or below the existing scheduling region.
@@ -2796,12 +2846,16 @@ void BoUpSLP::BlockScheduling::extendSchedulingRegion(Value *V) {
   BasicBlock::iterator DownIter(ScheduleEnd);
   BasicBlock::iterator LowerEnd = BB->end();
   for (;;) {
+    if (++ScheduleRegionSize > ScheduleRegionSizeLimit) {
+      DEBUG(dbgs() << "SLP:  exceeded schedule region size limit\n");
+      return false;
+    }
     if (UpIter != UpperEnd) {
       if (&*UpIter == I) {
         initScheduleData(I, ScheduleStart, nullptr, FirstLoadStoreInRegion);
         ScheduleStart = I;
         DEBUG(dbgs() << "SLP:  extend schedule region start to " << *I << "\n");
-        return;
+        return true;
       }
       UpIter++;
     }
@@ -2812,7 +2866,7 @@ void BoUpSLP::BlockScheduling::extendSchedulingRegion(Value *V) {
         ScheduleEnd = I->getNextNode();
         assert(ScheduleEnd && "tried to vectorize a TerminatorInst?");
         DEBUG(dbgs() << "SLP:  extend schedule region end to " << *I << "\n");
-        return;
+        return true;
       }
       DownIter++;
     }
@@ -3516,10 +3570,42 @@ static Value *createRdxShuffleMask(unsigned VecLen, unsigned NumEltsToRdx,
 }
 
 
+/// \brief Returns true if I is an integer minimum or maximum written as a
+/// compare and a select of the two compared values. On success Pred is the
+/// strict predicate under which LHS is the result, and LHS and RHS are the
+/// two values.
+static bool matchMinMax(Instruction *I, CmpInst::Predicate &Pred, Value *&LHS,
+                        Value *&RHS) {
+  SelectInst *SI = dyn_cast<SelectInst>(I);
+  if (!SI)
+    return false;
+  ICmpInst *Cmp = dyn_cast<ICmpInst>(SI->getCondition());
+  if (!Cmp || !Cmp->hasOneUse() || Cmp->getParent() != SI->getParent())
+    return false;
+
+  LHS = SI->getTrueValue();
+  RHS = SI->getFalseValue();
+  Pred = Cmp->getPredicate();
+  if (Cmp->getOperand(0) == RHS && Cmp->getOperand(1) == LHS)
+    Pred = CmpInst::getSwappedPredicate(Pred);
+  else if (Cmp->getOperand(0) != LHS || Cmp->getOperand(1) != RHS)
+    return false;
+
+  // Both a non-strict and a strict compare pick the same value.
+  switch (Pred) {
+  case CmpInst::ICMP_SGE: Pred = CmpInst::ICMP_SGT; return true;
+  case CmpInst::ICMP_SLE: Pred = CmpInst::ICMP_SLT; return true;
+  case CmpInst::ICMP_UGE: Pred = CmpInst::ICMP_UGT; return true;
+  case CmpInst::ICMP_ULE: Pred = CmpInst::ICMP_ULT; return true;
+  default: return ICmpInst::isRelational(Pred);
+  }
+}
+
 /// Model horizontal reductions.
 ///
-/// A horizontal reduction is a tree of reduction operations (currently add and
-/// fadd) that has operations that can be put into a vector as its leaf.
+/// A horizontal reduction is a tree of reduction operations (currently add,
+/// fadd and integer min and max) that has operations that can be put into a
+/// vector as its leaf.
 /// For example, this tree:
 ///
 /// mul mul mul mul
@@ -3543,15 +3629,21 @@ static Value *createRdxShuffleMask(unsigned VecLen, unsigned NumEltsToRdx,
 ///     |
 ///   *p =
 ///
+/// A min or max reduction operation is a select and the compare feeding it,
+/// and both are recorded as reduction operations.
+///
 class HorizontalReduction {
   SmallVector<Value *, 16> ReductionOps;
   SmallVector<Value *, 32> ReducedVals;
 
-  BinaryOperator *ReductionRoot;
+  Instruction *ReductionRoot;
   PHINode *ReductionPHI;
 
   /// The opcode of the reduction.
   unsigned ReductionOpcode;
+  /// The predicate of a min or max reduction, whose ReductionOpcode is
+  /// Instruction::Select.
+  CmpInst::Predicate MinMaxPred;
   /// The opcode of the values we perform a reduction on.
   unsigned ReducedValueOpcode;
   /// The width of one full horizontal reduction operation.
@@ -3563,10 +3655,11 @@ class HorizontalReduction {
 public:
   HorizontalReduction()
     : ReductionRoot(nullptr), ReductionPHI(nullptr), ReductionOpcode(0),
-    ReducedValueOpcode(0), ReduxWidth(0), IsPairwiseReduction(false) {}
+    MinMaxPred(CmpInst::BAD_ICMP_PREDICATE), ReducedValueOpcode(0),
+    ReduxWidth(0), IsPairwiseReduction(false) {}
 
   /// \brief Try to find a reduction tree.
-  bool matchAssociativeReduction(PHINode *Phi, BinaryOperator *B) {
+  bool matchAssociativeReduction(PHINode *Phi, Instruction *B) {
     assert((!Phi ||
             std::find(Phi->op_begin(), Phi->op_end(), B) != Phi->op_end()) &&
            "Thi phi needs to use the binary operator");
@@ -3574,14 +3667,23 @@ public:
     // We could have a initial reductions that is not an add.
     //  r *= v1 + v2 + v3 + v4
     // In such a case start looking for a tree rooted in the first '+'.
+    CmpInst::Predicate Pred;
+    Value *LHS, *RHS;
     if (Phi) {
-      if (B->getOperand(0) == Phi) {
+      if (isa<BinaryOperator>(B)) {
+        LHS = B->getOperand(0);
+        RHS = B->getOperand(1);
+      } else if (!matchMinMax(B, Pred, LHS, RHS))
+        return false;
+      if (LHS == Phi) {
         Phi = nullptr;
-        B = dyn_cast<BinaryOperator>(B->getOperand(1));
-      } else if (B->getOperand(1) == Phi) {
+        B = dyn_cast<Instruction>(RHS);
+      } else if (RHS == Phi) {
         Phi = nullptr;
-        B = dyn_cast<BinaryOperator>(B->getOperand(0));
-      }
+        B = dyn_cast<Instruction>(LHS);
+      } else if (!isa<BinaryOperator>(B))
+        // Only an add can have the phi deeper in the tree.
+        return false;
     }
 
     if (!B)
@@ -3603,27 +3705,31 @@ public:
     if (ReduxWidth < 4)
       return false;
 
-    // We currently only support adds.
-    if (ReductionOpcode != Instruction::Add &&
-        ReductionOpcode != Instruction::FAdd)
+    // We currently only support adds and integer min and max.
+    if (ReductionOpcode == Instruction::Select) {
+      if (!matchMinMax(B, MinMaxPred, LHS, RHS))
+        return false;
+    } else if (ReductionOpcode != Instruction::Add &&
+               ReductionOpcode != Instruction::FAdd)
       return false;
 
     // Post order traverse the reduction tree starting at B. We only handle true
-    // trees containing only binary operators.
-    SmallVector<std::pair<BinaryOperator *, unsigned>, 32> Stack;
+    // trees containing only binary operators or only min and max operations.
+    SmallVector<std::pair<Instruction *, unsigned>, 32> Stack;
     Stack.push_back(std::make_pair(B, 0));
     while (!Stack.empty()) {
-      BinaryOperator *TreeN = Stack.back().first;
+      Instruction *TreeN = Stack.back().first;
       unsigned EdgeToVist = Stack.back().second++;
-      bool IsReducedValue = TreeN->getOpcode() != ReductionOpcode;
+      bool IsReducedValue = !isReductionOp(TreeN, LHS, RHS);
 
       // Only handle trees in the current basic block.
       if (TreeN->getParent() != B->getParent())
         return false;
 
       // Each tree node needs to have one user except for the ultimate
-      // reduction.
-      if (!TreeN->hasOneUse() && TreeN != B)
+      // reduction. A min or max uses its operands in both the compare and
+      // the select.
+      if (TreeN != B && !TreeN->hasNUses(isMinMax() ? 2 : 1))
         return false;
 
       // Postorder vist.
@@ -3638,9 +3744,11 @@ public:
           ReducedVals.push_back(TreeN);
         } else {
           // We need to be able to reassociate the adds.
-          if (!TreeN->isAssociative())
+          if (!isMinMax() && !TreeN->isAssociative())
             return false;
           ReductionOps.push_back(TreeN);
+          if (isMinMax())
+            ReductionOps.push_back(cast<SelectInst>(TreeN)->getCondition());
         }
         // Retract.
         Stack.pop_back();
@@ -3648,8 +3756,8 @@ public:
       }
 
       // Visit left or right.
-      Value *NextV = TreeN->getOperand(EdgeToVist);
-      BinaryOperator *Next = dyn_cast<BinaryOperator>(NextV);
+      Value *NextV = EdgeToVist == 0 ? LHS : RHS;
+      Instruction *Next = dyn_cast<Instruction>(NextV);
       if (Next)
         Stack.push_back(std::make_pair(Next, 0));
       else if (NextV != Phi)
@@ -3694,8 +3802,8 @@ public:
       Value *ReducedSubTree = emitReduction(VectorizedRoot, Builder);
       if (VectorizedTree) {
         Builder.SetCurrentDebugLocation(Loc);
-        VectorizedTree = createBinOp(Builder, ReductionOpcode, VectorizedTree,
-                                     ReducedSubTree, "bin.rdx");
+        VectorizedTree =
+            createRdxOp(Builder, VectorizedTree, ReducedSubTree, "bin.rdx");
       } else
         VectorizedTree = ReducedSubTree;
     }
@@ -3705,8 +3813,7 @@ public:
       for (; i < NumReducedVals; ++i) {
         Builder.SetCurrentDebugLocation(
           cast<Instruction>(ReducedVals[i])->getDebugLoc());
-        VectorizedTree = createBinOp(Builder, ReductionOpcode, VectorizedTree,
-                                     ReducedVals[i]);
+        VectorizedTree = createRdxOp(Builder, VectorizedTree, ReducedVals[i]);
       }
       // Update users.
       if (ReductionPHI) {
@@ -3721,11 +3828,54 @@ public:
 
 private:
 
+  bool isMinMax() const { return ReductionOpcode == Instruction::Select; }
+
+  /// \brief Returns true if I is an operation of this reduction, and sets
+  /// LHS and RHS to its operands.
+  bool isReductionOp(Instruction *I, Value *&LHS, Value *&RHS) const {
+    if (I->getOpcode() != ReductionOpcode)
+      return false;
+    if (isMinMax()) {
+      CmpInst::Predicate Pred;
+      return matchMinMax(I, Pred, LHS, RHS) && Pred == MinMaxPred;
+    }
+    LHS = I->getOperand(0);
+    RHS = I->getOperand(1);
+    return true;
+  }
+
   /// \brief Calcuate the cost of a reduction.
   int getReductionCost(TargetTransformInfo *TTI, Value *FirstReducedVal) {
     Type *ScalarTy = FirstReducedVal->getType();
     Type *VecTy = VectorType::get(ScalarTy, ReduxWidth);
 
+    if (isMinMax()) {
+      // There is no target hook for min and max reductions; cost the
+      // splitting reduction that emitReduction produces.
+      IsPairwiseReduction = false;
+      Type *CondTy = VectorType::get(Type::getInt1Ty(ScalarTy->getContext()),
+                                     ReduxWidth);
+      int LevelCost =
+          TTI->getShuffleCost(TargetTransformInfo::SK_ExtractSubvector, VecTy,
+                              ReduxWidth / 2, VecTy) +
+          TTI->getCmpSelInstrCost(Instruction::ICmp, VecTy) +
+          TTI->getCmpSelInstrCost(Instruction::Select, VecTy, CondTy);
+      int VecReduxCost =
+          Log2_32(ReduxWidth) * LevelCost +
+          TTI->getVectorInstrCost(Instruction::ExtractElement, VecTy, 0);
+      int ScalarReduxCost =
+          ReduxWidth *
+          (TTI->getCmpSelInstrCost(Instruction::ICmp, ScalarTy) +
+           TTI->getCmpSelInstrCost(Instruction::Select, ScalarTy,
+                                   Type::getInt1Ty(ScalarTy->getContext())));
+
+      DEBUG(dbgs() << "SLP: Adding cost " << VecReduxCost - ScalarReduxCost
+                   << " for min/max reduction that starts with "
+                   << *FirstReducedVal << "\n");
+
+      return VecReduxCost - ScalarReduxCost;
+    }
+
     int PairwiseRdxCost = TTI->getReductionCost(ReductionOpcode, VecTy, true);
     int SplittingRdxCost = TTI->getReductionCost(ReductionOpcode, VecTy, false);
 
@@ -3744,11 +3894,17 @@ private:
     return VecReduxCost - ScalarReduxCost;
   }
 
-  static Value *createBinOp(IRBuilder<> &Builder, unsigned Opcode, Value *L,
-                            Value *R, const Twine &Name = "") {
-    if (Opcode == Instruction::FAdd)
+  /// \brief Emit one reduction operation combining L and R.
+  Value *createRdxOp(IRBuilder<> &Builder, Value *L, Value *R,
+                     const Twine &Name = "") {
+    if (isMinMax()) {
+      Value *Cmp = Builder.CreateICmp(MinMaxPred, L, R, Name + ".cmp");
+      return Builder.CreateSelect(Cmp, L, R, Name);
+    }
+    if (ReductionOpcode == Instruction::FAdd)
       return Builder.CreateFAdd(L, R, Name);
-    return Builder.CreateBinOp((Instruction::BinaryOps)Opcode, L, R, Name);
+    return Builder.CreateBinOp((Instruction::BinaryOps)ReductionOpcode, L, R,
+                               Name);
   }
 
   /// \brief Emit a horizontal reduction of the vectorized value.
@@ -3770,14 +3926,13 @@ private:
         Value *RightShuf = Builder.CreateShuffleVector(
           TmpVec, UndefValue::get(TmpVec->getType()), (RightMask),
           "rdx.shuf.r");
-        TmpVec = createBinOp(Builder, ReductionOpcode, LeftShuf, RightShuf,
-                             "bin.rdx");
+        TmpVec = createRdxOp(Builder, LeftShuf, RightShuf, "bin.rdx");
       } else {
         Value *UpperHalf =
           createRdxShuffleMask(ReduxWidth, i, false, false, Builder);
         Value *Shuf = Builder.CreateShuffleVector(
           TmpVec, UndefValue::get(TmpVec->getType()), UpperHalf, "rdx.shuf");
-        TmpVec = createBinOp(Builder, ReductionOpcode, TmpVec, Shuf, "bin.rdx");
+        TmpVec = createRdxOp(Builder, TmpVec, Shuf, "bin.rdx");
       }
     }
 
@@ -3893,20 +4048,19 @@ bool SLPVectorizer::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
     if (PHINode *P = dyn_cast<PHINode>(it)) {
       // Check that the PHI is a reduction PHI.
       if (P->getNumIncomingValues() != 2)
-        return Changed;
+        continue;
       Value *Rdx =
           (P->getIncomingBlock(0) == BB
                ? (P->getIncomingValue(0))
                : (P->getIncomingBlock(1) == BB ? P->getIncomingValue(1)
                                                : nullptr));
-      // Check if this is a Binary Operator.
-      BinaryOperator *BI = dyn_cast_or_null<BinaryOperator>(Rdx);
-      if (!BI)
+      Instruction *RdxI = dyn_cast_or_null<Instruction>(Rdx);
+      if (!RdxI)
         continue;
 
       // Try to match and vectorize a horizontal reduction.
       HorizontalReduction HorRdx;
-      if (ShouldVectorizeHor && HorRdx.matchAssociativeReduction(P, BI) &&
+      if (ShouldVectorizeHor && HorRdx.matchAssociativeReduction(P, RdxI) &&
           HorRdx.tryToReduce(R, TTI)) {
         Changed = true;
         it = BB->begin();
@@ -3914,6 +4068,11 @@ bool SLPVectorizer::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
         continue;
       }
 
+      // Check if this is a Binary Operator.
+      BinaryOperator *BI = dyn_cast<BinaryOperator>(RdxI);
+      if (!BI)
+        continue;
+
      Value *Inst = BI->getOperand(0);
       if (Inst == P)
         Inst = BI->getOperand(1);
@@ -3933,12 +4092,12 @@ bool SLPVectorizer::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
     // Try to vectorize horizontal reductions feeding into a store.
     if (ShouldStartVectorizeHorAtStore)
       if (StoreInst *SI = dyn_cast<StoreInst>(it))
-        if (BinaryOperator *BinOp =
-                dyn_cast<BinaryOperator>(SI->getValueOperand())) {
+        if (Instruction *I = dyn_cast<Instruction>(SI->getValueOperand())) {
           HorizontalReduction HorRdx;
-          if (((HorRdx.matchAssociativeReduction(nullptr, BinOp) &&
+          BinaryOperator *BinOp = dyn_cast<BinaryOperator>(I);
+          if (((HorRdx.matchAssociativeReduction(nullptr, I) &&
                 HorRdx.tryToReduce(R, TTI)) ||
-               tryToVectorize(BinOp, R))) {
+               (BinOp && tryToVectorize(BinOp, R)))) {
             Changed = true;
             it = BB->begin();
             e = BB->end();
@@ -3963,6 +4122,14 @@ bool SLPVectorizer::vectorizeChainsInBlock(BasicBlock *BB, BoUpSLP &R) {
 
     // Try to vectorize trees that start at compare instructions.
     if (CmpInst *CI = dyn_cast<CmpInst>(it)) {
+      // Leave the operands of a min or max to the horizontal reduction that
+      // is rooted at its user; pairing them here would break up the tree.
+      CmpInst::Predicate Pred;
+      Value *LHS, *RHS;
+      if (ShouldVectorizeHor && CI->hasOneUse() &&
+          matchMinMax(CI->user_back(), Pred, LHS, RHS))
+        continue;
+
       if (tryToVectorizePair(CI->getOperand(0), CI->getOperand(1), R)) {
         Changed = true;
         // We would like to start over since some instructions are deleted
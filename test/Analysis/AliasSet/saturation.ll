@@ -0,0 +1,63 @@
+; RUN: opt -basicaa -print-alias-sets -alias-set-saturation-threshold=2 -disable-output < %s 2>&1 | FileCheck %s --check-prefix=NOSAT
+; RUN: opt -basicaa -print-alias-sets -alias-set-saturation-threshold=1 -disable-output < %s 2>&1 | FileCheck %s --check-prefix=SAT
+
+; NOSAT-LABEL: Alias sets for function 'allmust'
+; NOSAT: must alias, Mod Pointers: (i32* %a, 4)
+; NOSAT: must alias, Mod Pointers: (i32* %b, 4)
+; NOSAT: must alias, Mod Pointers: (i32* %c, 4)
+; NOSAT: must alias, Mod Pointers: (i32* %d, 4)
+; SAT-LABEL: Alias sets for function 'allmust'
+; SAT: must alias, Mod Pointers: (i32* %a, 4)
+; SAT: must alias, Mod Pointers: (i32* %b, 4)
+; SAT: must alias, Mod Pointers: (i32* %c, 4)
+; SAT: must alias, Mod Pointers: (i32* %d, 4)
+define void @allmust() {
+  %a = alloca i32
+  %b = alloca i32
+  %c = alloca i32
+  %d = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  store i32 3, i32* %c
+  store i32 4, i32* %d
+  ret void
+}
+
+; Two pointers in a may-alias set stay below a threshold of 2, but go past a
+; threshold of 1, which collapses every set into one.
+
+; NOSAT-LABEL: Alias sets for function 'mergemay'
+; NOSAT: may alias, Mod Pointers: (i32* %a, 4), (i32* %a1, 4)
+; NOSAT: must alias, Mod Pointers: (i32* %b, 4)
+; SAT-LABEL: Alias sets for function 'mergemay'
+; SAT: may alias, alias any, Mod/Ref Pointers: (i32* %a, 4), (i32* %a1, 4), (i32* %b, 4)
+define void @mergemay(i32 %k) {
+  %a = alloca i32, i32 2
+  %b = alloca i32
+  store i32 1, i32* %a
+  %a1 = getelementptr i32, i32* %a, i32 %k
+  store i32 2, i32* %a1
+  store i32 3, i32* %b
+  ret void
+}
+
+; The call turns the must-alias set of %a and %a0 into a may-alias set, which
+; puts two pointers in may-alias sets and goes past a threshold of 1.
+
+; NOSAT-LABEL: Alias sets for function 'unknownmay'
+; NOSAT: may alias, Mod/Ref Pointers: (i32* %a, 4), (i32* %a0, 4)
+; NOSAT: must alias, Mod Pointers: (i32* %b, 4)
+; SAT-LABEL: Alias sets for function 'unknownmay'
+; SAT: may alias, alias any, Mod/Ref Pointers: (i32* %a, 4), (i32* %a0, 4), (i32* %b, 4)
+declare void @f(i32*)
+
+define void @unknownmay() {
+  %a = alloca i32
+  %b = alloca i32
+  store i32 1, i32* %a
+  %a0 = getelementptr i32, i32* %a, i32 0
+  store i32 2, i32* %a0
+  call void @f(i32* %a)
+  store i32 3, i32* %b
+  ret void
+}
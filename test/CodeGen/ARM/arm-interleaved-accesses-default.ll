@@ -0,0 +1,28 @@
+; RUN: llc -mtriple=arm-eabi -mattr=+neon < %s | FileCheck %s
+
+; The InterleavedAccess pass runs by default. Shuffles of a plain load that
+; take every other lane are lowered to a vld2 instead of the by-element moves
+; (see test_largespan in vext.ll) or the vpaddl.s8 + vmovn.i16 (see
+; addCombineToVPADDL in vpadd.ll) that they produce otherwise.
+
+; CHECK-LABEL: even_lanes_i16:
+; CHECK: vld2.16
+; CHECK-NOT: vmov.16
+define <4 x i16> @even_lanes_i16(<8 x i16>* %B) nounwind {
+  %tmp1 = load <8 x i16>, <8 x i16>* %B
+  %tmp2 = shufflevector <8 x i16> %tmp1, <8 x i16> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
+  ret <4 x i16> %tmp2
+}
+
+; CHECK-LABEL: add_even_odd_lanes_i8:
+; CHECK: vld2.8
+; CHECK-NEXT: vadd.i8
+; CHECK-NOT: vpaddl
+define void @add_even_odd_lanes_i8(<16 x i8>* %A, <8 x i8>* %X) nounwind {
+  %tmp = load <16 x i8>, <16 x i8>* %A
+  %tmp1 = shufflevector <16 x i8> %tmp, <16 x i8> undef, <8 x i32> <i32 0, i32 2, i32 4, i32 6, i32 8, i32 10, i32 12, i32 14>
+  %tmp3 = shufflevector <16 x i8> %tmp, <16 x i8> undef, <8 x i32> <i32 1, i32 3, i32 5, i32 7, i32 9, i32 11, i32 13, i32 15>
+  %add = add <8 x i8> %tmp3, %tmp1
+  store <8 x i8> %add, <8 x i8>* %X, align 8
+  ret void
+}
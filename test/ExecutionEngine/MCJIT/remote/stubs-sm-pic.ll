@@ -1,6 +1,5 @@
 ; RUN: %lli -remote-mcjit -disable-lazy-compilation=false -relocation-model=pic -code-model=small %s
-; XFAIL: *
-; This function should fail until remote symbol resolution is supported.
+; XFAIL: mips-, mipsel-, aarch64, arm, i686, i386
 
 define i32 @main() nounwind {
 entry:
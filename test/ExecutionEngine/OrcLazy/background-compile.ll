@@ -0,0 +1,37 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-background-compile %s
+;
+; Compiling main queues @sum and @square for compilation on the background
+; thread; calls may arrive before or after the worker has patched their stubs.
+
+define internal i32 @square(i32 %x) {
+entry:
+  %mul = mul nsw i32 %x, %x
+  ret i32 %mul
+}
+
+define i32 @sum(i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %add, %loop ]
+  %sq = call i32 @square(i32 %i)
+  %add = add nsw i32 %acc, %sq
+  %inc = add nsw i32 %i, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %add
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  %s = call i32 @sum(i32 10)
+  %sq = call i32 @square(i32 3)
+  %t = add nsw i32 %s, %sq
+  %ok = icmp eq i32 %t, 294
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,25 @@
+; RUN: llvm-as %s -o %t.bc
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-debug=funcs-to-stdout %t.bc | FileCheck %s
+;
+; Function bodies are read from lazily loaded bitcode as they are compiled, and
+; functions that are never called are never compiled.
+;
+; CHECK: [ main ]
+; CHECK-NEXT: [ used ]
+; CHECK-NOT: [ unused ]
+
+define i32 @used() {
+entry:
+  ret i32 0
+}
+
+define i32 @unused() {
+entry:
+  ret i32 1
+}
+
+define i32 @main(i32 %argc, i8** %argv) {
+entry:
+  %r = call i32 @used()
+  ret i32 %r
+}
@@ -0,0 +1,17 @@
+; RUN: rm -rf %t.cache
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-object-cache-dir=%t.cache -debug-only=object-cache %s 2>&1 | FileCheck %s -check-prefix=COLD
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-object-cache-dir=%t.cache -debug-only=object-cache %s 2>&1 | FileCheck %s -check-prefix=WARM
+; REQUIRES: asserts
+;
+; The partition holding @main is compiled on the first run and loaded from the
+; cache on the second.
+;
+; COLD: Object cache miss for '{{.*}}.main'
+; COLD: Cached object for '{{.*}}.main'
+; WARM: Object cache hit for '{{.*}}.main'
+; WARM-NOT: Cached object for '{{.*}}.main'
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  ret i32 0
+}
@@ -0,0 +1,27 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-tier-up-threshold=2 -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s
+;
+; @square is first compiled as a baseline tier, then recompiled once as a hot
+; tier on its second call.
+;
+; CHECK: [ {{.*}}main ]
+; CHECK: [ {{.*}}square ]
+; CHECK: [ {{.*}}square ]
+; CHECK-NOT: square
+
+define i32 @square(i32 %x) {
+entry:
+  %mul = mul nsw i32 %x, %x
+  ret i32 %mul
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  %a = call i32 @square(i32 2)
+  %b = call i32 @square(i32 3)
+  %c = call i32 @square(i32 4)
+  %ab = add nsw i32 %a, %b
+  %abc = add nsw i32 %ab, %c
+  %ok = icmp eq i32 %abc, 29
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,49 @@
+; RUN: %lli -force-interpreter=true %s
+
+; The intrinsic calls in @f are lowered into new instructions the first time
+; they execute, which happens in the innermost recursive frame while the
+; outer frames of @f are still live.  The outer frames then run the new
+; instructions as well, which were not numbered when those frames were
+; created.  (The load keeps the outer frames from resuming at a call that is
+; erased by the lowering.)
+
+@table = global [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+
+declare i32 @llvm.ctpop.i32(i32)
+declare i32 @llvm.bswap.i32(i32)
+declare i32 @llvm.ctlz.i32(i32, i1)
+
+; f(n) = sum over k in [1, n] of ctpop(k) + k + table[2] + ctlz(k)
+define i32 @f(i32 %n) {
+entry:
+  %done = icmp eq i32 %n, 0
+  br i1 %done, label %base, label %rec
+
+rec:
+  %m = sub i32 %n, 1
+  %r = call i32 @f(i32 %m)
+  %t = load i32, i32* getelementptr ([4 x i32], [4 x i32]* @table, i32 0, i32 2)
+  %p = call i32 @llvm.ctpop.i32(i32 %n)
+  %b = call i32 @llvm.bswap.i32(i32 %n)
+  %bs = lshr i32 %b, 24
+  %z = call i32 @llvm.ctlz.i32(i32 %n, i1 false)
+  %s1 = add i32 %r, %p
+  %s2 = add i32 %s1, %bs
+  %s3 = add i32 %s2, %t
+  %s4 = add i32 %s3, %z
+  ret i32 %s4
+
+base:
+  ret i32 0
+}
+
+define i32 @main() {
+entry:
+  %first = call i32 @f(i32 20)
+  %second = call i32 @f(i32 20)
+  %ok1 = icmp eq i32 %first, 878
+  %ok2 = icmp eq i32 %second, 878
+  %ok = and i1 %ok1, %ok2
+  %ret = select i1 %ok, i32 0, i32 1
+  ret i32 %ret
+}
@@ -0,0 +1,60 @@
+; Globals created by the passes on other threads are linked back with their
+; initializers. Both switch tables below are private, so the second one is
+; renamed rather than merged with the first.
+; RUN: opt -S -passes='function(simplify-cfg)' -threads=2 %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: @switch.table = private unnamed_addr constant [4 x i32] [i32 5, i32 17, i32 23, i32 42]
+; CHECK: @[[TABLE_B:switch.table.[0-9]+]] = private unnamed_addr constant [4 x i32] [i32 9, i32 8, i32 70, i32 61]
+
+; CHECK-LABEL: define i32 @lookup_a(
+; CHECK: getelementptr inbounds [4 x i32], [4 x i32]* @switch.table,
+define i32 @lookup_a(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+  ]
+bb0:
+  br label %exit
+bb1:
+  br label %exit
+bb2:
+  br label %exit
+bb3:
+  br label %exit
+default:
+  br label %exit
+exit:
+  %r = phi i32 [ 5, %bb0 ], [ 17, %bb1 ], [ 23, %bb2 ], [ 42, %bb3 ], [ 0, %default ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @lookup_b(
+; CHECK: getelementptr inbounds [4 x i32], [4 x i32]* @[[TABLE_B]],
+define i32 @lookup_b(i32 %x) {
+entry:
+  switch i32 %x, label %default [
+    i32 0, label %bb0
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+  ]
+bb0:
+  br label %exit
+bb1:
+  br label %exit
+bb2:
+  br label %exit
+bb3:
+  br label %exit
+default:
+  br label %exit
+exit:
+  %r = phi i32 [ 9, %bb0 ], [ 8, %bb1 ], [ 70, %bb2 ], [ 61, %bb3 ], [ 1, %default ]
+  ret i32 %r
+}
@@ -0,0 +1,84 @@
+; Optimized functions linked back from several threads keep the module's
+; struct types and metadata, and what the passes declare comes out in the
+; order it would have on one thread.
+; RUN: opt -S -passes='function(instcombine)' -threads=1 %s > %t.serial
+; RUN: opt -S -passes='function(instcombine)' -threads=4 %s > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: %struct.point = type { i32, i32 }
+; CHECK-NOT: %struct.point.
+%struct.point = type { i32, i32 }
+
+@hello = private unnamed_addr constant [7 x i8] c"hello\0A\00"
+@world = private unnamed_addr constant [7 x i8] c"world\0A\00"
+
+declare i32 @printf(i8*, ...)
+
+; CHECK-LABEL: define void @callee(
+define void @callee() {
+  ret void
+}
+
+; CHECK-LABEL: define void @say_hello(
+; CHECK: call i32 @puts(
+define void @say_hello() {
+  %f = getelementptr [7 x i8], [7 x i8]* @hello, i64 0, i64 0
+  %r = call i32 (i8*, ...) @printf(i8* %f)
+  ret void
+}
+
+; CHECK-LABEL: define i32 @sum(
+; CHECK: load i32, i32* %{{.*}}, align 4, !alias.scope [[SCOPE:![0-9]+]]
+define i32 @sum(%struct.point* %p) {
+  %x = getelementptr %struct.point, %struct.point* %p, i64 0, i32 0
+  %y = getelementptr %struct.point, %struct.point* %p, i64 0, i32 1
+  %a = load i32, i32* %x, align 4, !alias.scope !1
+  %b = load i32, i32* %y, align 4, !noalias !1
+  %s = add i32 %a, %b
+  ret i32 %s
+}
+
+; CHECK-LABEL: define void @say_char(
+; CHECK: call i32 @putchar(
+define void @say_char() {
+  %f = getelementptr [7 x i8], [7 x i8]* @world, i64 0, i64 5
+  %r = call i32 (i8*, ...) @printf(i8* %f)
+  ret void
+}
+
+; CHECK-LABEL: define i32 @swap(
+; CHECK: load i32, i32* %{{.*}}, align 4, !alias.scope [[SCOPE]]
+define i32 @swap(%struct.point* %p) {
+  %x = getelementptr %struct.point, %struct.point* %p, i64 0, i32 0
+  %y = getelementptr %struct.point, %struct.point* %p, i64 0, i32 1
+  %a = load i32, i32* %x, align 4, !alias.scope !1
+  %b = load i32, i32* %y, align 4, !noalias !1
+  store i32 %b, i32* %x, align 4
+  store i32 %a, i32* %y, align 4
+  %s = mul i32 %a, 1
+  ret i32 %s
+}
+
+; @callee is optimized on another thread, but is still a definition to the
+; passes here, so the call is rewritten the same way.
+; CHECK-LABEL: define void @call_cast(
+; CHECK: call void @callee()
+define void @call_cast() {
+  call void bitcast (void ()* @callee to void (i32)*)(i32 5)
+  ret void
+}
+
+; CHECK: declare i32 @puts(i8*
+; CHECK: declare i32 @putchar(i32)
+; CHECK: [[SCOPE]] = !{[[SCOPE_NODE:![0-9]+]]}
+; CHECK: [[SCOPE_NODE]] = distinct !{[[SCOPE_NODE]], [[DOMAIN:![0-9]+]]}
+; CHECK: [[DOMAIN]] = distinct !{[[DOMAIN]]}
+; CHECK-NOT: distinct
+
+!0 = distinct !{!0}
+!1 = !{!2}
+!2 = distinct !{!2, !0}
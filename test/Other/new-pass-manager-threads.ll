@@ -0,0 +1,65 @@
+; Optimizing functions on several threads must produce the same module as
+; optimizing them on one.
+; RUN: opt -S -passes='function(instcombine,simplify-cfg)' %s > %t.serial
+; RUN: opt -S -passes='function(instcombine,simplify-cfg)' -threads=3 %s \
+; RUN:     > %t.parallel
+; RUN: diff %t.serial %t.parallel
+; RUN: FileCheck %s < %t.parallel
+
+; RUN: not opt -disable-output -passes=no-op-module -threads=2 %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-NOT-FUNCTION
+; CHECK-NOT-FUNCTION: -threads requires a 'function(...)' pass pipeline
+
+; RUN: not opt -disable-output -instcombine -threads=2 %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-LEGACY
+; CHECK-LEGACY: -threads requires a -passes pipeline
+
+@counter = internal global i32 0
+@.str = private unnamed_addr constant [6 x i8] c"hello\00"
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32 ()* @bump to i8*)], section "llvm.metadata"
+
+declare i32 @puts(i8*)
+
+; CHECK-LABEL: define internal i32 @bump(
+; CHECK: add i32 %{{.*}}, 2
+define internal i32 @bump() {
+  %v = load i32, i32* @counter
+  %a = add i32 %v, 1
+  %b = add i32 %a, 1
+  store i32 %b, i32* @counter
+  ret i32 %b
+}
+
+; CHECK-LABEL: define i32 @greet(
+; CHECK: call i32 @puts(
+define i32 @greet() {
+  %p = getelementptr [6 x i8], [6 x i8]* @.str, i64 0, i64 0
+  %r = call i32 @puts(i8* %p)
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @select(
+; CHECK-NOT: br
+; CHECK: ret i32
+define i32 @select(i1 %c, i32 %x) {
+entry:
+  br i1 %c, label %then, label %join
+
+then:
+  %y = mul i32 %x, 1
+  br label %join
+
+join:
+  %r = phi i32 [ %y, %then ], [ 0, %entry ]
+  ret i32 %r
+}
+
+; CHECK-LABEL: define i32 @caller(
+; CHECK: call i32 @bump()
+; CHECK: call i32 @greet()
+define i32 @caller() {
+  %a = call i32 @bump()
+  %b = call i32 @greet()
+  %s = add i32 %a, %b
+  ret i32 %s
+}
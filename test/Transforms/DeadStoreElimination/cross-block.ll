@@ -0,0 +1,180 @@
+; RUN: opt < %s -basicaa -dse -S | FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+%struct.S = type { i32, i32 }
+
+declare void @use(%struct.S*)
+declare noalias i8* @malloc(i64)
+declare void @g()
+
+; The store in %entry falls through into a block that overwrites it.
+; CHECK-LABEL: @overwritten_in_successor(
+; CHECK: entry:
+; CHECK-NOT: store
+; CHECK: next:
+; CHECK-NEXT: store i32 1, i32* %p
+define void @overwritten_in_successor(i32* %p) {
+entry:
+  store i32 0, i32* %p
+  br label %next
+
+next:
+  store i32 1, i32* %p
+  ret void
+}
+
+; Both arms of the diamond fall through into the overwriting store.
+; CHECK-LABEL: @overwritten_after_diamond(
+; CHECK: then:
+; CHECK-NOT: store
+; CHECK: else:
+; CHECK-NOT: store
+; CHECK: join:
+; CHECK-NEXT: store i32 3, i32* %p
+define void @overwritten_after_diamond(i32* %p, i1 %c) {
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  store i32 1, i32* %p
+  br label %join
+
+else:
+  store i32 2, i32* %p
+  br label %join
+
+join:
+  store i32 3, i32* %p
+  ret void
+}
+
+; Zero-initialization of a struct followed by field stores in the next block.
+; CHECK-LABEL: @struct_init(
+; CHECK: entry:
+; CHECK-NOT: store
+; CHECK: init:
+; CHECK-NEXT: store i32 1, i32* %a
+; CHECK-NEXT: store i32 2, i32* %b
+define void @struct_init(%struct.S* %s) {
+entry:
+  %a = getelementptr inbounds %struct.S, %struct.S* %s, i64 0, i32 0
+  %b = getelementptr inbounds %struct.S, %struct.S* %s, i64 0, i32 1
+  store i32 0, i32* %a
+  store i32 0, i32* %b
+  br label %init
+
+init:
+  store i32 1, i32* %a
+  store i32 2, i32* %b
+  ret void
+}
+
+; The store is only overwritten on one path; it must stay.
+; CHECK-LABEL: @partially_overwritten(
+; CHECK: entry:
+; CHECK-NEXT: store i32 0, i32* %p
+define void @partially_overwritten(i32* %p, i1 %c) {
+entry:
+  store i32 0, i32* %p
+  br i1 %c, label %then, label %exit
+
+then:
+  store i32 1, i32* %p
+  br label %exit
+
+exit:
+  ret void
+}
+
+; A read in between keeps the store alive.
+; CHECK-LABEL: @read_in_between(
+; CHECK: entry:
+; CHECK-NEXT: store i32 0, i32* %p
+define i32 @read_in_between(i32* %p) {
+entry:
+  store i32 0, i32* %p
+  br label %next
+
+next:
+  %v = load i32, i32* %p
+  store i32 1, i32* %p
+  ret i32 %v
+}
+
+; A store to a local that is never read again on the way to the return is
+; dead even when it is not in the returning block.
+; CHECK-LABEL: @dead_local(
+; CHECK: entry:
+; CHECK-NOT: store
+; CHECK: ret void
+define void @dead_local(i32 %x) {
+entry:
+  %local = alloca i32
+  store i32 %x, i32* %local
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The local is read by @use on the way out.
+; CHECK-LABEL: @live_local(
+; CHECK: store i32 0, i32* %a
+define void @live_local() {
+entry:
+  %s = alloca %struct.S
+  %a = getelementptr inbounds %struct.S, %struct.S* %s, i64 0, i32 0
+  store i32 0, i32* %a
+  br label %exit
+
+exit:
+  call void @use(%struct.S* %s)
+  ret void
+}
+
+; Stores reached around a backedge are left alone.
+; CHECK-LABEL: @loop(
+; CHECK: latch:
+; CHECK-NEXT: store i32 2, i32* %p
+define void @loop(i32* %p, i32 %n) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  store i32 1, i32* %p
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %latch, label %exit
+
+latch:
+  store i32 2, i32* %p
+  br label %header
+
+exit:
+  ret void
+}
+
+; Removing the only store to %m in one branch deletes the malloc as well. The
+; other branch, scanned afterwards, must not look at the deleted malloc.
+; CHECK-LABEL: @malloc_deleted_on_one_path(
+; CHECK-NOT: malloc
+; CHECK: call void @g()
+; CHECK-NOT: store
+; CHECK: ret void
+define void @malloc_deleted_on_one_path(i1 %c) {
+entry:
+  %m = call i8* @malloc(i64 4)
+  br i1 %c, label %a, label %b
+
+a:
+  store i8 1, i8* %m
+  br label %end
+
+b:
+  call void @g()
+  br label %end
+
+end:
+  ret void
+}
@@ -0,0 +1,63 @@
+; RUN: opt -S -functionattrs %s | FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@g = global [16 x i8] zeroinitializer
+@w = extern_weak global [16 x i8]
+
+declare dereferenceable(8) i8* @ret_deref8()
+
+; CHECK: define dereferenceable(16) i8* @global()
+define i8* @global() {
+  ret i8* getelementptr inbounds ([16 x i8], [16 x i8]* @g, i64 0, i64 0)
+}
+
+; A weak external global may be null.
+; CHECK: define i8* @weak_global()
+define i8* @weak_global() {
+  ret i8* getelementptr inbounds ([16 x i8], [16 x i8]* @w, i64 0, i64 0)
+}
+
+; CHECK: define nonnull dereferenceable(4) i8* @arg_offset(
+define i8* @arg_offset(i8* dereferenceable(12) %p) {
+  %q = getelementptr inbounds i8, i8* %p, i64 8
+  ret i8* %q
+}
+
+; The smallest object returned wins.
+; CHECK: define dereferenceable(8) i32* @select(
+define i32* @select(i1 %c, i8* dereferenceable(32) %p) {
+  %call = call i8* @ret_deref8()
+  %s = select i1 %c, i8* %p, i8* %call
+  %b = bitcast i8* %s to i32*
+  ret i32* %b
+}
+
+; Stepping past the end of the object gives nothing.
+; CHECK: define nonnull i8* @past_end(
+define i8* @past_end(i8* dereferenceable(4) %p) {
+  %q = getelementptr inbounds i8, i8* %p, i64 4
+  ret i8* %q
+}
+
+; The pointer is advanced in the loop, so its offset is unknown.
+; CHECK: define nonnull i8* @loop(
+define i8* @loop(i8* dereferenceable(64) %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %q = phi i8* [ %p, %entry ], [ %q.next, %loop ]
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %q.next = getelementptr inbounds i8, i8* %q, i64 1
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i8* %q
+}
+
+; CHECK: define i8* @unknown(
+define i8* @unknown(i8* %p) {
+  ret i8* %p
+}
@@ -0,0 +1,86 @@
+; RUN: opt -S -functionattrs %s | FileCheck %s
+
+declare void @may_throw()
+declare void @no_throw() nounwind
+declare i32 @__gxx_personality_v0(...)
+
+; CHECK: define i32 @leaf(i32 %x) [[READNONE:#[0-9]+]]
+define i32 @leaf(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
+
+; CHECK: define void @calls_nounwind() [[NOUNWIND:#[0-9]+]]
+define void @calls_nounwind() {
+  call void @no_throw()
+  ret void
+}
+
+; CHECK: define void @calls_may_throw() {
+define void @calls_may_throw() {
+  call void @may_throw()
+  ret void
+}
+
+; The exception is caught and not resumed.
+; CHECK: define void @catches() [[NOUNWIND]] personality
+define void @catches() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @may_throw()
+          to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 }
+          catch i8* null
+  ret void
+}
+
+; CHECK: define void @rethrows() personality
+define void @rethrows() personality i32 (...)* @__gxx_personality_v0 {
+entry:
+  invoke void @may_throw()
+          to label %cont unwind label %lpad
+cont:
+  ret void
+lpad:
+  %lp = landingpad { i8*, i32 }
+          cleanup
+  resume { i8*, i32 } %lp
+}
+
+; Calls within the SCC do not prevent the inference.
+; CHECK: define void @mutual_a(i32 %n) [[NOUNWIND]]
+define void @mutual_a(i32 %n) {
+  %c = icmp eq i32 %n, 0
+  br i1 %c, label %done, label %rec
+rec:
+  %m = sub i32 %n, 1
+  call void @mutual_b(i32 %m)
+  br label %done
+done:
+  call void @no_throw()
+  ret void
+}
+
+; CHECK: define void @mutual_b(i32 %n) [[NOUNWIND]]
+define void @mutual_b(i32 %n) {
+  call void @mutual_a(i32 %n)
+  ret void
+}
+
+; A definition that may be replaced at link time may unwind.
+; CHECK: define weak void @weak() {
+define weak void @weak() {
+  ret void
+}
+
+; Indirect calls may unwind.
+; CHECK: define void @indirect(void ()* nocapture %f) {
+define void @indirect(void ()* %f) {
+  call void %f()
+  ret void
+}
+
+; CHECK-DAG: attributes [[READNONE]] = { nounwind readnone }
+; CHECK-DAG: attributes [[NOUNWIND]] = { nounwind }
@@ -0,0 +1,118 @@
+; RUN: opt < %s -basicaa -gvn -enable-load-pre -S | FileCheck %s
+; RUN: opt < %s -basicaa -gvn -enable-load-pre -max-load-pre-preds=1 -S | FileCheck %s -check-prefix=ONEPRED
+
+; The value of *%p is available on the hot path into %merge, so the load is
+; PRE'd by inserting copies into both cold predecessors.
+; CHECK-LABEL: @hot_available(
+; CHECK: b:
+; CHECK-NEXT: %v.pre{{[0-9]*}} = load i32, i32* %p
+; CHECK: c:
+; CHECK-NEXT: %v.pre{{[0-9]*}} = load i32, i32* %p
+; CHECK: merge:
+; CHECK-NEXT: %v = phi i32
+; CHECK-NOT: load
+; CHECK: ret i32 %v
+
+; ONEPRED-LABEL: @hot_available(
+; ONEPRED: merge:
+; ONEPRED-NEXT: %v = load i32, i32* %p
+define i32 @hot_available(i32* %p, i32 %x) {
+entry:
+  switch i32 %x, label %a [
+    i32 1, label %b
+    i32 2, label %c
+  ], !prof !0
+
+a:
+  %v1 = load i32, i32* %p
+  call void @use(i32 %v1)
+  br label %merge
+
+b:
+  br label %merge
+
+c:
+  br label %merge
+
+merge:
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; Here most executions reach %merge without the value available; inserting
+; two loads would grow the code for little gain.
+; CHECK-LABEL: @cold_available(
+; CHECK: merge:
+; CHECK-NEXT: %v = load i32, i32* %p
+define i32 @cold_available(i32* %p, i32 %x) {
+entry:
+  switch i32 %x, label %a [
+    i32 1, label %b
+    i32 2, label %c
+  ], !prof !1
+
+a:
+  %v1 = load i32, i32* %p
+  call void @use(i32 %v1)
+  br label %merge
+
+b:
+  br label %merge
+
+c:
+  br label %merge
+
+merge:
+  %v = load i32, i32* %p
+  ret i32 %v
+}
+
+; The load of %p is PRE'd first, which splits the critical edges from %b and
+; %c. The load of %q that follows must be judged with frequencies for the new
+; blocks, so it is PRE'd into them as well.
+; CHECK-LABEL: @split_edges(
+; CHECK: b.merge_crit_edge:
+; CHECK-NEXT: %v.pre{{[0-9]*}} = load i32, i32* %p
+; CHECK-NEXT: %w.pre{{[0-9]*}} = load i32, i32* %q
+; CHECK: c.merge_crit_edge:
+; CHECK-NEXT: %v.pre{{[0-9]*}} = load i32, i32* %p
+; CHECK-NEXT: %w.pre{{[0-9]*}} = load i32, i32* %q
+; CHECK: merge:
+; CHECK-NEXT: %w = phi i32
+; CHECK-NEXT: %v = phi i32
+; CHECK-NOT: load
+; CHECK: ret i32 %s
+define i32 @split_edges(i32* %p, i32* %q, i32 %x, i1 %y, i1 %z) {
+entry:
+  switch i32 %x, label %a [
+    i32 1, label %b
+    i32 2, label %c
+  ], !prof !0
+
+a:
+  %v1 = load i32, i32* %p
+  %w1 = load i32, i32* %q
+  call void @use(i32 %v1)
+  call void @use(i32 %w1)
+  br label %merge
+
+b:
+  br i1 %y, label %merge, label %exit
+
+c:
+  br i1 %z, label %merge, label %exit
+
+merge:
+  %v = load i32, i32* %p
+  %w = load i32, i32* %q
+  %s = add i32 %v, %w
+  ret i32 %s
+
+exit:
+  ret i32 0
+}
+
+declare void @use(i32) readnone
+
+!0 = !{!"branch_weights", i32 100, i32 1, i32 1}
+!1 = !{!"branch_weights", i32 1, i32 100, i32 100}
@@ -0,0 +1,21 @@
+; RUN: opt < %s -globaldce -S | FileCheck %s
+
+; Globals referenced only from the prefix or prologue data of a live function
+; must be kept alive, while those of a dead function can be removed.
+
+; CHECK: @prefix_used = internal global i32 1
+@prefix_used = internal global i32 1
+; CHECK: @prologue_used = internal global i32 2
+@prologue_used = internal global i32 2
+; CHECK-NOT: @dead_prefix_used
+@dead_prefix_used = internal global i32 3
+
+; CHECK: define void @f() prefix i32* @prefix_used prologue i32* @prologue_used
+define void @f() prefix i32* @prefix_used prologue i32* @prologue_used {
+  ret void
+}
+
+; CHECK-NOT: @dead
+define internal void @dead() prefix i32* @dead_prefix_used {
+  ret void
+}
@@ -0,0 +1,41 @@
+; RUN: opt < %s -basicaa -licm -S | FileCheck %s
+; RUN: opt < %s -basicaa -licm -alias-set-saturation-threshold=1 -S | FileCheck %s --check-prefix=SAT
+
+; The accumulator in %sum is promoted as long as the alias set tracker can
+; tell it apart from the may-aliasing stores to %a and %b. Once the tracker
+; saturates, it conservatively treats every pointer as aliasing, and nothing
+; is promoted, but the loop is still handled correctly.
+
+; CHECK-LABEL: @accumulate(
+; CHECK: entry:
+; CHECK-NEXT: %sum.promoted = load i32, i32* %sum
+; CHECK: exit:
+; CHECK: store i32 %{{.*}}, i32* %sum
+
+; SAT-LABEL: @accumulate(
+; SAT: loop:
+; SAT: load i32, i32* %sum
+; SAT: store i32 %{{.*}}, i32* %sum
+; SAT: exit:
+; SAT-NEXT: ret void
+
+define void @accumulate(i32* %a, i32* %b, i32* noalias %sum, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %pa = getelementptr inbounds i32, i32* %a, i32 %i
+  store i32 %i, i32* %pa
+  %pb = getelementptr inbounds i32, i32* %b, i32 %i
+  store i32 0, i32* %pb
+  %s = load i32, i32* %sum
+  %s.next = add i32 %s, %i
+  store i32 %s.next, i32* %sum
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,262 @@
+; RUN: opt < %s -basicaa -loop-fusion -verify-dom-info -verify-loop-info -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; void fuse(int *A, int *B, int *C) {
+;   for (long i = 0; i < 1024; i++)
+;     B[i] = A[i] + 1;
+;   for (long i = 0; i < 1024; i++)
+;     C[i] = B[i] * 2;
+; }
+
+; CHECK-LABEL: @fuse(
+; CHECK: for.body:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+; CHECK-NEXT: %j = phi i64 [ 0, %entry ], [ %j.next, %for.body ]
+; CHECK: store i32 %add, i32* %arrayidx.B
+; CHECK: %ld.B = load i32, i32* %arrayidx.B2
+; CHECK: store i32 %mul, i32* %arrayidx.C
+; CHECK: br i1 %cmp2, label %for.body, label %for.end2
+; CHECK-NOT: for.body2:
+
+define void @fuse(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  %ld.A = load i32, i32* %arrayidx.A, align 4
+  %add = add nsw i32 %ld.A, 1
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  store i32 %add, i32* %arrayidx.B, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 0, %for.end ], [ %j.next, %for.body2 ]
+  %arrayidx.B2 = getelementptr inbounds i32, i32* %B, i64 %j
+  %ld.B = load i32, i32* %arrayidx.B2, align 4
+  %mul = shl nsw i32 %ld.B, 1
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %j
+  store i32 %mul, i32* %arrayidx.C, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp2 = icmp slt i64 %j.next, 1024
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  ret void
+}
+
+; The second loop reads B[i + 1], which the first loop only writes in the
+; next iteration, so the loops must stay separate.
+
+; CHECK-LABEL: @backward_dep(
+; CHECK: for.body:
+; CHECK: br i1 %cmp, label %for.body, label %for.end
+; CHECK: for.body2:
+; CHECK: br i1 %cmp2, label %for.body2, label %for.end2
+
+define void @backward_dep(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  %ld.A = load i32, i32* %arrayidx.A, align 4
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  store i32 %ld.A, i32* %arrayidx.B, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 0, %for.end ], [ %j.next, %for.body2 ]
+  %j.next = add nuw nsw i64 %j, 1
+  %arrayidx.B2 = getelementptr inbounds i32, i32* %B, i64 %j.next
+  %ld.B = load i32, i32* %arrayidx.B2, align 4
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %j
+  store i32 %ld.B, i32* %arrayidx.C, align 4
+  %cmp2 = icmp slt i64 %j.next, 1024
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  ret void
+}
+
+; Reading B[i - 1] in the second loop is fine: the first loop has already
+; written it in the previous iteration.
+
+; CHECK-LABEL: @forward_dep(
+; CHECK: for.body:
+; CHECK: br i1 %cmp2, label %for.body, label %for.end2
+; CHECK-NOT: for.body2:
+
+define void @forward_dep(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  %ld.A = load i32, i32* %arrayidx.A, align 4
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  store i32 %ld.A, i32* %arrayidx.B, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 1, %for.end ], [ %j.next, %for.body2 ]
+  %j.prev = add nsw i64 %j, -1
+  %arrayidx.B2 = getelementptr inbounds i32, i32* %B, i64 %j.prev
+  %ld.B = load i32, i32* %arrayidx.B2, align 4
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %j
+  store i32 %ld.B, i32* %arrayidx.C, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp2 = icmp slt i64 %j.next, 1024
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  ret void
+}
+
+; Different trip counts.
+
+; CHECK-LABEL: @trip_count_mismatch(
+; CHECK: for.body:
+; CHECK: br i1 %cmp, label %for.body, label %for.end
+; CHECK: for.body2:
+
+define void @trip_count_mismatch(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 0, i32* %arrayidx.A, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 0, %for.end ], [ %j.next, %for.body2 ]
+  %arrayidx.A2 = getelementptr inbounds i32, i32* %A, i64 %j
+  %ld = load i32, i32* %arrayidx.A2, align 4
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 %ld, i32* %arrayidx.B, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp2 = icmp slt i64 %j.next, 512
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  ret void
+}
+
+; The loops touch unrelated memory, so fusing them saves no traffic.
+
+; CHECK-LABEL: @no_reuse(
+; CHECK: for.body:
+; CHECK: br i1 %cmp, label %for.body, label %for.end
+; CHECK: for.body2:
+
+define void @no_reuse(i32* noalias %A, i32* noalias %B) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  store i32 0, i32* %arrayidx.A, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 0, %for.end ], [ %j.next, %for.body2 ]
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %j
+  store i32 1, i32* %arrayidx.B, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp2 = icmp slt i64 %j.next, 1024
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  ret void
+}
+
+; Three loops in a row are fused one after the other. The second fusion is
+; checked against the dominator tree updated by the first one.
+
+; CHECK-LABEL: @fuse_three(
+; CHECK: for.body:
+; CHECK-NEXT: %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+; CHECK-NEXT: %j = phi i64 [ 0, %entry ], [ %j.next, %for.body ]
+; CHECK-NEXT: %k = phi i64 [ 0, %entry ], [ %k.next, %for.body ]
+; CHECK: br i1 %cmp3, label %for.body, label %for.end3
+; CHECK-NOT: for.body2:
+; CHECK-NOT: for.body3:
+
+define void @fuse_three(i32* noalias %A, i32* noalias %B, i32* noalias %C) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %arrayidx.A = getelementptr inbounds i32, i32* %A, i64 %i
+  %ld.A = load i32, i32* %arrayidx.A, align 4
+  %add = add nsw i32 %ld.A, 1
+  %arrayidx.B = getelementptr inbounds i32, i32* %B, i64 %i
+  store i32 %add, i32* %arrayidx.B, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp = icmp slt i64 %i.next, 1024
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  br label %for.body2
+
+for.body2:
+  %j = phi i64 [ 0, %for.end ], [ %j.next, %for.body2 ]
+  %arrayidx.B2 = getelementptr inbounds i32, i32* %B, i64 %j
+  %ld.B = load i32, i32* %arrayidx.B2, align 4
+  %mul = shl nsw i32 %ld.B, 1
+  %arrayidx.C = getelementptr inbounds i32, i32* %C, i64 %j
+  store i32 %mul, i32* %arrayidx.C, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp2 = icmp slt i64 %j.next, 1024
+  br i1 %cmp2, label %for.body2, label %for.end2
+
+for.end2:
+  br label %for.body3
+
+for.body3:
+  %k = phi i64 [ 0, %for.end2 ], [ %k.next, %for.body3 ]
+  %arrayidx.C3 = getelementptr inbounds i32, i32* %C, i64 %k
+  %ld.C = load i32, i32* %arrayidx.C3, align 4
+  %sub = sub nsw i32 %ld.C, 3
+  %arrayidx.A3 = getelementptr inbounds i32, i32* %A, i64 %k
+  store i32 %sub, i32* %arrayidx.A3, align 4
+  %k.next = add nuw nsw i64 %k, 1
+  %cmp3 = icmp slt i64 %k.next, 1024
+  br i1 %cmp3, label %for.body3, label %for.end3
+
+for.end3:
+  ret void
+}
@@ -0,0 +1,215 @@
+; RUN: opt < %s -basicaa -loop-tiling -loop-tiling-cache-size=32768 -verify-dom-info -verify-loop-info -S | FileCheck %s
+; RUN: opt < %s -basicaa -loop-tiling -loop-tile-size=64 -S | FileCheck %s --check-prefix=FORCED
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+@A = common global [2048 x [2048 x float]] zeroinitializer, align 16
+@X = common global [2048 x float] zeroinitializer, align 16
+
+; X is reused by every row of A, but a whole row does not fit in the cache,
+; so the j loop is tiled. Each iteration accesses 12 bytes, which gives tiles
+; of 1024 iterations for a 32KB cache.
+;
+; for (i = 0; i < 2048; i++)
+;   for (j = 0; j < 2048; j++)
+;     A[i][j] += X[j];
+
+; CHECK-LABEL: @reuse(
+; CHECK: tile.header:
+; CHECK-NEXT: %tile.iv = phi i64 [ 0, %entry ], [ %tile.next, %tile.latch ]
+; CHECK-NEXT: %tile.next = add nsw i64 %tile.iv, 1024
+; CHECK: %tile.end = select i1 %{{.*}}, i64 %tile.next, i64 2048
+; CHECK-NEXT: br label %outer.header
+; CHECK: outer.header:
+; CHECK-NEXT: %i = phi i64 [ 0, %tile.header ], [ %i.next, %outer.latch ]
+; CHECK: inner.body:
+; CHECK-NEXT: %j = phi i64 [ %tile.iv, %outer.header ], [ %j.next, %inner.body ]
+; CHECK: %cmp = icmp slt i64 %j.next, %tile.end
+; CHECK: outer.latch:
+; CHECK: br i1 %cmp2, label %outer.header, label %tile.latch
+; CHECK: tile.latch:
+; CHECK-NEXT: %tile.cmp = icmp slt i64 %tile.next, 2048
+; CHECK-NEXT: br i1 %tile.cmp, label %tile.header, label %exit
+
+; FORCED-LABEL: @reuse(
+; FORCED: %tile.next = add nsw i64 %tile.iv, 64
+
+define void @reuse() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner.body
+
+inner.body:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner.body ]
+  %px = getelementptr inbounds [2048 x float], [2048 x float]* @X, i64 0, i64 %j
+  %x = load float, float* %px, align 4
+  %pa = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %pa, align 4
+  %add = fadd float %a, %x
+  store float %add, float* %pa, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp = icmp slt i64 %j.next, 2048
+  br i1 %cmp, label %inner.body, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp2 = icmp slt i64 %i.next, 2048
+  br i1 %cmp2, label %outer.header, label %exit
+
+exit:
+  ret void
+}
+
+; A[i + 1][j - 1] depends on A[i][j] with direction (<, >); tiling would
+; reverse it.
+;
+; for (i = 0; i < 2047; i++)
+;   for (j = 1; j < 2048; j++)
+;     A[i + 1][j - 1] = A[i][j] + X[j];
+
+; CHECK-LABEL: @illegal(
+; CHECK-NOT: tile.header
+; FORCED-LABEL: @illegal(
+; FORCED-NOT: tile.header
+
+define void @illegal() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %i.next = add nuw nsw i64 %i, 1
+  br label %inner.body
+
+inner.body:
+  %j = phi i64 [ 1, %outer.header ], [ %j.next, %inner.body ]
+  %px = getelementptr inbounds [2048 x float], [2048 x float]* @X, i64 0, i64 %j
+  %x = load float, float* %px, align 4
+  %pa = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %pa, align 4
+  %add = fadd float %a, %x
+  %j.prev = add nsw i64 %j, -1
+  %pb = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i.next, i64 %j.prev
+  store float %add, float* %pb, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp = icmp slt i64 %j.next, 2048
+  br i1 %cmp, label %inner.body, label %outer.latch
+
+outer.latch:
+  %cmp2 = icmp slt i64 %i.next, 2047
+  br i1 %cmp2, label %outer.header, label %exit
+
+exit:
+  ret void
+}
+
+; Nothing in the inner loop is reused across the outer loop.
+;
+; for (i = 0; i < 2048; i++)
+;   for (j = 0; j < 2048; j++)
+;     A[i][j] = 0;
+
+; CHECK-LABEL: @no_reuse(
+; CHECK-NOT: tile.header
+; CHECK: ret void
+
+define void @no_reuse() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner.body
+
+inner.body:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner.body ]
+  %pa = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i, i64 %j
+  store float 0.0, float* %pa, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp = icmp slt i64 %j.next, 2048
+  br i1 %cmp, label %inner.body, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp2 = icmp slt i64 %i.next, 2048
+  br i1 %cmp2, label %outer.header, label %exit
+
+exit:
+  ret void
+}
+
+; Two nests in a row, the first with a PHI in its exit block. The PHI now
+; gets its value from the tile latch, and the second nest is tiled too.
+;
+; for (i = 0; i < 2048; i++)
+;   for (j = 0; j < 2048; j++)
+;     A[i][j] += X[j];
+; for (i = 0; i < 2048; i++)
+;   for (j = 0; j < 2048; j++)
+;     A[i][j] *= X[j];
+
+; CHECK-LABEL: @two_nests(
+; CHECK: tile.latch:
+; CHECK: br i1 %tile.cmp, label %tile.header, label %mid
+; CHECK: mid:
+; CHECK-NEXT: %r = phi i32 [ 7, %tile.latch ]
+; CHECK: tile.header{{[0-9]+}}:
+; CHECK: ret i32 %r
+; FORCED-LABEL: @two_nests(
+
+define i32 @two_nests() {
+entry:
+  br label %outer.header
+
+outer.header:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner.body
+
+inner.body:
+  %j = phi i64 [ 0, %outer.header ], [ %j.next, %inner.body ]
+  %px = getelementptr inbounds [2048 x float], [2048 x float]* @X, i64 0, i64 %j
+  %x = load float, float* %px, align 4
+  %pa = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i, i64 %j
+  %a = load float, float* %pa, align 4
+  %add = fadd float %a, %x
+  store float %add, float* %pa, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %cmp = icmp slt i64 %j.next, 2048
+  br i1 %cmp, label %inner.body, label %outer.latch
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %cmp2 = icmp slt i64 %i.next, 2048
+  br i1 %cmp2, label %outer.header, label %mid
+
+mid:
+  %r = phi i32 [ 7, %outer.latch ]
+  br label %outer2.header
+
+outer2.header:
+  %i2 = phi i64 [ 0, %mid ], [ %i2.next, %outer2.latch ]
+  br label %inner2.body
+
+inner2.body:
+  %j2 = phi i64 [ 0, %outer2.header ], [ %j2.next, %inner2.body ]
+  %px2 = getelementptr inbounds [2048 x float], [2048 x float]* @X, i64 0, i64 %j2
+  %x2 = load float, float* %px2, align 4
+  %pa2 = getelementptr inbounds [2048 x [2048 x float]], [2048 x [2048 x float]]* @A, i64 0, i64 %i2, i64 %j2
+  %a2 = load float, float* %pa2, align 4
+  %mul = fmul float %a2, %x2
+  store float %mul, float* %pa2, align 4
+  %j2.next = add nuw nsw i64 %j2, 1
+  %cmp3 = icmp slt i64 %j2.next, 2048
+  br i1 %cmp3, label %inner2.body, label %outer2.latch
+
+outer2.latch:
+  %i2.next = add nuw nsw i64 %i2, 1
+  %cmp4 = icmp slt i64 %i2.next, 2048
+  br i1 %cmp4, label %outer2.header, label %exit
+
+exit:
+  ret i32 %r
+}
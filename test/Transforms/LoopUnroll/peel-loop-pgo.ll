@@ -0,0 +1,142 @@
+; RUN: opt < %s -S -loop-unroll -verify-dom-info -verify-loop-info | FileCheck %s
+; RUN: opt < %s -S -loop-unroll -unroll-runtime -unroll-allow-peeling=false | FileCheck %s -check-prefix=RUNTIME
+
+; The latch is profiled to take the backedge twice per entry, so the first
+; three iterations are peeled off in front of the loop.
+; CHECK-LABEL: @peel(
+; CHECK: for.body.peel.begin:
+; CHECK: for.body.peel1:
+; CHECK: br i1 %{{.*}}, label %for.body.peel.next, label %for.end
+; CHECK: for.body.peel2:
+; CHECK: br i1 %{{.*}}, label %for.body.peel.next{{[0-9]*}}, label %for.end
+; CHECK: for.body.peel3:
+; CHECK: br i1 %{{.*}}, label %for.body.peel.next{{[0-9]*}}, label %for.end
+; CHECK: for.body:
+; CHECK: br i1 %{{.*}}, label %for.body, label %for.end{{.*}}, !prof ![[PROF:[0-9]+]], !llvm.loop ![[LOOP:[0-9]+]]
+
+; Without peeling, the runtime unroll count is capped at the profiled trip
+; count.
+; RUNTIME-LABEL: @peel(
+; RUNTIME: for.body.prol:
+; RUNTIME: for.body:
+; RUNTIME: store i32
+; RUNTIME: store i32
+; RUNTIME-NOT: store i32
+; RUNTIME: br i1
+
+define void @peel(i32* nocapture %p, i32 %n) {
+entry:
+  %cmp5 = icmp sgt i32 %n, 0
+  br i1 %cmp5, label %for.body, label %for.end
+
+for.body:
+  %i.06 = phi i32 [ %inc, %for.body ], [ 0, %entry ]
+  %idxprom = sext i32 %i.06 to i64
+  %arrayidx = getelementptr inbounds i32, i32* %p, i64 %idxprom
+  store i32 %i.06, i32* %arrayidx, align 4
+  %inc = add nsw i32 %i.06, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %for.body, label %for.end, !prof !0
+
+for.end:
+  ret void
+}
+
+; A loop with a long profiled trip count is left alone.
+; CHECK-LABEL: @long_trip(
+; CHECK-NOT: peel
+; CHECK: ret void
+define void @long_trip(i32* nocapture %p, i32 %n) {
+entry:
+  %cmp5 = icmp sgt i32 %n, 0
+  br i1 %cmp5, label %for.body, label %for.end
+
+for.body:
+  %i.06 = phi i32 [ %inc, %for.body ], [ 0, %entry ]
+  %idxprom = sext i32 %i.06 to i64
+  %arrayidx = getelementptr inbounds i32, i32* %p, i64 %idxprom
+  store i32 %i.06, i32* %arrayidx, align 4
+  %inc = add nsw i32 %i.06, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %for.body, label %for.end, !prof !1
+
+for.end:
+  ret void
+}
+
+; A function the profile says is never entered uses the optsize threshold, so
+; this loop is no longer fully unrolled.
+; CHECK-LABEL: @cold(
+; CHECK: for.body:
+; CHECK: br i1 %{{.*}}, label %for.body, label %for.end
+define void @cold(i32* nocapture %p) !prof !2 {
+entry:
+  br label %for.body
+
+for.body:
+  %i.06 = phi i32 [ %inc, %for.body ], [ 0, %entry ]
+  %idxprom = sext i32 %i.06 to i64
+  %arrayidx = getelementptr inbounds i32, i32* %p, i64 %idxprom
+  %v = load i32, i32* %arrayidx, align 4
+  %mul = mul nsw i32 %v, %i.06
+  %add = add nsw i32 %mul, 7
+  store i32 %add, i32* %arrayidx, align 4
+  %inc = add nsw i32 %i.06, 1
+  %cmp = icmp slt i32 %inc, 16
+  br i1 %cmp, label %for.body, label %for.end
+
+for.end:
+  ret void
+}
+
+; Each peeled copy of a loop with a diamond in its body is added to the
+; dominator tree next to the original blocks it was cloned from.
+; CHECK-LABEL: @peel_diamond(
+; CHECK: for.body.peel1:
+; CHECK: if.then.peel1:
+; CHECK: for.latch.peel1:
+; CHECK: for.body.peel3:
+; CHECK: for.latch.peel3:
+; CHECK: for.body:
+; CHECK: for.end:
+; CHECK: phi i32 {{.*}}%for.latch.peel1{{.*}}%for.latch.peel3
+define i32 @peel_diamond(i32* nocapture %p, i32 %n) {
+entry:
+  %cmp5 = icmp sgt i32 %n, 0
+  br i1 %cmp5, label %for.body, label %exit
+
+for.body:
+  %i.06 = phi i32 [ %inc, %for.latch ], [ 0, %entry ]
+  %idxprom = sext i32 %i.06 to i64
+  %arrayidx = getelementptr inbounds i32, i32* %p, i64 %idxprom
+  %v = load i32, i32* %arrayidx, align 4
+  %odd = icmp slt i32 %v, 0
+  br i1 %odd, label %if.then, label %for.latch
+
+if.then:
+  store i32 %i.06, i32* %arrayidx, align 4
+  br label %for.latch
+
+for.latch:
+  %inc = add nsw i32 %i.06, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %for.body, label %for.end, !prof !0
+
+for.end:
+  %last = phi i32 [ %v, %for.latch ]
+  br label %exit
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %last, %for.end ]
+  ret i32 %r
+}
+
+; The remaining loop of @peel keeps its scaled down weights and is not
+; unrolled again.
+; CHECK: ![[PROF]] = !{!"branch_weights", i32 1, i32 100}
+; CHECK: ![[LOOP]] = distinct !{![[LOOP]], ![[DISABLE:[0-9]+]]}
+; CHECK: ![[DISABLE]] = !{!"llvm.loop.unroll.disable"}
+
+!0 = !{!"branch_weights", i32 200, i32 100}
+!1 = !{!"branch_weights", i32 10000, i32 100}
+!2 = !{!"function_entry_count", i64 0}
@@ -0,0 +1,68 @@
+; RUN: opt < %s -loop-vectorize -enable-epilogue-vectorization -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -mtriple=x86_64-unknown-linux -mcpu=core-avx2 -S | FileCheck %s --check-prefix=NOEPI
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux"
+
+; The remainder of the 8-wide loop is vectorized again at a narrower width,
+; leaving at most three iterations to the scalar loop.
+
+; CHECK-LABEL: @scale(
+; CHECK: load <8 x float>
+; CHECK: fmul <8 x float>
+; CHECK: store <8 x float>
+; CHECK: load <4 x float>
+; CHECK: fmul <4 x float>
+; CHECK: store <4 x float>
+; CHECK: load float
+; CHECK: ret void
+
+; NOEPI-LABEL: @scale(
+; NOEPI: load <8 x float>
+; NOEPI-NOT: <4 x float>
+; NOEPI: ret void
+define void @scale(float* nocapture %a, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %iv = phi i64 [ %iv.next, %loop ], [ 0, %entry ]
+  %p = getelementptr inbounds float, float* %a, i64 %iv
+  %v = load float, float* %p, align 4
+  %m = fmul float %v, 3.000000e+00
+  store float %m, float* %p, align 4
+  %iv.next = add nuw nsw i64 %iv, 1
+  %done = icmp eq i64 %iv.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+; A reduction carries its partial result from the main vector loop through the
+; epilogue to the exit.
+
+; CHECK-LABEL: @sum(
+; CHECK: add <8 x i32>
+; CHECK: add <4 x i32>
+; CHECK: ret i32
+define i32 @sum(i32* nocapture readonly %a, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %iv = phi i64 [ %iv.next, %loop ], [ 0, %entry ]
+  %acc = phi i32 [ %acc.next, %loop ], [ 0, %entry ]
+  %p = getelementptr inbounds i32, i32* %a, i64 %iv
+  %v = load i32, i32* %p, align 4
+  %acc.next = add i32 %acc, %v
+  %iv.next = add nuw nsw i64 %iv, 1
+  %done = icmp eq i64 %iv.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  ret i32 %r
+}
@@ -296,6 +296,9 @@ for.body:                                         ; preds = %for.body, %entry
 ; CHECK: %strided.vec = shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 0, i32 2, i32 4, i32 6>
 ; CHECK-NOT: shufflevector <8 x i32> %wide.vec, <8 x i32> undef, <4 x i32> <i32 1, i32 3, i32 5, i32 7>
 ; CHECK: shl nsw <4 x i32> %strided.vec, <i32 1, i32 1, i32 1, i32 1>
+; The load group has a gap at its last member, so the final iteration is left
+; to the scalar loop to avoid reading past the end of A.
+; CHECK: icmp eq i64 %index.next, 508
 
 define void @even_load(i32* noalias nocapture readonly %A, i32* noalias nocapture %B) {
 entry:
@@ -0,0 +1,113 @@
+; RUN: opt < %s -basicaa -loop-vectorize -vectorize-outer-loops -force-vector-width=4 -force-vector-interleave=1 -S | FileCheck %s
+; RUN: opt < %s -basicaa -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -S | FileCheck %s --check-prefix=INNER
+
+target datalayout = "e-m:e-i64:64-i128:128-n32:64-S128"
+
+; A 1-D stencil: the inner loop over the four taps has a constant trip count,
+; so it is unrolled and the loop over the outputs is vectorized instead.
+;
+;   for (i = 0; i < n; ++i) {
+;     float s = 0;
+;     for (j = 0; j < 4; ++j)
+;       s += in[i + j] * w[j];
+;     out[i] = s;
+;   }
+
+; CHECK-LABEL: @stencil(
+; CHECK: vector.body:
+; CHECK: load <4 x float>
+; CHECK: fmul <4 x float>
+; CHECK: fadd <4 x float>
+; CHECK: store <4 x float>
+
+; INNER-LABEL: @stencil(
+; INNER-NOT: store <4 x float>
+; INNER: ret void
+define void @stencil(float* noalias nocapture %out, float* noalias nocapture readonly %in, float* noalias nocapture readonly %w, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %outer, label %exit
+
+outer:
+  %i = phi i64 [ %i.next, %outer.latch ], [ 0, %entry ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %s = phi float [ 0.000000e+00, %outer ], [ %s.next, %inner ]
+  %idx = add nuw nsw i64 %i, %j
+  %in.p = getelementptr inbounds float, float* %in, i64 %idx
+  %in.v = load float, float* %in.p, align 4
+  %w.p = getelementptr inbounds float, float* %w, i64 %j
+  %w.v = load float, float* %w.p, align 4
+  %mul = fmul float %in.v, %w.v
+  %s.next = fadd float %s, %mul
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 4
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s.lcssa = phi float [ %s.next, %inner ]
+  %out.p = getelementptr inbounds float, float* %out, i64 %i
+  store float %s.lcssa, float* %out.p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; Each output depends on the previous one, so the flattened loop could not be
+; vectorized. The inner loop is left alone.
+;
+;   for (i = 1; i < n; ++i) {
+;     float s = out[i - 1];
+;     for (j = 0; j < 4; ++j)
+;       s += in[i + j] * w[j];
+;     out[i] = s;
+;   }
+
+; CHECK-LABEL: @recurrence(
+; CHECK-NOT: .flat
+; CHECK: inner:
+; CHECK: %j = phi i64
+; CHECK-NOT: <4 x float>
+; CHECK: ret void
+define void @recurrence(float* noalias nocapture %out, float* noalias nocapture readonly %in, float* noalias nocapture readonly %w, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 1
+  br i1 %cmp, label %outer, label %exit
+
+outer:
+  %i = phi i64 [ %i.next, %outer.latch ], [ 1, %entry ]
+  %i.prev = add nsw i64 %i, -1
+  %prev.p = getelementptr inbounds float, float* %out, i64 %i.prev
+  %prev = load float, float* %prev.p, align 4
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %s = phi float [ %prev, %outer ], [ %s.next, %inner ]
+  %idx = add nuw nsw i64 %i, %j
+  %in.p = getelementptr inbounds float, float* %in, i64 %idx
+  %in.v = load float, float* %in.p, align 4
+  %w.p = getelementptr inbounds float, float* %w, i64 %j
+  %w.v = load float, float* %w.p, align 4
+  %mul = fmul float %in.v, %w.v
+  %s.next = fadd float %s, %mul
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 4
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %s.lcssa = phi float [ %s.next, %inner ]
+  %out.p = getelementptr inbounds float, float* %out, i64 %i
+  store float %s.lcssa, float* %out.p, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
@@ -0,0 +1,101 @@
+; RUN: opt < %s -ipsccp -S | FileCheck %s
+; RUN: opt < %s -sccp -S | FileCheck %s --check-prefix=SCCP
+
+; A PHI of different constants is overdefined, but lies in their range.
+define i1 @phi(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  br label %m
+b:
+  br label %m
+m:
+  %p = phi i32 [ 1, %a ], [ 5, %b ]
+  %cmp = icmp sgt i32 %p, 0
+  ret i1 %cmp
+; CHECK-LABEL: @phi(
+; CHECK: ret i1 true
+; SCCP-LABEL: @phi(
+; SCCP: ret i1 true
+}
+
+; The range does not decide this comparison.
+define i1 @phi_undecided(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  br label %m
+b:
+  br label %m
+m:
+  %p = phi i32 [ 1, %a ], [ 5, %b ]
+  %cmp = icmp ult i32 %p, 3
+  ret i1 %cmp
+; CHECK-LABEL: @phi_undecided(
+; CHECK: ret i1 %cmp
+}
+
+; An induction variable is not bounded by its start value.
+define i32 @loop(i32 %n) {
+entry:
+  br label %loop
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+exit:
+  %neg = icmp slt i32 %i, 0
+  %r = select i1 %neg, i32 1, i32 2
+  ret i32 %r
+; CHECK-LABEL: @loop(
+; CHECK: ret i32 %r
+}
+
+; The arguments of an internal function lie in the range of the values it is
+; called with.
+define internal i1 @callee(i32 %x) {
+  %cmp = icmp ult i32 %x, 10
+  ret i1 %cmp
+}
+
+; The call with 20, in a block reached later, keeps the comparison.
+define internal i1 @callee2(i32 %x) {
+  %cmp = icmp ult i32 %x, 10
+  ret i1 %cmp
+}
+
+; A tracked return value lies in the range of the values returned.
+define internal i32 @ret(i1 %c) {
+  br i1 %c, label %a, label %b
+a:
+  ret i32 3
+b:
+  ret i32 7
+}
+
+define i1 @caller(i1 %c) {
+entry:
+  %r1 = call i1 @callee(i32 1)
+  %r2 = call i1 @callee(i32 2)
+  %v = call i32 @ret(i1 %c)
+  %cmp = icmp ne i32 %v, 0
+  %a = and i1 %r1, %r2
+  %b = and i1 %a, %cmp
+  %s1 = call i1 @callee2(i32 1)
+  br i1 %c, label %late, label %exit
+late:
+  %s2 = call i1 @callee2(i32 20)
+  br label %exit
+exit:
+  %s = phi i1 [ %s1, %entry ], [ %s2, %late ]
+  %res = and i1 %b, %s
+  ret i1 %res
+; CHECK-LABEL: define internal i1 @callee(
+; CHECK-NEXT: ret i1 undef
+; CHECK-LABEL: define internal i1 @callee2(
+; CHECK-NEXT: %cmp = icmp ult i32 %x, 10
+; CHECK-NEXT: ret i1 %cmp
+; CHECK-LABEL: @caller(
+; CHECK: %res = and i1 true, %s
+}
@@ -0,0 +1,125 @@
+; RUN: opt -basicaa -slp-vectorizer -slp-vectorize-hor -slp-vectorize-hor-store -S < %s -mtriple=x86_64-apple-macosx -mcpu=corei7-avx | FileCheck %s
+
+; Integer min and max reductions, written as compares and selects.
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+
+; CHECK-LABEL: @smax_store(
+; CHECK: sub <4 x i32>
+; CHECK: %rdx.shuf = shufflevector <4 x i32>
+; CHECK: icmp sgt <4 x i32>
+; CHECK: select <4 x i1>
+; CHECK: %rdx.shuf1 = shufflevector <4 x i32>
+; CHECK: icmp sgt <4 x i32>
+; CHECK: [[MAX:%.*]] = select <4 x i1>
+; CHECK: [[RES:%.*]] = extractelement <4 x i32> [[MAX]], i32 0
+; CHECK: store i32 [[RES]], i32* %out
+define void @smax_store(i32* %p, i32* %q, i32* %out) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %q1 = getelementptr inbounds i32, i32* %q, i64 1
+  %q2 = getelementptr inbounds i32, i32* %q, i64 2
+  %q3 = getelementptr inbounds i32, i32* %q, i64 3
+  %x0 = load i32, i32* %p, align 4
+  %x1 = load i32, i32* %p1, align 4
+  %x2 = load i32, i32* %p2, align 4
+  %x3 = load i32, i32* %p3, align 4
+  %y0 = load i32, i32* %q, align 4
+  %y1 = load i32, i32* %q1, align 4
+  %y2 = load i32, i32* %q2, align 4
+  %y3 = load i32, i32* %q3, align 4
+  %a0 = sub i32 %x0, %y0
+  %a1 = sub i32 %x1, %y1
+  %a2 = sub i32 %x2, %y2
+  %a3 = sub i32 %x3, %y3
+  %c0 = icmp sgt i32 %a0, %a1
+  %m0 = select i1 %c0, i32 %a0, i32 %a1
+  %c1 = icmp sgt i32 %m0, %a2
+  %m1 = select i1 %c1, i32 %m0, i32 %a2
+  %c2 = icmp sgt i32 %m1, %a3
+  %m2 = select i1 %c2, i32 %m1, i32 %a3
+  store i32 %m2, i32* %out, align 4
+  ret void
+}
+
+; The loop carried minimum stays scalar; the four values of each iteration
+; are reduced in a vector first.
+; CHECK-LABEL: @umin_phi(
+; CHECK: mul <4 x i32>
+; CHECK: icmp ult <4 x i32>
+; CHECK: icmp ult <4 x i32>
+; CHECK: [[MIN:%.*]] = select <4 x i1>
+; CHECK: [[RDX:%.*]] = extractelement <4 x i32> [[MIN]], i32 0
+; CHECK: [[CMP:%.*]] = icmp ult i32 %m, [[RDX]]
+; CHECK: %m.next = select i1 [[CMP]], i32 %m, i32 [[RDX]]
+define i32 @umin_phi(i32* %p, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %m = phi i32 [ -1, %entry ], [ %m.next, %loop ]
+  %base = shl i64 %i, 2
+  %q0 = getelementptr inbounds i32, i32* %p, i64 %base
+  %q1 = getelementptr inbounds i32, i32* %q0, i64 1
+  %q2 = getelementptr inbounds i32, i32* %q0, i64 2
+  %q3 = getelementptr inbounds i32, i32* %q0, i64 3
+  %l0 = load i32, i32* %q0, align 4
+  %l1 = load i32, i32* %q1, align 4
+  %l2 = load i32, i32* %q2, align 4
+  %l3 = load i32, i32* %q3, align 4
+  %b0 = mul i32 %l0, %l0
+  %b1 = mul i32 %l1, %l1
+  %b2 = mul i32 %l2, %l2
+  %b3 = mul i32 %l3, %l3
+  %d0 = icmp ult i32 %b0, %b1
+  %n0 = select i1 %d0, i32 %b0, i32 %b1
+  %d1 = icmp ult i32 %b2, %b3
+  %n1 = select i1 %d1, i32 %b2, i32 %b3
+  %d2 = icmp ule i32 %n0, %n1
+  %n2 = select i1 %d2, i32 %n0, i32 %n1
+  %d3 = icmp ult i32 %m, %n2
+  %m.next = select i1 %d3, i32 %m, i32 %n2
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %m.next
+}
+
+; A maximum of minimums is not one reduction.
+; CHECK-LABEL: @smax_of_smin(
+; CHECK-NOT: rdx.shuf
+; CHECK: ret void
+define void @smax_of_smin(i32* %p, i32* %q, i32* %out) {
+entry:
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %p2 = getelementptr inbounds i32, i32* %p, i64 2
+  %p3 = getelementptr inbounds i32, i32* %p, i64 3
+  %q1 = getelementptr inbounds i32, i32* %q, i64 1
+  %q2 = getelementptr inbounds i32, i32* %q, i64 2
+  %q3 = getelementptr inbounds i32, i32* %q, i64 3
+  %x0 = load i32, i32* %p, align 4
+  %x1 = load i32, i32* %p1, align 4
+  %x2 = load i32, i32* %p2, align 4
+  %x3 = load i32, i32* %p3, align 4
+  %y0 = load i32, i32* %q, align 4
+  %y1 = load i32, i32* %q1, align 4
+  %y2 = load i32, i32* %q2, align 4
+  %y3 = load i32, i32* %q3, align 4
+  %a0 = sub i32 %x0, %y0
+  %a1 = sub i32 %x1, %y1
+  %a2 = sub i32 %x2, %y2
+  %a3 = sub i32 %x3, %y3
+  %c0 = icmp slt i32 %a0, %a1
+  %m0 = select i1 %c0, i32 %a0, i32 %a1
+  %c1 = icmp slt i32 %a2, %a3
+  %m1 = select i1 %c1, i32 %a2, i32 %a3
+  %c2 = icmp sgt i32 %m0, %m1
+  %m2 = select i1 %c2, i32 %m0, i32 %m1
+  store i32 %m2, i32* %out, align 4
+  ret void
+}
@@ -8,9 +8,12 @@
 //===----------------------------------------------------------------------===//
 
 #include "OrcLazyJIT.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/ExecutionEngine/Orc/OrcTargetSupport.h"
+#include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include <cstdio>
 #include <system_error>
 
@@ -39,6 +42,32 @@ namespace {
                                              "working directory. (WARNING: "
                                              "will overwrite existing files)."),
                                   clEnumValEnd));
+
+  cl::opt<bool> OrcBackgroundCompile("orc-lazy-background-compile",
+                                     cl::desc("Compile the callees of each "
+                                              "compiled function ahead of time "
+                                              "on a background thread."),
+                                     cl::init(false));
+
+  cl::opt<unsigned> OrcTierUpThreshold("orc-lazy-tier-up-threshold",
+                                       cl::desc("Compile functions at -O0 "
+                                                "first, and recompile them "
+                                                "at the requested optimization "
+                                                "level after this many calls "
+                                                "(0 disables tiering)."),
+                                       cl::init(0));
+
+  cl::opt<std::string>
+  OrcObjectCacheDir("orc-lazy-object-cache-dir",
+                    cl::desc("Keep compiled objects in this directory and "
+                             "reuse them in later runs."),
+                    cl::init(""));
+
+  cl::opt<unsigned>
+  OrcObjectCacheSize("orc-lazy-object-cache-size",
+                     cl::desc("Maximum size of the object cache in "
+                              "megabytes (0 means unbounded)."),
+                     cl::init(0));
 }
 
 OrcLazyJIT::CallbackManagerBuilder
@@ -108,6 +137,52 @@ OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
   llvm_unreachable("Unknown DumpKind");
 }
 
+// Run the IR optimization pipeline for the given level over a hot tier
+// partition.
+static void optimizeHotModule(Module &M, TargetMachine &TM,
+                              CodeGenOpt::Level Level) {
+  PassManagerBuilder Builder;
+  switch (Level) {
+  case CodeGenOpt::None: Builder.OptLevel = 0; break;
+  case CodeGenOpt::Less: Builder.OptLevel = 1; break;
+  case CodeGenOpt::Default: Builder.OptLevel = 2; break;
+  case CodeGenOpt::Aggressive: Builder.OptLevel = 3; break;
+  }
+
+  legacy::FunctionPassManager FPM(&M);
+  FPM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  Builder.populateFunctionPassManager(FPM);
+  FPM.doInitialization();
+  for (auto &F : M)
+    FPM.run(F);
+  FPM.doFinalization();
+
+  legacy::PassManager MPM;
+  MPM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
+  Builder.populateModulePassManager(MPM);
+  MPM.run(M);
+}
+
+OrcLazyJIT::CompileLayerT::CompileFtor
+OrcLazyJIT::createCompiler(TargetMachine &TM, bool Tiered) {
+  if (!Tiered)
+    return orc::SimpleCompiler(TM);
+
+  // Baseline tier modules are compiled at -O0 with fast instruction selection.
+  // Hot tier modules are optimized and compiled at the level TM was created
+  // with. The compile-on-demand layer never compiles two modules at once, so
+  // it is safe to reconfigure TM for each module.
+  CodeGenOpt::Level HotOptLevel = TM.getOptLevel();
+  return [&TM, HotOptLevel](Module &M) {
+    bool Hot = CODLayerT::isHotTierModule(M);
+    if (Hot)
+      optimizeHotModule(M, TM, HotOptLevel);
+    TM.setOptLevel(Hot ? HotOptLevel : CodeGenOpt::None);
+    TM.setFastISel(!Hot);
+    return orc::SimpleCompiler(TM)(M);
+  };
+}
+
 // Defined in lli.cpp.
 CodeGenOpt::Level getOptLevel();
 
@@ -136,7 +211,11 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
   }
 
   // Everything looks good. Build the JIT.
-  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder);
+  OrcLazyJIT J(std::move(TM), Context, CallbackMgrBuilder,
+               OrcBackgroundCompile, OrcTierUpThreshold);
+  if (!OrcObjectCacheDir.empty())
+    J.enableObjectCache(OrcObjectCacheDir,
+                        uint64_t(OrcObjectCacheSize) * 1024 * 1024);
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
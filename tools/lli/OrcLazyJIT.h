@@ -16,6 +16,7 @@
 #define LLVM_TOOLS_LLI_ORCLAZYJIT_H
 
 #include "llvm/ADT/Triple.h"
+#include "llvm/ExecutionEngine/FileSystemObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
@@ -48,14 +49,26 @@ public:
   static CallbackManagerBuilder createCallbackManagerBuilder(Triple T);
 
   OrcLazyJIT(std::unique_ptr<TargetMachine> TM, LLVMContext &Context,
-             CallbackManagerBuilder &BuildCallbackMgr)
+             CallbackManagerBuilder &BuildCallbackMgr,
+             bool CompileInBackground = false,
+             unsigned TierUpThreshold = 0)
     : TM(std::move(TM)),
       ObjectLayer(),
-      CompileLayer(ObjectLayer, orc::SimpleCompiler(*this->TM)),
+      CompileLayer(ObjectLayer,
+                   createCompiler(*this->TM, TierUpThreshold != 0)),
       IRDumpLayer(CompileLayer, createDebugDumper()),
       CCMgr(BuildCallbackMgr(IRDumpLayer, CCMgrMemMgr, Context)),
-      CODLayer(IRDumpLayer, *CCMgr, false),
-      CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {}
+      CODLayer(IRDumpLayer, *CCMgr, false, CompileInBackground,
+               TierUpThreshold),
+      CXXRuntimeOverrides([this](const std::string &S) { return mangle(S); }) {
+    // The tiered compiler reconfigures TM for each module, so an object cache
+    // can't read the code generation settings off TM at lookup. Describe both
+    // tiers instead; the hot tier module flag is part of every module's key.
+    if (TierUpThreshold)
+      TieredCacheConfiguration =
+        FileSystemObjectCache::getConfiguration(*this->TM) +
+        "\nbaseline tier: -O0 with fast-isel";
+  }
 
   ~OrcLazyJIT() {
     // Run any destructors registered with __cxa_atexit.
@@ -122,6 +135,18 @@ public:
     return H;
   }
 
+  /// Cache compiled objects in CacheDir, evicting the least recently used
+  /// ones once they take up more than MaxSizeInBytes (if non-zero).
+  void enableObjectCache(StringRef CacheDir, uint64_t MaxSizeInBytes) {
+    if (TieredCacheConfiguration.empty())
+      ObjCache =
+        llvm::make_unique<FileSystemObjectCache>(CacheDir, *TM, MaxSizeInBytes);
+    else
+      ObjCache = llvm::make_unique<FileSystemObjectCache>(
+          CacheDir, TieredCacheConfiguration, MaxSizeInBytes);
+    CompileLayer.setObjectCache(ObjCache.get());
+  }
+
   orc::JITSymbol findSymbol(const std::string &Name) {
     return CODLayer.findSymbol(mangle(Name), true);
   }
@@ -143,7 +168,12 @@ private:
 
   static TransformFtor createDebugDumper();
 
+  static CompileLayerT::CompileFtor createCompiler(TargetMachine &TM,
+                                                   bool Tiered);
+
   std::unique_ptr<TargetMachine> TM;
+  std::unique_ptr<ObjectCache> ObjCache;
+  std::string TieredCacheConfiguration;
   SectionMemoryManager CCMgrMemMgr;
 
   ObjLayerT ObjectLayer;
@@ -0,0 +1,176 @@
+//===-- RemoteJITUtils.cpp - Executors for lli's remote JIT mode ----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RemoteJITUtils.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/config.h"
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetServer.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cerrno>
+#if LLVM_ENABLE_THREADS
+#include <thread>
+#endif
+#ifdef LLVM_ON_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace llvm;
+using namespace llvm::orc::remote;
+
+static bool createPipe(int FDs[2]) {
+#ifdef LLVM_ON_UNIX
+  return ::pipe(FDs) == 0;
+#else
+  return ::_pipe(FDs, 4096, O_BINARY) == 0;
+#endif
+}
+
+static void closeFD(int &FD) {
+  if (FD != -1)
+    sys::Process::SafelyCloseFileDescriptor(FD);
+  FD = -1;
+}
+
+RemoteExecutor::RemoteExecutor(int InFD, int OutFD)
+    : InFD(InFD), OutFD(OutFD), Channel(new FDRPCChannel(InFD, OutFD)) {}
+
+RemoteExecutor::~RemoteExecutor() {
+  closeFD(InFD);
+  closeFD(OutFD);
+}
+
+namespace {
+
+#ifdef LLVM_ON_UNIX
+/// An executor running in a child process.
+class ChildProcessExecutor : public RemoteExecutor {
+public:
+  ChildProcessExecutor(int InFD, int OutFD, pid_t ChildPID)
+      : RemoteExecutor(InFD, OutFD), ChildPID(ChildPID) {}
+
+  ~ChildProcessExecutor() override {
+    // If the session was never terminated, the child sees end of file and
+    // exits.
+    closeFD(OutFD);
+    wait();
+  }
+
+  void wait() override {
+    if (ChildPID == -1)
+      return;
+    while (::waitpid(ChildPID, nullptr, 0) == -1 && errno == EINTR)
+      ;
+    ChildPID = -1;
+  }
+
+private:
+  pid_t ChildPID;
+};
+#endif
+
+#if LLVM_ENABLE_THREADS
+/// An executor serving requests from a thread of this process.
+class InProcessExecutor : public RemoteExecutor {
+public:
+  InProcessExecutor(int InFD, int OutFD, int ServerInFD, int ServerOutFD)
+      : RemoteExecutor(InFD, OutFD), ServerInFD(ServerInFD),
+        ServerOutFD(ServerOutFD), ServerChannel(ServerInFD, ServerOutFD) {
+    ServerThread = std::thread([this]() {
+      OrcRemoteTargetServer Server(ServerChannel);
+      if (std::error_code EC = Server.run())
+        errs() << "Remote executor: " << EC.message() << "\n";
+    });
+  }
+
+  ~InProcessExecutor() override {
+    closeFD(OutFD);
+    wait();
+    closeFD(ServerInFD);
+    closeFD(ServerOutFD);
+  }
+
+  void wait() override {
+    if (ServerThread.joinable())
+      ServerThread.join();
+  }
+
+private:
+  int ServerInFD, ServerOutFD;
+  FDRPCChannel ServerChannel;
+  std::thread ServerThread;
+};
+#endif
+
+} // end anonymous namespace
+
+std::unique_ptr<RemoteExecutor>
+RemoteExecutor::create(StringRef ChildExecPath, std::string &ErrMsg) {
+  int ToExecutor[2], FromExecutor[2];
+  if (!createPipe(ToExecutor)) {
+    ErrMsg = "Error creating pipe: " + sys::StrError();
+    return nullptr;
+  }
+  if (!createPipe(FromExecutor)) {
+    ErrMsg = "Error creating pipe: " + sys::StrError();
+    closeFD(ToExecutor[0]);
+    closeFD(ToExecutor[1]);
+    return nullptr;
+  }
+
+  if (ChildExecPath.empty()) {
+#if LLVM_ENABLE_THREADS
+    return llvm::make_unique<InProcessExecutor>(FromExecutor[0], ToExecutor[1],
+                                                ToExecutor[0], FromExecutor[1]);
+#else
+    ErrMsg = "Simulated remote execution requires threads";
+#endif
+  } else {
+#ifdef LLVM_ON_UNIX
+    std::string ChildPath = ChildExecPath;
+    std::string InFDArg = utostr(ToExecutor[0]);
+    std::string OutFDArg = utostr(FromExecutor[1]);
+
+    pid_t ChildPID = ::fork();
+    if (ChildPID == 0) {
+      // In the child: keep only the executor's ends of the pipes, and pass
+      // them on the command line so that stdin and stdout stay free for the
+      // JITed program.
+      ::close(ToExecutor[1]);
+      ::close(FromExecutor[0]);
+      const char *Args[] = {ChildPath.c_str(), InFDArg.c_str(),
+                            OutFDArg.c_str(), nullptr};
+      ::execv(ChildPath.c_str(), const_cast<char *const *>(Args));
+      ::perror("Error executing child process");
+      ::_exit(1);
+    }
+
+    if (ChildPID != -1) {
+      closeFD(ToExecutor[0]);
+      closeFD(FromExecutor[1]);
+      return llvm::make_unique<ChildProcessExecutor>(FromExecutor[0],
+                                                     ToExecutor[1], ChildPID);
+    }
+    ErrMsg = "Error forking child process: " + sys::StrError();
+#else
+    ErrMsg = "Host does not support external remote targets";
+#endif
+  }
+
+  for (int *FD : {&ToExecutor[0], &ToExecutor[1], &FromExecutor[0],
+                  &FromExecutor[1]})
+    closeFD(*FD);
+  return nullptr;
+}
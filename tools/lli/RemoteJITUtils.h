@@ -0,0 +1,51 @@
+//===-- RemoteJITUtils.h - Executors for lli's remote JIT mode --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Starts the executor that runs JITed code for lli -remote-mcjit.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TOOLS_LLI_REMOTEJITUTILS_H
+#define LLVM_TOOLS_LLI_REMOTEJITUTILS_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/ExecutionEngine/Orc/RPCChannel.h"
+#include <memory>
+#include <string>
+
+namespace llvm {
+
+/// The process, or stand-in for one, that runs JITed code for lli.
+class RemoteExecutor {
+public:
+  virtual ~RemoteExecutor();
+
+  /// Start \p ChildExecPath (normally lli-child-target) as a child process.
+  /// If \p ChildExecPath is empty, serve requests from a thread of this
+  /// process instead, which simulates a remote target.  Returns null and sets
+  /// \p ErrMsg on failure.
+  static std::unique_ptr<RemoteExecutor> create(StringRef ChildExecPath,
+                                                std::string &ErrMsg);
+
+  /// The channel to the executor's OrcRemoteTargetServer.
+  orc::remote::RPCChannel &getChannel() { return *Channel; }
+
+  /// Wait for the executor to finish, after the session has been terminated.
+  virtual void wait() = 0;
+
+protected:
+  RemoteExecutor(int InFD, int OutFD);
+
+  int InFD, OutFD;
+  std::unique_ptr<orc::remote::FDRPCChannel> Channel;
+};
+
+} // end namespace llvm
+
+#endif
@@ -15,9 +15,7 @@
 
 #include "llvm/IR/LLVMContext.h"
 #include "OrcLazyJIT.h"
-#include "RemoteMemoryManager.h"
-#include "RemoteTarget.h"
-#include "RemoteTargetExternal.h"
+#include "RemoteJITUtils.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
@@ -26,6 +24,7 @@
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetClient.h"
 #include "llvm/ExecutionEngine/OrcMCJITReplacement.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/IRBuilder.h"
@@ -96,7 +95,8 @@ namespace {
 
   // The MCJIT supports building for a target address space separate from
   // the JIT compilation process. Use a forked process and a copying
-  // memory manager with IPC to execute using this functionality.
+  // memory manager talking to it over RPC to execute using this
+  // functionality.
   cl::opt<bool> RemoteMCJIT("remote-mcjit",
     cl::desc("Execute MCJIT'ed code in a separate process."),
     cl::init(false));
@@ -104,7 +104,8 @@ namespace {
   // Manually specify the child process for remote execution. This overrides
   // the simulated remote execution that allocates address space for child
   // execution. The child process will be executed and will communicate with
-  // lli via stdin/stdout pipes.
+  // lli over a pair of pipes whose file descriptors are passed on its command
+  // line.
   cl::opt<std::string>
   ChildExecPath("mcjit-remote-process",
                 cl::desc("Specify the filename of the process to launch "
@@ -316,6 +317,11 @@ private:
 static ExecutionEngine *EE = nullptr;
 static LLIObjectCache *CacheManager = nullptr;
 
+// The executor and RPC client for -remote-mcjit. These outlive EE, whose
+// memory manager refers to the client until it is deleted in do_shutdown.
+static std::unique_ptr<RemoteExecutor> Executor;
+static std::unique_ptr<orc::remote::OrcRemoteTargetClient> Remote;
+
 static void do_shutdown() {
   // Cygwin-1.5 invokes DLL's dtors before atexit handler.
 #ifndef DO_NOTHING_ATEXIT
@@ -402,9 +408,13 @@ int main(int argc, char **argv, char * const *envp) {
   if (DisableCoreFiles)
     sys::Process::PreventCoreFiles();
 
-  // Load the bitcode...
+  // Load the bitcode... The lazy Orc JIT reads each function body from the
+  // bitcode only when the function is first compiled.
   SMDiagnostic Err;
-  std::unique_ptr<Module> Owner = parseIRFile(InputFile, Err, Context);
+  std::unique_ptr<Module> Owner =
+      UseJITKind == JITKind::OrcLazy
+          ? getLazyIRFileModule(InputFile, Err, Context)
+          : parseIRFile(InputFile, Err, Context);
   Module *Mod = Owner.get();
   if (!Mod) {
     Err.print(argv[0], errs());
@@ -449,9 +459,41 @@ int main(int argc, char **argv, char * const *envp) {
   // Enable MCJIT if desired.
   RTDyldMemoryManager *RTDyldMM = nullptr;
   if (!ForceInterpreter) {
-    if (RemoteMCJIT)
-      RTDyldMM = new RemoteMemoryManager();
-    else
+    if (RemoteMCJIT) {
+      std::string ChildPath = ChildExecPath;
+#ifndef LLVM_ON_UNIX
+      if (!ChildPath.empty()) {
+        // FIXME: Remove this pointless fallback mode which causes tests to
+        // "pass" on platforms where they should XFAIL.
+        errs() << "Warning: host does not support external remote targets.\n"
+               << "  Defaulting to simulated remote execution\n";
+        ChildPath.clear();
+      }
+#endif
+      if (!ChildPath.empty() && !sys::fs::can_execute(ChildPath)) {
+        errs() << "Unable to find usable child executable: '" << ChildPath
+               << "'\n";
+        return -1;
+      }
+
+      // With no child process name, requests are served from a thread of
+      // this process, which simulates remote execution.
+      std::string ErrMsg;
+      Executor = RemoteExecutor::create(ChildPath, ErrMsg);
+      if (!Executor) {
+        errs() << "ERROR: " << ErrMsg << "\n";
+        return EXIT_FAILURE;
+      }
+      auto RemoteOrErr =
+          orc::remote::OrcRemoteTargetClient::Create(Executor->getChannel());
+      if (std::error_code EC = RemoteOrErr.getError()) {
+        errs() << "ERROR: " << EC.message() << "\n";
+        return EXIT_FAILURE;
+      }
+      Remote = std::move(*RemoteOrErr);
+      RTDyldMM =
+          new orc::remote::OrcRemoteTargetClient::RCMemoryManager(*Remote);
+    } else
       RTDyldMM = new SectionMemoryManager();
 
     // Deliberately construct a temp std::unique_ptr to pass in. Do not null out
@@ -546,6 +588,11 @@ int main(int argc, char **argv, char * const *envp) {
                 JITEventListener::createOProfileJITEventListener());
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
+  // perf samples this process, so code running in a remote target would not
+  // be attributed to the symbols it reports.
+  if (!RemoteMCJIT)
+    EE->RegisterJITEventListener(
+                  JITEventListener::createPerfJITEventListener());
 
   if (!NoLazyCompilation && RemoteMCJIT) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
@@ -630,65 +677,35 @@ int main(int argc, char **argv, char * const *envp) {
     // Remote target MCJIT doesn't (yet) support static constructors. No reason
     // it couldn't. This is a limitation of the LLI implemantation, not the
     // MCJIT itself. FIXME.
-    //
-    RemoteMemoryManager *MM = static_cast<RemoteMemoryManager*>(RTDyldMM);
-    // Everything is prepared now, so lay out our program for the target
-    // address space, assign the section addresses to resolve any relocations,
-    // and send it to the target.
-
-    std::unique_ptr<RemoteTarget> Target;
-    if (!ChildExecPath.empty()) { // Remote execution on a child process
-#ifndef LLVM_ON_UNIX
-      // FIXME: Remove this pointless fallback mode which causes tests to "pass"
-      // on platforms where they should XFAIL.
-      errs() << "Warning: host does not support external remote targets.\n"
-             << "  Defaulting to simulated remote execution\n";
-      Target.reset(new RemoteTarget);
-#else
-      if (!sys::fs::can_execute(ChildExecPath)) {
-        errs() << "Unable to find usable child executable: '" << ChildExecPath
-               << "'\n";
-        return -1;
-      }
-      Target.reset(new RemoteTargetExternal(ChildExecPath));
-#endif
-    } else {
-      // No child process name provided, use simulated remote execution.
-      Target.reset(new RemoteTarget);
-    }
-
-    // Give the memory manager a pointer to our remote target interface object.
-    MM->setRemoteTarget(Target.get());
-
-    // Create the remote target.
-    if (!Target->create()) {
-      errs() << "ERROR: " << Target->getErrorMsg() << "\n";
-      return EXIT_FAILURE;
-    }
 
     // Since we're executing in a (at least simulated) remote address space,
     // we can't use the ExecutionEngine::runFunctionAsMain(). We have to
     // grab the function address directly here and tell the remote target
     // to execute the function.
     //
-    // Our memory manager will map generated code into the remote address
-    // space as it is loaded and copy the bits over during the finalizeMemory
-    // operation.
+    // Our memory manager lays generated code out in the remote address space
+    // as each object is loaded and sends the bits over during the
+    // finalizeMemory operation.
     //
-    // FIXME: argv and envp handling.
+    // FIXME: envp handling.
+    EE->finalizeObject();
     uint64_t Entry = EE->getFunctionAddress(EntryFn->getName().str());
 
     DEBUG(dbgs() << "Executing '" << EntryFn->getName() << "' at 0x"
                  << format("%llx", Entry) << "\n");
 
-    if (!Target->executeCode(Entry, Result))
-      errs() << "ERROR: " << Target->getErrorMsg() << "\n";
+    if (std::error_code EC = Remote->callMain(Result, Entry, InputArgv)) {
+      errs() << "ERROR: " << EC.message() << "\n";
+      Result = EXIT_FAILURE;
+    }
 
     // Like static constructors, the remote target MCJIT support doesn't handle
     // this yet. It could. FIXME.
 
     // Stop the remote target
-    Target->stop();
+    if (std::error_code EC = Remote->terminateSession())
+      errs() << "ERROR: " << EC.message() << "\n";
+    Executor->wait();
   }
 
   return Result;
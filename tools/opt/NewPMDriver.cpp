@@ -14,20 +14,35 @@
 //===----------------------------------------------------------------------===//
 
 #include "NewPMDriver.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
 #include "llvm/Bitcode/BitcodeWriterPass.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/Dominators.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Linker/Linker.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <thread>
 
 using namespace llvm;
 using namespace opt_tool;
@@ -36,18 +51,9 @@ static cl::opt<bool>
     DebugPM("debug-pass-manager", cl::Hidden,
             cl::desc("Print pass management debugging information"));
 
-bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
-                           TargetMachine *TM, tool_output_file *Out,
-                           StringRef PassPipeline, OutputKind OK,
-                           VerifierKind VK,
-                           bool ShouldPreserveAssemblyUseListOrder,
-                           bool ShouldPreserveBitcodeUseListOrder) {
-  PassBuilder PB(TM);
-
-  FunctionAnalysisManager FAM(DebugPM);
-  CGSCCAnalysisManager CGAM(DebugPM);
-  ModuleAnalysisManager MAM(DebugPM);
-
+static void registerAnalyses(PassBuilder &PB, ModuleAnalysisManager &MAM,
+                             CGSCCAnalysisManager &CGAM,
+                             FunctionAnalysisManager &FAM) {
   // Register all the basic analyses with the managers.
   PB.registerModuleAnalyses(MAM);
   PB.registerCGSCCAnalyses(CGAM);
@@ -60,17 +66,429 @@ bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
   CGAM.registerPass(ModuleAnalysisManagerCGSCCProxy(MAM));
   FAM.registerPass(CGSCCAnalysisManagerFunctionProxy(CGAM));
   FAM.registerPass(ModuleAnalysisManagerFunctionProxy(MAM));
+}
 
-  ModulePassManager MPM(DebugPM);
-  if (VK > VK_NoVerifier)
-    MPM.addPass(VerifierPass());
+/// Returns true if \p PassPipeline is a single 'function(...)' pipeline, so
+/// that every pass in it only ever looks at one function at a time.
+static bool isFunctionPipeline(StringRef PassPipeline) {
+  StringRef Prefix = "function(";
+  if (!PassPipeline.startswith(Prefix) || !PassPipeline.endswith(")"))
+    return false;
+
+  // The parenthesis opened by the prefix must be the one closed at the end.
+  StringRef Inner =
+      PassPipeline.substr(Prefix.size(), PassPipeline.size() -
+                                             Prefix.size() - 1);
+  int Depth = 0;
+  for (char C : Inner) {
+    if (C == '(')
+      ++Depth;
+    else if (C == ')' && --Depth < 0)
+      return false;
+  }
+  return Inner.find("module(") == StringRef::npos &&
+         Inner.find("cgscc(") == StringRef::npos;
+}
+
+/// Returns true if \p M can be split into per-function pieces that are linked
+/// back together by name without changing its meaning.
+static bool canSplitByFunction(const Module &M) {
+  if (!M.alias_empty() || !M.getComdatSymbolTable().empty())
+    return false;
+  // Each piece would carry its own copy of the debug info.
+  if (M.getNamedMetadata("llvm.dbg.cu"))
+    return false;
+  // Reading the pieces back would strip debug info of an older version.
+  bool HasCurrentDebugInfo =
+      getDebugMetadataVersionFromModule(M) == DEBUG_METADATA_VERSION;
+  // The pieces are matched up by name, whatever the linkage.
+  for (const Function &F : M) {
+    if (!F.hasName())
+      return false;
+    for (const BasicBlock &BB : F) {
+      // Block addresses do not survive the bodies being taken out.
+      if (BB.hasAddressTaken())
+        return false;
+      if (!HasCurrentDebugInfo)
+        for (const Instruction &I : BB)
+          if (I.getDebugLoc() || isa<DbgInfoIntrinsic>(I))
+            return false;
+    }
+  }
+  for (const GlobalVariable &GV : M.globals())
+    if (!GV.hasName())
+      return false;
+  return true;
+}
+
+namespace {
+/// The functions one thread optimizes, and the result of doing so.
+struct FunctionPartition {
+  StringSet<> Functions;
+  uint64_t Size;
+  SmallVector<char, 0> Bitcode;
+  std::string Error;
+
+  FunctionPartition() : Size(0) {}
+};
+}
+
+/// Lists the metadata the function bodies refer to, so that the copies each
+/// partition makes of it can be matched with the originals afterwards.
+static const char *const PartitionMetadataName = "opt.threads.metadata";
+
+/// Load a copy of the module from \p Input into a fresh context, run
+/// \p PassPipeline over the functions in \p P and leave the result in
+/// P.Bitcode.  What the original module already has, other than the bodies of
+/// those functions, is reduced to declarations.  Globals created by the
+/// passes are kept as they are.
+static void optimizePartition(MemoryBufferRef Input, const TargetMachine *TM,
+                              std::string PassPipeline, VerifierKind VK,
+                              FunctionPartition &P) {
+  LLVMContext Context;
+  ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(Input, Context);
+  if (std::error_code EC = MOrErr.getError()) {
+    P.Error = EC.message();
+    return;
+  }
+  Module &M = **MOrErr;
+
+  // The other functions are still definitions as far as the passes can tell,
+  // since some of them treat calls to declarations more conservatively.
+  std::vector<Function *> Stubs;
+  for (Function &F : M) {
+    if (F.isDeclaration() || P.Functions.count(F.getName()))
+      continue;
+    GlobalValue::LinkageTypes Linkage = F.getLinkage();
+    F.deleteBody();
+    F.setLinkage(Linkage);
+    new UnreachableInst(Context, BasicBlock::Create(Context, "", &F));
+    Stubs.push_back(&F);
+  }
+  StringSet<> OldGlobals;
+  for (GlobalVariable &GV : M.globals())
+    OldGlobals.insert(GV.getName());
+
+  // Subtargets are created and cached on demand, so every thread needs its
+  // own target machine.
+  std::unique_ptr<TargetMachine> LocalTM;
+  if (TM)
+    LocalTM.reset(TM->getTarget().createTargetMachine(
+        TM->getTargetTriple().str(), TM->getTargetCPU(),
+        TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+        TM->getCodeModel(), TM->getOptLevel()));
+
+  {
+    PassBuilder PB(LocalTM.get());
+    FunctionAnalysisManager FAM(DebugPM);
+    CGSCCAnalysisManager CGAM(DebugPM);
+    ModuleAnalysisManager MAM(DebugPM);
+    registerAnalyses(PB, MAM, CGAM, FAM);
+
+    ModulePassManager MPM(DebugPM);
+    if (VK > VK_NoVerifier)
+      MPM.addPass(VerifierPass());
+    if (!PB.parsePassPipeline(MPM, PassPipeline, VK == VK_VerifyEachPass,
+                              DebugPM)) {
+      P.Error = "unable to parse pass pipeline description.";
+      return;
+    }
+    if (VK > VK_NoVerifier)
+      MPM.addPass(VerifierPass());
+
+    MPM.run(M, &MAM);
+  }
+
+  for (Function *F : Stubs)
+    F->deleteBody();
+  for (Module::global_iterator I = M.global_begin(), E = M.global_end();
+       I != E;) {
+    GlobalVariable *GV = I++;
+    // llvm.used, llvm.global_ctors and friends would be appended twice.
+    if (GV->hasAppendingLinkage()) {
+      GV->eraseFromParent();
+      continue;
+    }
+    // Existing globals resolve to the original module's definitions by name.
+    // New ones are linked in with their initializer and linkage; the linker
+    // renames local ones whose names clash with another partition's.
+    if (OldGlobals.count(GV->getName()) && !GV->isDeclaration()) {
+      GV->setInitializer(nullptr);
+      GV->setLinkage(GlobalValue::ExternalLinkage);
+    }
+  }
+  // The original module has external declarations of the optimized
+  // functions; the caller restores their linkage.  Local, linkonce and
+  // available_externally definitions would not replace them otherwise.
+  for (Function &F : M)
+    if (P.Functions.count(F.getName()))
+      F.setLinkage(GlobalValue::ExternalLinkage);
+  // Keep the debug info version, or reading the result back would strip the
+  // debug locations.
+  SmallVector<Module::ModuleFlagEntry, 4> Flags;
+  M.getModuleFlagsMetadata(Flags);
+  for (Module::named_metadata_iterator I = M.named_metadata_begin(),
+                                       E = M.named_metadata_end();
+       I != E;) {
+    NamedMDNode *NMD = I++;
+    if (NMD->getName() != PartitionMetadataName)
+      NMD->eraseFromParent();
+  }
+  for (const Module::ModuleFlagEntry &Flag : Flags)
+    if (Flag.Key->getString() == "Debug Info Version")
+      M.addModuleFlag(Flag.Behavior, Flag.Key->getString(), Flag.Val);
+  // Module-level inline asm would be appended once per partition.
+  M.setModuleInlineAsm("");
+
+  raw_svector_ostream OS(P.Bitcode);
+  WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder=*/true);
+  OS.flush();
+}
+
+/// Add \p MD and the metadata it refers to to \p Nodes, once each.
+static void collectMetadata(Metadata *MD, std::vector<MDNode *> &Nodes,
+                            SmallPtrSetImpl<MDNode *> &Visited) {
+  MDNode *N = dyn_cast_or_null<MDNode>(MD);
+  if (!N || !Visited.insert(N).second)
+    return;
+  Nodes.push_back(N);
+  for (const MDOperand &Op : N->operands())
+    collectMetadata(Op, Nodes, Visited);
+}
+
+/// Returns the metadata attached to, or used by, the functions in \p M.
+static std::vector<MDNode *> collectFunctionMetadata(Module &M) {
+  std::vector<MDNode *> Nodes;
+  SmallPtrSet<MDNode *, 32> Visited;
+  SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+  for (Function &F : M) {
+    F.getAllMetadata(MDs);
+    for (const auto &MD : MDs)
+      collectMetadata(MD.second, Nodes, Visited);
+    for (BasicBlock &BB : F)
+      for (Instruction &I : BB) {
+        I.getAllMetadata(MDs);
+        for (const auto &MD : MDs)
+          collectMetadata(MD.second, Nodes, Visited);
+        for (Value *Op : I.operands())
+          if (auto *MDV = dyn_cast<MetadataAsValue>(Op))
+            collectMetadata(MDV->getMetadata(), Nodes, Visited);
+      }
+  }
+  return Nodes;
+}
+
+/// Put the globals of \p M in \p List that are named in \p Names first, in
+/// that order, followed by the rest in their current order.
+template <typename ListT>
+static void restoreOrder(Module &M, ListT &List,
+                         ArrayRef<std::string> Names) {
+  typedef typename ListT::value_type ValueT;
+  std::vector<ValueT *> Order;
+  StringSet<> Seen;
+  for (const std::string &Name : Names)
+    if (auto *V = dyn_cast_or_null<ValueT>(M.getNamedValue(Name))) {
+      Order.push_back(V);
+      Seen.insert(Name);
+    }
+  for (ValueT &V : List)
+    if (!Seen.count(V.getName()))
+      Order.push_back(&V);
+  for (ValueT *V : Order)
+    List.splice(List.end(), List, V);
+}
+
+/// Run the function pipeline \p PassPipeline over \p M on \p Threads threads.
+///
+/// LLVMContext is not thread-safe, so \p M is written out as bitcode and each
+/// thread optimizes a run of consecutive functions in a copy loaded into its
+/// own context.  The optimized bodies are linked back into \p M in module
+/// order, so the output does not depend on how the threads are scheduled and
+/// matches what running the pipeline on this thread would produce.
+static bool runFunctionPipelineInParallel(StringRef Arg0, Module &M,
+                                          TargetMachine *TM,
+                                          StringRef PassPipeline,
+                                          VerifierKind VK, unsigned Threads) {
+  // Metadata is copied into each partition's context and comes back as new
+  // nodes; distinct and cyclic nodes would then no longer be shared.  Name the
+  // originals so the copies can be mapped back to them.
+  std::vector<MDNode *> FunctionMD = collectFunctionMetadata(M);
+  NamedMDNode *FunctionMDList =
+      M.getOrInsertNamedMetadata(PartitionMetadataName);
+  for (MDNode *N : FunctionMD)
+    FunctionMDList->addOperand(N);
+
+  // The partitions start from the module as it is.
+  SmallVector<char, 0> Buffer;
+  {
+    raw_svector_ostream OS(Buffer);
+    WriteBitcodeToFile(&M, OS, /*ShouldPreserveUseListOrder=*/true);
+    OS.flush();
+  }
+  MemoryBufferRef Input(StringRef(Buffer.data(), Buffer.size()),
+                        M.getModuleIdentifier());
+
+  // Local symbols are resolved by name when the pieces are linked back, so
+  // make them external for the duration.  Function definitions lose their
+  // linkage when their bodies are deleted below; remember it as well.
+  StringMap<GlobalValue::LinkageTypes> Linkages;
+  std::vector<std::string> FunctionOrder, GlobalOrder;
+  uint64_t TotalSize = 0;
+  for (Function &F : M) {
+    FunctionOrder.push_back(F.getName());
+    if (!F.isDeclaration())
+      Linkages[F.getName()] = F.getLinkage();
+    for (BasicBlock &BB : F)
+      TotalSize += BB.size();
+  }
+  for (GlobalVariable &GV : M.globals()) {
+    GlobalOrder.push_back(GV.getName());
+    if (GV.hasLocalLinkage())
+      Linkages[GV.getName()] = GV.getLinkage();
+  }
+  for (auto &L : Linkages)
+    if (GlobalValue *GV = M.getNamedValue(L.getKey()))
+      if (GV->hasLocalLinkage())
+        GV->setLinkage(GlobalValue::ExternalLinkage);
+
+  // Split the functions into runs of about the same number of instructions.
+  // Keeping them in module order means globals and declarations the passes
+  // create come back in the order, and with the names, they would have had.
+  std::vector<FunctionPartition> Partitions(Threads);
+  uint64_t Target = (TotalSize + Threads - 1) / Threads;
+  unsigned Current = 0;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    uint64_t Size = 0;
+    for (BasicBlock &BB : F)
+      Size += BB.size();
+    if (Partitions[Current].Size >= Target && Current + 1 < Threads)
+      ++Current;
+    Partitions[Current].Functions.insert(F.getName());
+    Partitions[Current].Size += Size;
+  }
+
+  // The linker matches the partitions' struct types with the ones it finds in
+  // the module, so look for them while the function bodies still use them.
+  Linker L(&M);
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      F.deleteBody();
+
+  std::vector<std::thread> Workers;
+  for (FunctionPartition &P : Partitions)
+    if (!P.Functions.empty())
+      Workers.push_back(std::thread(optimizePartition, Input, TM,
+                                    PassPipeline.str(), VK, std::ref(P)));
+  for (std::thread &Worker : Workers)
+    Worker.join();
+
+  for (FunctionPartition &P : Partitions) {
+    if (P.Functions.empty())
+      continue;
+    if (!P.Error.empty()) {
+      errs() << Arg0 << ": " << P.Error << "\n";
+      return false;
+    }
+    MemoryBufferRef PartInput(StringRef(P.Bitcode.data(), P.Bitcode.size()),
+                              M.getModuleIdentifier());
+    ErrorOr<std::unique_ptr<Module>> PartOrErr =
+        parseBitcodeFile(PartInput, M.getContext());
+    if (std::error_code EC = PartOrErr.getError()) {
+      errs() << Arg0 << ": " << EC.message() << "\n";
+      return false;
+    }
+    // The passes may have raised the alignment of an existing global, which
+    // the linker does not carry over to a definition.
+    for (GlobalVariable &GV : (*PartOrErr)->globals())
+      if (GlobalVariable *Old = GV.isDeclaration()
+                                    ? M.getGlobalVariable(GV.getName(), true)
+                                    : nullptr)
+        if (GV.getAlignment() > Old->getAlignment())
+          Old->setAlignment(GV.getAlignment());
+    if (L.linkInModule(PartOrErr->get())) {
+      errs() << Arg0 << ": unable to link optimized functions.\n";
+      return false;
+    }
+
+    // The linker appended this partition's copy of the list; map each copy
+    // back to its original in the functions just linked in.
+    ValueToValueMapTy MDMap;
+    for (unsigned I = 0, E = FunctionMD.size(); I != E; ++I) {
+      MDNode *Copy = FunctionMDList->getOperand(FunctionMD.size() + I);
+      if (Copy != FunctionMD[I])
+        MDMap.MD()[Copy].reset(FunctionMD[I]);
+    }
+    FunctionMDList->dropAllReferences();
+    for (MDNode *N : FunctionMD)
+      FunctionMDList->addOperand(N);
+    if (MDMap.MD().empty())
+      continue;
+    SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
+    for (Function &F : M) {
+      if (!P.Functions.count(F.getName()))
+        continue;
+      F.getAllMetadata(MDs);
+      for (const auto &MD : MDs)
+        F.setMetadata(MD.first,
+                      MapMetadata(MD.second, MDMap, RF_IgnoreMissingEntries));
+      for (BasicBlock &BB : F)
+        for (Instruction &I : BB)
+          RemapInstruction(&I, MDMap, RF_IgnoreMissingEntries);
+    }
+  }
+  FunctionMDList->eraseFromParent();
+
+  for (auto &L : Linkages)
+    if (GlobalValue *GV = M.getNamedValue(L.getKey()))
+      GV->setLinkage(L.getValue());
+
+  // Linking replaces declarations with new definitions at the end of the
+  // module; put everything back in its original order, followed by anything
+  // the passes added.
+  restoreOrder(M, M.getFunctionList(), FunctionOrder);
+  restoreOrder(M, M.getGlobalList(), GlobalOrder);
+
+  return true;
+}
 
-  if (!PB.parsePassPipeline(MPM, PassPipeline, VK == VK_VerifyEachPass,
-                            DebugPM)) {
-    errs() << Arg0 << ": unable to parse pass pipeline description.\n";
+bool llvm::runPassPipeline(StringRef Arg0, LLVMContext &Context, Module &M,
+                           TargetMachine *TM, tool_output_file *Out,
+                           StringRef PassPipeline, OutputKind OK,
+                           VerifierKind VK,
+                           bool ShouldPreserveAssemblyUseListOrder,
+                           bool ShouldPreserveBitcodeUseListOrder,
+                           unsigned Threads) {
+  PassBuilder PB(TM);
+
+  FunctionAnalysisManager FAM(DebugPM);
+  CGSCCAnalysisManager CGAM(DebugPM);
+  ModuleAnalysisManager MAM(DebugPM);
+  registerAnalyses(PB, MAM, CGAM, FAM);
+
+  if (Threads > 1 && !isFunctionPipeline(PassPipeline)) {
+    errs() << Arg0 << ": -threads requires a 'function(...)' pass pipeline.\n";
     return false;
   }
 
+  ModulePassManager MPM(DebugPM);
+  // Modules that can't be split safely are optimized on this thread.
+  if (Threads > 1 && llvm_is_multithreaded() && canSplitByFunction(M)) {
+    // The pipeline itself runs on the partitions; only verify the result.
+    if (!runFunctionPipelineInParallel(Arg0, M, TM, PassPipeline, VK, Threads))
+      return false;
+  } else {
+    if (VK > VK_NoVerifier)
+      MPM.addPass(VerifierPass());
+
+    if (!PB.parsePassPipeline(MPM, PassPipeline, VK == VK_VerifyEachPass,
+                              DebugPM)) {
+      errs() << Arg0 << ": unable to parse pass pipeline description.\n";
+      return false;
+    }
+  }
+
   if (VK > VK_NoVerifier)
     MPM.addPass(VerifierPass());
 
@@ -71,6 +71,13 @@ static cl::opt<std::string> PassPipeline(
     cl::desc("A textual description of the pass pipeline for optimizing"),
     cl::Hidden);
 
+// Number of threads to run a function pass pipeline given with -passes on.
+static cl::opt<unsigned> Threads(
+    "threads", cl::init(1),
+    cl::desc("Number of threads to optimize functions on (requires a "
+             "-passes='function(...)' pipeline)"),
+    cl::Hidden);
+
 // Other command line options...
 //
 static cl::opt<std::string>
@@ -424,11 +431,16 @@ int main(int argc, char **argv) {
     // layer.
     return runPassPipeline(argv[0], Context, *M, TM.get(), Out.get(),
                            PassPipeline, OK, VK, PreserveAssemblyUseListOrder,
-                           PreserveBitcodeUseListOrder)
+                           PreserveBitcodeUseListOrder, Threads)
                ? 0
                : 1;
   }
 
+  if (Threads > 1) {
+    errs() << argv[0] << ": -threads requires a -passes pipeline.\n";
+    return 1;
+  }
+
   // Create a PassManager to hold and optimize the collection of passes we are
   // about to build.
   //
@@ -7,11 +7,14 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/ExecutionEngine/Interpreter.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/DynamicLibrary.h"
@@ -136,6 +139,24 @@ TEST_F(ExecutionEngineTest, DestructionRemovesGlobalMapping) {
   EXPECT_EQ(nullptr, Engine->getGlobalValueAtAddress(&Mem1));
 }
 
+TEST_F(ExecutionEngineTest, RunFunctionSeesUpdatedGlobalMapping) {
+  LLVMContext &Context = getGlobalContext();
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  GlobalVariable *G1 = NewExtGlobal(Int32Ty, "Global1");
+  Function *F = Function::Create(FunctionType::get(Int32Ty, false),
+                                 GlobalValue::ExternalLinkage, "f", M);
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  Builder.CreateRet(Builder.CreateLoad(G1));
+
+  int32_t Mem1 = 3;
+  Engine->addGlobalMapping(G1, &Mem1);
+  EXPECT_EQ(3u, Engine->runFunction(F, None).IntVal.getZExtValue());
+  int32_t Mem2 = 4;
+  Engine->updateGlobalMapping(G1, &Mem2);
+  EXPECT_EQ(4u, Engine->runFunction(F, None).IntVal.getZExtValue())
+    << "A function that has already run must not keep the old address.";
+}
+
 TEST_F(ExecutionEngineTest, LookupWithMangledName) {
   int x;
   llvm::sys::DynamicLibrary::AddSymbol("x", &x);
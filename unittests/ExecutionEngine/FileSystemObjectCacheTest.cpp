@@ -0,0 +1,127 @@
+//===- FileSystemObjectCacheTest.cpp - Unit tests for the object cache ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileSystemObjectCache.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+class FileSystemObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("objcache", CacheDir));
+    M = createModule("foo");
+  }
+
+  void TearDown() override {
+    std::error_code EC;
+    for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+         I.increment(EC))
+      sys::fs::remove(I->path());
+    sys::fs::remove(CacheDir);
+  }
+
+  std::unique_ptr<Module> createModule(StringRef FnName) {
+    auto M = make_unique<Module>("test", Context);
+    Function::Create(FunctionType::get(Type::getVoidTy(Context), false),
+                     GlobalValue::ExternalLinkage, FnName, M.get());
+    return M;
+  }
+
+  static std::string getContents(std::unique_ptr<MemoryBuffer> Buffer) {
+    return Buffer ? Buffer->getBuffer().str() : "<none>";
+  }
+
+  LLVMContext Context;
+  SmallString<128> CacheDir;
+  std::unique_ptr<Module> M;
+};
+
+TEST_F(FileSystemObjectCacheTest, StoreAndLoad) {
+  FileSystemObjectCache Cache(CacheDir, "config");
+  EXPECT_EQ("<none>", getContents(Cache.getObject(M.get())));
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("object", "obj"));
+  EXPECT_EQ("object", getContents(Cache.getObject(M.get())));
+
+  // A new cache instance, as in a later run, finds the object too.
+  FileSystemObjectCache Warm(CacheDir, "config");
+  EXPECT_EQ("object", getContents(Warm.getObject(M.get())));
+}
+
+TEST_F(FileSystemObjectCacheTest, KeyDependsOnModuleAndConfiguration) {
+  FileSystemObjectCache Cache(CacheDir, "config");
+  Cache.getObject(M.get());
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("object", "obj"));
+
+  FileSystemObjectCache Other(CacheDir, "other config");
+  EXPECT_NE(Cache.getKey(*M), Other.getKey(*M));
+  EXPECT_EQ("<none>", getContents(Other.getObject(M.get())));
+
+  auto M2 = createModule("bar");
+  EXPECT_NE(Cache.getKey(*M), Cache.getKey(*M2));
+  EXPECT_EQ("<none>", getContents(Cache.getObject(M2.get())));
+}
+
+TEST_F(FileSystemObjectCacheTest, KeyIsComputedBeforeCompilation) {
+  FileSystemObjectCache Cache(CacheDir, "config");
+  EXPECT_EQ("<none>", getContents(Cache.getObject(M.get())));
+
+  // Simulate code generation changing the module.
+  new GlobalVariable(*M, Type::getInt32Ty(Context), false,
+                     GlobalValue::ExternalLinkage, nullptr, "g");
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("object", "obj"));
+
+  auto Fresh = createModule("foo");
+  EXPECT_EQ("object", getContents(Cache.getObject(Fresh.get())));
+}
+
+TEST_F(FileSystemObjectCacheTest, HitForgetsKey) {
+  FileSystemObjectCache Cache(CacheDir, "config");
+  Cache.getObject(M.get());
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("object", "obj"));
+  EXPECT_EQ("object", getContents(Cache.getObject(M.get())));
+
+  // The hit must not leave a key behind for a later compilation of the
+  // changed module to be stored under.
+  new GlobalVariable(*M, Type::getInt32Ty(Context), false,
+                     GlobalValue::ExternalLinkage, nullptr, "g");
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("changed", "obj"));
+
+  auto Fresh = createModule("foo");
+  EXPECT_EQ("object", getContents(Cache.getObject(Fresh.get())));
+  EXPECT_EQ("changed", getContents(Cache.getObject(M.get())));
+}
+
+TEST_F(FileSystemObjectCacheTest, Eviction) {
+  // Room for one object of 16 bytes, but not two.
+  FileSystemObjectCache Cache(CacheDir, "config", 24);
+  auto M2 = createModule("bar");
+  Cache.notifyObjectCompiled(M.get(), MemoryBufferRef("0123456789abcdef", ""));
+  Cache.notifyObjectCompiled(M2.get(),
+                             MemoryBufferRef("fedcba9876543210", ""));
+
+  unsigned Hits = 0;
+  if (Cache.getObject(M.get()))
+    ++Hits;
+  if (Cache.getObject(M2.get()))
+    ++Hits;
+  EXPECT_EQ(1u, Hits);
+}
+
+} // end anonymous namespace
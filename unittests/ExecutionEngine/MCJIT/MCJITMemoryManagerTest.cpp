@@ -166,5 +166,54 @@ TEST(MCJITMemoryManagerTest, ManyVariedAllocations) {
   }
 }
 
+TEST(MCJITMemoryManagerTest, SharedPoolReusesPages) {
+  SectionMemoryPool Pool(1024 * 1024);
+
+  uint8_t *code1;
+  {
+    SectionMemoryManager MemMgr(&Pool);
+    code1 = MemMgr.allocateCodeSection(256, 0, 1, "");
+    uint8_t *data1 = MemMgr.allocateDataSection(256, 0, 2, "", true);
+    EXPECT_NE((uint8_t*)nullptr, code1);
+    EXPECT_NE((uint8_t*)nullptr, data1);
+    EXPECT_FALSE(MemMgr.finalizeMemory());
+  }
+  size_t MappedBytes = Pool.getMappedBytes();
+  EXPECT_NE(0U, MappedBytes);
+
+  // The pages of the destroyed manager are writable again and get reused.
+  SectionMemoryManager MemMgr(&Pool);
+  uint8_t *code2 = MemMgr.allocateCodeSection(256, 0, 1, "");
+  EXPECT_EQ(code1, code2);
+  for (unsigned i = 0; i < 256; ++i)
+    code2[i] = 0xFF;
+  EXPECT_EQ(MappedBytes, Pool.getMappedBytes());
+}
+
+TEST(MCJITMemoryManagerTest, AllocateAfterFinalize) {
+  std::unique_ptr<SectionMemoryManager> MemMgr(new SectionMemoryManager());
+
+  uint8_t *code1 = MemMgr->allocateCodeSection(256, 0, 1, "");
+  uint8_t *data1 = MemMgr->allocateDataSection(256, 0, 2, "", false);
+  EXPECT_NE((uint8_t*)nullptr, code1);
+  EXPECT_NE((uint8_t*)nullptr, data1);
+  EXPECT_FALSE(MemMgr->finalizeMemory());
+
+  // Sections allocated after a finalization must not share a page with the
+  // code that is no longer writable.
+  uint8_t *code2 = MemMgr->allocateCodeSection(256, 0, 3, "");
+  uint8_t *data2 = MemMgr->allocateDataSection(256, 0, 4, "", true);
+  EXPECT_NE((uint8_t*)nullptr, code2);
+  EXPECT_NE((uint8_t*)nullptr, data2);
+  for (unsigned i = 0; i < 256; ++i) {
+    code2[i] = 0xCC;
+    data2[i] = 0xAA;
+    data1[i] = 0xBB;
+  }
+  EXPECT_FALSE(MemMgr->finalizeMemory());
+  EXPECT_EQ(0xCC, code2[255]);
+  EXPECT_EQ(0xAA, data2[0]);
+}
+
 } // Namespace
 
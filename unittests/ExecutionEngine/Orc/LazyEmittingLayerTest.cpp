@@ -8,7 +8,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
 #include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
 
 namespace {
 
@@ -29,4 +37,67 @@ TEST(LazyEmittingLayerTest, Empty) {
   L.addModuleSet(std::list<std::unique_ptr<llvm::Module>>(), nullptr, nullptr);
 }
 
+#if LLVM_ENABLE_THREADS
+
+// A base layer that counts how often module sets are emitted to it.
+struct CountingBaseLayer {
+  typedef int ModuleSetHandleT;
+
+  CountingBaseLayer() : Emissions(0) {}
+
+  template <typename ModuleSetT, typename MemoryManagerPtrT,
+            typename SymbolResolverPtrT>
+  ModuleSetHandleT addModuleSet(ModuleSetT, MemoryManagerPtrT,
+                                SymbolResolverPtrT) {
+    // Give other threads a chance to race with the emission.
+    std::this_thread::yield();
+    return ++Emissions;
+  }
+
+  llvm::orc::JITSymbol findSymbol(const std::string &, bool) {
+    return nullptr;
+  }
+
+  llvm::orc::JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &,
+                                    bool) {
+    return llvm::orc::JITSymbol(0x1000 + H, llvm::JITSymbolFlags::Exported);
+  }
+
+  std::atomic<int> Emissions;
+};
+
+TEST(LazyEmittingLayerTest, ConcurrentLookupsEmitOnce) {
+  llvm::LLVMContext Context;
+  std::unique_ptr<llvm::Module> M(new llvm::Module("test", Context));
+  llvm::Function *F = llvm::Function::Create(
+      llvm::FunctionType::get(llvm::Type::getVoidTy(Context), false),
+      llvm::GlobalValue::ExternalLinkage, "foo", M.get());
+  llvm::ReturnInst::Create(Context,
+                           llvm::BasicBlock::Create(Context, "entry", F));
+
+  CountingBaseLayer B;
+  llvm::orc::LazyEmittingLayer<CountingBaseLayer> L(B);
+  std::vector<llvm::Module*> Ms;
+  Ms.push_back(M.get());
+  auto H = L.addModuleSet(std::move(Ms), nullptr, nullptr);
+  EXPECT_FALSE(L.isEmitted(H));
+
+  const unsigned NumThreads = 8;
+  std::vector<llvm::orc::TargetAddress> Addrs(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Threads.push_back(std::thread([&, I]() {
+      Addrs[I] = L.findSymbol("foo", false).getAddress();
+    }));
+  for (auto &T : Threads)
+    T.join();
+
+  EXPECT_TRUE(L.isEmitted(H));
+  EXPECT_EQ(1, B.Emissions);
+  for (auto Addr : Addrs)
+    EXPECT_EQ(0x1001U, Addr);
+}
+
+#endif
+
 }
@@ -0,0 +1,136 @@
+//===- ObjectLinkingLayerTest.cpp - Unit tests for object linking layer ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LambdaResolver.h"
+#include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/TargetSelect.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+#if LLVM_ENABLE_THREADS
+
+// Build a module defining "f<I>", which returns I. For I > 0 it does so by
+// calling "f<I-1>", which is defined in another module.
+std::unique_ptr<Module> createChainModule(LLVMContext &Context,
+                                          const TargetMachine &TM,
+                                          unsigned I) {
+  auto M = llvm::make_unique<Module>("f" + Twine(I).str(), Context);
+  M->setTargetTriple(TM.getTargetTriple().str());
+  M->setDataLayout(TM.createDataLayout());
+
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  FunctionType *FTy = FunctionType::get(Int32Ty, false);
+  Function *F = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                 "f" + Twine(I), M.get());
+  IRBuilder<> Builder(BasicBlock::Create(Context, "entry", F));
+  if (I == 0) {
+    Builder.CreateRet(ConstantInt::get(Int32Ty, 0));
+    return M;
+  }
+
+  Function *Prev = Function::Create(FTy, GlobalValue::ExternalLinkage,
+                                    "f" + Twine(I - 1), M.get());
+  Builder.CreateRet(Builder.CreateAdd(Builder.CreateCall(Prev, {}),
+                                      ConstantInt::get(Int32Ty, 1)));
+  return M;
+}
+
+// Look symbols up concurrently through a lazy-emitting, compiling and linking
+// layer stack, whose resolvers look symbols up in the lazy layer again. One
+// thread's finalization then waits for a set that another thread is emitting,
+// which must not deadlock with that emission adding its objects.
+TEST(ObjectLinkingLayerTest, ConcurrentLazyLookups) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  std::unique_ptr<TargetMachine> TM(EngineBuilder().selectTarget());
+  if (!TM || TM->getTargetTriple().getArch() != Triple::x86_64 ||
+      TM->getTargetTriple().isOSWindows())
+    return;
+
+  const unsigned NumModules = 16;
+  const unsigned NumThreads = 4;
+  const unsigned NumRounds = 10;
+
+  std::vector<std::string> Names;
+  for (unsigned I = 0; I != NumModules; ++I) {
+    std::string Name;
+    raw_string_ostream NameStream(Name);
+    Mangler::getNameWithPrefix(NameStream, "f" + Twine(I),
+                               *TM->getDataLayout());
+    Names.push_back(NameStream.str());
+  }
+
+  for (unsigned Round = 0; Round != NumRounds; ++Round) {
+    // Modules compiled concurrently must not share a context.
+    std::vector<std::unique_ptr<LLVMContext>> Contexts;
+    ObjectLinkingLayer<> ObjectLayer;
+    IRCompileLayer<decltype(ObjectLayer)> CompileLayer(
+        ObjectLayer, ConcurrentIRCompiler(*TM));
+    LazyEmittingLayer<decltype(CompileLayer)> LazyLayer(CompileLayer);
+
+    for (unsigned I = 0; I != NumModules; ++I) {
+      Contexts.push_back(llvm::make_unique<LLVMContext>());
+      std::vector<std::unique_ptr<Module>> Ms;
+      Ms.push_back(createChainModule(*Contexts.back(), *TM, I));
+      auto Resolver = createLambdaResolver(
+          [&](const std::string &Name) {
+            if (auto Sym = LazyLayer.findSymbol(Name, false))
+              return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+            return RuntimeDyld::SymbolInfo(nullptr);
+          },
+          [](const std::string &) { return RuntimeDyld::SymbolInfo(nullptr); });
+      LazyLayer.addModuleSet(std::move(Ms),
+                             llvm::make_unique<SectionMemoryManager>(),
+                             std::move(Resolver));
+    }
+
+    // Each thread starts at a different point of the chain, so that it runs
+    // into sets that other threads are emitting or finalizing.
+    std::atomic<unsigned> Failures(0);
+    std::vector<std::thread> Threads;
+    for (unsigned T = 0; T != NumThreads; ++T)
+      Threads.emplace_back([&, T]() {
+        for (unsigned K = 0; K != NumModules; ++K) {
+          unsigned I = (NumModules - 1 - T * (NumModules / NumThreads) + K) %
+                       NumModules;
+          auto Sym = LazyLayer.findSymbol(Names[I], false);
+          TargetAddress Addr = Sym ? Sym.getAddress() : 0;
+          if (!Addr ||
+              reinterpret_cast<int (*)()>(static_cast<uintptr_t>(Addr))() !=
+                  static_cast<int>(I))
+            ++Failures;
+        }
+      });
+    for (auto &Thread : Threads)
+      Thread.join();
+
+    EXPECT_EQ(0U, Failures) << "in round " << Round;
+  }
+}
+
+#endif
+
+}
@@ -0,0 +1,144 @@
+//===- OrcRemoteTargetTest.cpp - Unit tests for the Orc remote target -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetClient.h"
+#include "llvm/ExecutionEngine/Orc/OrcRemoteTargetServer.h"
+#include "llvm/Config/config.h"
+#include "llvm/Support/Errc.h"
+#include "gtest/gtest.h"
+#include <cstring>
+#include <thread>
+
+#if LLVM_ENABLE_THREADS && defined(LLVM_ON_UNIX)
+#include <unistd.h>
+
+using namespace llvm;
+using namespace llvm::orc;
+using namespace llvm::orc::remote;
+
+namespace {
+
+static int fortyTwo() { return 42; }
+
+static int countArgChars(int Argc, const char *Argv[]) {
+  int Count = 0;
+  for (int I = 0; I != Argc; ++I)
+    Count += strlen(Argv[I]);
+  return Argv[Argc] ? -1 : Count;
+}
+
+static TargetAddress toTargetAddress(const void *P) {
+  return static_cast<TargetAddress>(reinterpret_cast<uintptr_t>(P));
+}
+
+// Runs a server on a thread of this process, connected to a client by pipes.
+class OrcRemoteTargetTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_EQ(0, pipe(ToServer));
+    ASSERT_EQ(0, pipe(ToClient));
+    ServerChannel.reset(new FDRPCChannel(ToServer[0], ToClient[1]));
+    ClientChannel.reset(new FDRPCChannel(ToClient[0], ToServer[1]));
+    ServerThread = std::thread([this]() {
+      OrcRemoteTargetServer Server(*ServerChannel, [](const std::string &Name) {
+        return Name == "forty_two" ? toTargetAddress((void *)&fortyTwo) : 0;
+      });
+      ServerError = Server.run();
+    });
+
+    auto ClientOrErr = OrcRemoteTargetClient::Create(*ClientChannel);
+    ASSERT_FALSE(ClientOrErr.getError());
+    Client = std::move(*ClientOrErr);
+  }
+
+  void TearDown() override {
+    if (Client) {
+      EXPECT_FALSE(Client->terminateSession());
+    }
+    ServerThread.join();
+    EXPECT_FALSE(ServerError);
+    for (int FD : {ToServer[0], ToServer[1], ToClient[0], ToClient[1]})
+      close(FD);
+  }
+
+  int ToServer[2], ToClient[2];
+  std::unique_ptr<FDRPCChannel> ServerChannel, ClientChannel;
+  std::thread ServerThread;
+  std::error_code ServerError;
+  std::unique_ptr<OrcRemoteTargetClient> Client;
+};
+
+TEST_F(OrcRemoteTargetTest, LookUpAndCall) {
+  EXPECT_EQ(sizeof(void *), Client->getPointerSize());
+
+  TargetAddress Addr;
+  EXPECT_FALSE(Client->getSymbolAddress(Addr, "not_there"));
+  EXPECT_EQ(0u, Addr);
+  EXPECT_FALSE(Client->getSymbolAddress(Addr, "forty_two"));
+  EXPECT_EQ(toTargetAddress((void *)&fortyTwo), Addr);
+
+  int Result = 0;
+  EXPECT_FALSE(Client->callIntVoid(Result, Addr));
+  EXPECT_EQ(42, Result);
+
+  EXPECT_FALSE(Client->callMain(Result,
+                                toTargetAddress((void *)&countArgChars),
+                                {"prog", "ab", ""}));
+  EXPECT_EQ(6, Result);
+}
+
+TEST_F(OrcRemoteTargetTest, QueuedRequests) {
+  TargetAddress Addr;
+  ASSERT_FALSE(Client->reserveMem(Addr, Client->getPageSize()));
+  ASSERT_NE(0u, Addr);
+
+  // The lookup, the write and the protection change all go out with the call.
+  const char Data[] = "remote";
+  EXPECT_FALSE(Client->queueSymbolLookups({"forty_two"}));
+  EXPECT_FALSE(Client->writeMem(Addr + 16, Data, sizeof(Data)));
+  EXPECT_FALSE(Client->setProtections(Addr, Client->getPageSize(),
+                                      sys::Memory::MF_READ));
+  int Result = 0;
+  EXPECT_FALSE(Client->callIntVoid(Result,
+                                   toTargetAddress((void *)&fortyTwo)));
+  EXPECT_EQ(42, Result);
+  EXPECT_STREQ(Data, reinterpret_cast<const char *>(
+                         static_cast<uintptr_t>(Addr + 16)));
+
+  TargetAddress FortyTwoAddr;
+  EXPECT_FALSE(Client->getSymbolAddress(FortyTwoAddr, "forty_two"));
+  EXPECT_EQ(toTargetAddress((void *)&fortyTwo), FortyTwoAddr);
+
+  EXPECT_FALSE(Client->releaseMem(Addr));
+  EXPECT_FALSE(Client->sync());
+}
+
+TEST_F(OrcRemoteTargetTest, QueuedErrorIsReported) {
+  TargetAddress Addr;
+  ASSERT_FALSE(Client->reserveMem(Addr, Client->getPageSize()));
+
+  // Writing past the reserved block fails, and the failure is reported by the
+  // next response instead of carrying out its request.
+  const char Data[16] = {0};
+  EXPECT_FALSE(Client->writeMem(Addr + Client->getPageSize() - 8, Data,
+                                sizeof(Data)));
+  int Result = 0;
+  EXPECT_EQ(errc::bad_address,
+            Client->callIntVoid(Result, toTargetAddress((void *)&fortyTwo)));
+  EXPECT_EQ(0, Result);
+
+  // The session carries on.
+  EXPECT_FALSE(Client->callIntVoid(Result,
+                                   toTargetAddress((void *)&fortyTwo)));
+  EXPECT_EQ(42, Result);
+}
+
+}
+
+#endif
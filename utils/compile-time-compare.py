@@ -0,0 +1,263 @@
+#!/usr/bin/env python
+
+"""A per-pass compile time comparison script.
+
+This script runs two builds of an LLVM tool (usually opt or llc) over a corpus
+of bitcode or assembly files, collects the -time-passes report of every run,
+and compares the time spent in each pass between the two builds. Each file is
+compiled several times with each build, interleaving the builds so that
+machine noise affects both alike, and a pass is only reported as regressed if
+Welch's t-test says the difference is unlikely to be noise.
+
+Optionally, the number of instructions retired by each run is collected with
+'perf stat', which is much less noisy than time.
+
+The exit status is 0 if the candidate build stays within the compile time
+budget and 1 otherwise, so the script can drive 'git bisect run':
+
+  compile-time-compare.py --baseline old/bin/opt --candidate bin/opt \\
+      --tool-args='-O2' --budget=2 corpus/
+"""
+
+from __future__ import print_function
+
+import argparse
+import collections
+import math
+import os
+import re
+import subprocess
+import sys
+
+# The timer group holding one timer per pass. Other groups (e.g. instruction
+# selection in llc) break down time already counted in it.
+PASS_TIMER_GROUP = 'Pass execution timing report'
+# A column of a -time-passes row: the time in seconds and its percentage.
+TIMER_COLUMN_RE = re.compile(r'(\d+\.\d+)\s+\(\s*\d+\.\d+%\)')
+TIMER_HEADER_RE = re.compile(r'-{2,}\s*([\w+ ]+?)\s*-{2,}')
+PERF_INSTRUCTIONS_RE = re.compile(r'^(\d+),[^,]*,instructions')
+
+
+def find_inputs(paths):
+  """Expand the given files and directories into a sorted list of inputs."""
+  inputs = []
+  for path in paths:
+    if os.path.isdir(path):
+      for root, _, files in os.walk(path):
+        inputs.extend(os.path.join(root, f) for f in files
+                      if f.endswith('.bc') or f.endswith('.ll'))
+    else:
+      inputs.append(path)
+  return sorted(inputs)
+
+
+def parse_time_passes(report, column):
+  """Return a map from timer name to seconds for a -time-passes report.
+
+  Every timer group in the report (passes, instruction selection, ...) is
+  parsed; timers in different groups are told apart by the group name.
+  """
+  times = collections.defaultdict(float)
+  group = None
+  columns = []
+  for line in report.splitlines():
+    stripped = line.strip()
+    if stripped.startswith('...') and stripped.endswith('...'):
+      group = stripped.strip('. ')
+      continue
+    if '--- Name ---' in line:
+      columns = TIMER_HEADER_RE.findall(line)
+      continue
+    values = TIMER_COLUMN_RE.findall(line)
+    if not values or not columns:
+      continue
+    name = TIMER_COLUMN_RE.sub('', line).strip()
+    if not name or name == 'Total':
+      continue
+    # Prefer the requested column, and fall back to the last one (wall time,
+    # which is always printed).
+    index = len(values) - 1
+    if column in columns and columns.index(column) < len(values):
+      index = columns.index(column)
+    times['%s: %s' % (group, name) if group else name] += float(values[index])
+  return times
+
+
+def run_tool(tool, tool_args, input_path, use_perf):
+  """Compile one input; return its -time-passes report and instructions."""
+  cmd = [tool] + tool_args + ['-time-passes', '-o', os.devnull, input_path]
+  if use_perf:
+    cmd = ['perf', 'stat', '-x,', '-e', 'instructions', '--'] + cmd
+  proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                          universal_newlines=True)
+  _, stderr = proc.communicate()
+  if proc.returncode != 0:
+    raise RuntimeError('%s failed on %s:\n%s' % (tool, input_path, stderr))
+  instructions = None
+  if use_perf:
+    for line in stderr.splitlines():
+      match = PERF_INSTRUCTIONS_RE.match(line.strip())
+      if match:
+        instructions = int(match.group(1))
+  return stderr, instructions
+
+
+def mean(samples):
+  return sum(samples) / len(samples)
+
+
+def variance(samples):
+  if len(samples) < 2:
+    return 0.0
+  m = mean(samples)
+  return sum((s - m) ** 2 for s in samples) / (len(samples) - 1)
+
+
+def welch_t(base, cand):
+  """Welch's t statistic for the difference of the two sample means."""
+  se = math.sqrt(variance(base) / len(base) + variance(cand) / len(cand))
+  delta = mean(cand) - mean(base)
+  if se == 0.0:
+    return float('inf') if delta > 0 else float('-inf') if delta < 0 else 0.0
+  return delta / se
+
+
+def collect(args, inputs):
+  """Run both builds and return per-build lists of per-run samples.
+
+  Each sample sums the timers over the whole corpus for one repetition, so
+  the statistics compare corpus totals rather than single noisy files.
+  """
+  builds = [('baseline', args.baseline), ('candidate', args.candidate)]
+  timers = dict((b, []) for b, _ in builds)
+  instructions = dict((b, []) for b, _ in builds)
+  for rep in range(args.runs):
+    totals = dict((b, collections.defaultdict(float)) for b, _ in builds)
+    insts = dict((b, 0) for b, _ in builds)
+    for input_path in inputs:
+      # Alternate which build goes first to spread out warm-up effects.
+      order = builds if rep % 2 == 0 else list(reversed(builds))
+      for build, tool in order:
+        report, count = run_tool(tool, args.tool_args, input_path, args.perf)
+        for name, seconds in parse_time_passes(report, args.column).items():
+          totals[build][name] += seconds
+        if count is not None:
+          insts[build] += count
+    for build, _ in builds:
+      timers[build].append(totals[build])
+      instructions[build].append(insts[build])
+    if args.verbose:
+      print('finished run %d of %d' % (rep + 1, args.runs), file=sys.stderr)
+  return timers, instructions
+
+
+def compare(args, timers):
+  """Return (name, base mean, candidate mean, t) for every timer."""
+  names = set()
+  for sample in timers['baseline'] + timers['candidate']:
+    names.update(sample.keys())
+  results = []
+  for name in names:
+    base = [s.get(name, 0.0) for s in timers['baseline']]
+    cand = [s.get(name, 0.0) for s in timers['candidate']]
+    results.append((name, mean(base), mean(cand), welch_t(base, cand)))
+  return results
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+  parser.add_argument('--baseline', required=True,
+                      help='The reference build of the tool')
+  parser.add_argument('--candidate', required=True,
+                      help='The build of the tool being evaluated')
+  parser.add_argument('--tool-args', default='',
+                      help='Arguments passed to both tools, e.g. "-O2"')
+  parser.add_argument('-n', '--runs', type=int, default=5,
+                      help='Number of times each input is compiled by each '
+                           'build (default 5)')
+  parser.add_argument('--column', default='User+System',
+                      choices=['User Time', 'System Time', 'User+System',
+                               'Wall Time'],
+                      help='The -time-passes column to compare (default '
+                           '"User+System")')
+  parser.add_argument('--top', type=int, default=10,
+                      help='Number of regressing timers to list (default 10)')
+  parser.add_argument('--t-threshold', type=float, default=2.0,
+                      help='Minimum Welch t statistic for a difference to be '
+                           'significant (default 2.0, roughly 95%%)')
+  parser.add_argument('--min-delta', type=float, default=0.001,
+                      help='Ignore timers that change by fewer seconds than '
+                           'this (default 0.001)')
+  parser.add_argument('--budget', type=float, default=None,
+                      help='Fail if the total compile time grows by more than '
+                           'this many percent')
+  parser.add_argument('--perf', action='store_true',
+                      help='Also compare retired instructions using perf stat')
+  parser.add_argument('-v', '--verbose', action='store_true',
+                      help='Show progress')
+  parser.add_argument('inputs', nargs='+',
+                      help='Input files, or directories to search for .bc and '
+                           '.ll files')
+  args = parser.parse_args()
+  args.tool_args = args.tool_args.split()
+  if args.runs < 2:
+    parser.error('at least two runs are needed for a statistical comparison')
+
+  inputs = find_inputs(args.inputs)
+  if not inputs:
+    parser.error('no inputs found')
+
+  try:
+    timers, instructions = collect(args, inputs)
+  except RuntimeError as e:
+    print(e, file=sys.stderr)
+    return 2
+
+  results = compare(args, timers)
+  regressions = sorted((r for r in results
+                        if r[3] >= args.t_threshold and
+                        r[2] - r[1] >= args.min_delta),
+                       key=lambda r: r[2] - r[1], reverse=True)
+  improvements = [r for r in results
+                  if r[3] <= -args.t_threshold and
+                  r[1] - r[2] >= args.min_delta]
+
+  totals = [r for r in results if r[0].startswith(PASS_TIMER_GROUP + ':')]
+  totals = totals or results
+  base_total = sum(r[1] for r in totals)
+  cand_total = sum(r[2] for r in totals)
+  print('Inputs: %d, runs per input and build: %d' % (len(inputs), args.runs))
+  print('Total %s: %.4fs -> %.4fs (%+.2f%%)' % (
+      args.column, base_total, cand_total,
+      100.0 * (cand_total - base_total) / base_total if base_total else 0.0))
+  if args.perf:
+    base_insts = mean(instructions['baseline'])
+    cand_insts = mean(instructions['candidate'])
+    print('Instructions retired: %d -> %d (%+.2f%%, t = %.2f)' % (
+        base_insts, cand_insts,
+        100.0 * (cand_insts - base_insts) / base_insts if base_insts else 0.0,
+        welch_t(instructions['baseline'], instructions['candidate'])))
+  print('%d timers regressed, %d improved' % (len(regressions),
+                                              len(improvements)))
+
+  if regressions:
+    print()
+    print('Top regressions:')
+    print('%10s %10s %9s %7s  %s' % ('Base(s)', 'Cand(s)', 'Delta', 't',
+                                     'Timer'))
+    for name, base, cand, t in regressions[:args.top]:
+      delta = 100.0 * (cand - base) / base if base else float('inf')
+      print('%10.4f %10.4f %+8.1f%% %7.2f  %s' % (base, cand, delta, t, name))
+
+  if args.budget is not None and base_total:
+    growth = 100.0 * (cand_total - base_total) / base_total
+    if growth > args.budget:
+      print('Compile time grew by %.2f%%, over the budget of %.2f%%' % (
+          growth, args.budget))
+      return 1
+  return 0
+
+
+if __name__ == '__main__':
+  sys.exit(main())